@@ -7,96 +7,60 @@
 #include <dune/pdelab/localoperator/convectiondiffusionfem.hh>
 #include <dune/pdelab/localoperator/l2.hh>
 
+#include "../utility/timestepcontrol.hh"
+#include "../utility/constantjacobian.hh"
+#include "../utility/supertimestepping.hh"
+#include "../utility/asyncoutput.hh"
+#include "../utility/xdmfwriter.hh"
+
+#include "heatproblem.hh"
+
 //***********************************************************************
 //***********************************************************************
-// diffusion problem with time dependent coefficients
+// output of one snapshot, called on the writer thread; with xdmf the
+// mesh is written once and only the vertex data in every step
 //***********************************************************************
 //***********************************************************************
 
-const double kx = 2.0, ky = 2.0;
-
-template<typename GV, typename RF>
-class GenericProblem
+template<typename GV, typename FS, typename V>
+class HeatOutput
 {
-  typedef Dune::PDELab::ConvectionDiffusionBoundaryConditions::Type BCType;
-
 public:
-  typedef Dune::PDELab::ConvectionDiffusionParameterTraits<GV,RF> Traits;
-
-  GenericProblem () : time(0.0) {}
-
-  //! tensor diffusion coefficient
-  typename Traits::PermTensorType
-  A (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
-  {
-    typename Traits::PermTensorType I;
-    for (std::size_t i=0; i<Traits::dimDomain; i++)
-      for (std::size_t j=0; j<Traits::dimDomain; j++)
-        I[i][j] = (i==j) ? 1.0 : 0.0;
-    return I;
-  }
-
-  //! velocity field
-  typename Traits::RangeType
-  b (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
-  {
-    typename Traits::RangeType v(0.0);
-    return v;
-  }
-
-  //! sink term
-  typename Traits::RangeFieldType
-  c (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  //! collective, as the XDMF writer exchanges the sizes of the pieces
+  HeatOutput (const GV& gv_, const FS& fs_, int subsampling_, std::string basename, bool xdmf)
+    : gv(gv_), fs(fs_), subsampling(subsampling_), collection(gv_,basename)
   {
-    return 0.0;
+    if (xdmf)
+      xdmfwriter = std::make_shared<XDMFWriter<GV> >(gv,basename);
   }
 
-  //! source term
-  typename Traits::RangeFieldType
-  f (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  void write (const V& x, double time, const std::string& name)
   {
-    return 0.0;
-  }
-
-  //! boundary condition type function
-  BCType
-  bctype (const typename Traits::IntersectionType& is, const typename Traits::IntersectionDomainType& x) const
-  {
-    return Dune::PDELab::ConvectionDiffusionBoundaryConditions::Dirichlet;
-  }
-
-  //! Dirichlet boundary condition value
-  typename Traits::RangeFieldType
-  g (const typename Traits::ElementType& e, const typename Traits::DomainType& xlocal) const
-  {
-    typename Traits::DomainType x = e.geometry().global(xlocal);
-
-    return std::exp(-(kx*kx+ky*ky)*M_PI*M_PI*time) * sin(kx*M_PI*x[0]) * sin(ky*M_PI*x[1]);
-  }
-
-  //! Neumann boundary condition
-  typename Traits::RangeFieldType
-  j (const typename Traits::IntersectionType& is, const typename Traits::IntersectionDomainType& x) const
-  {
-    return 0.0;
-  }
-
-  //! Neumann boundary condition
-  typename Traits::RangeFieldType
-  o (const typename Traits::IntersectionType& is, const typename Traits::IntersectionDomainType& x) const
-  {
-    return 0.0;
+    typename FS::DGF xdgf(fs.getGFS(),x);
+    if (xdmfwriter)
+      {
+        xdmfwriter->addVertexData(new typename FS::VTKF(xdgf,"x_h"));
+        xdmfwriter->write(time);
+        xdmfwriter->clear();
+      }
+    else
+      {
+        VTKPieceWriter<GV,Dune::SubsamplingVTKWriter<GV> > vtkwriter(gv,subsampling);
+        vtkwriter.addVertexData(new typename FS::VTKF(xdgf,"x_h"));
+        collection.write(vtkwriter,time,name,Dune::VTK::appendedraw);
+      }
   }
 
-  //! set time for subsequent evaluation
-  void setTime (RF t)
-  {
-    time = t;
-    //std::cout << "setting time to " << time << std::endl;
-  }
+  //! bytes of the mesh and of the data written on this rank, XDMF only
+  long meshBytes () const { return xdmfwriter ? xdmfwriter->meshBytes() : 0; }
+  long dataBytes () const { return xdmfwriter ? xdmfwriter->dataBytes() : 0; }
 
 private:
-  RF time;
+  const GV& gv;
+  const FS& fs;
+  int subsampling;
+  VTKCollection collection;
+  std::shared_ptr<XDMFWriter<GV> > xdmfwriter;
 };
 
 //***********************************************************************
@@ -107,7 +71,8 @@ private:
 
 template<typename GM, unsigned int degree, Dune::GeometryType::BasicType elemtype,
          Dune::PDELab::MeshType meshtype, Dune::SolverCategory::Category solvertype>
-void do_simulation (double T, double dt, GM& grid, std::string basename)
+void do_simulation (double T, double dt, double tol, bool constant, std::string sts,
+                    bool xdmf, GM& grid, std::string basename)
 {
   // define parameters
   typedef double NumberType;
@@ -146,51 +111,125 @@ void do_simulation (double T, double dt, GM& grid, std::string basename)
   typedef Dune::PDELab::ISTLSolverBackend_CG_AMG_SSOR<FS,ASSEMBLER,solvertype> SBE;
   SBE sbe(fs,assembler,5000,1);
 
-  // linear problem solver
-  typedef Dune::PDELab::StationaryLinearProblemSolver<typename ASSEMBLER::GO,typename SBE::LS,V> PDESOLVER;
-  PDESOLVER pdesolver(*assembler,*sbe,1e-6);
-
-  // time-stepper
-  Dune::PDELab::OneStepThetaParameter<NumberType> method(1.0);
+  // linear problem solver; with constant=true the Jacobian is assembled
+  // and the AMG hierarchy is set up only once since coefficients and dt
+  // do not change
+  typedef ConstantJacobianLinearSolver<typename ASSEMBLER::GO,typename SBE::LS,V> PDESOLVER;
+  PDESOLVER pdesolver(*assembler,*sbe,1e-6,constant);
+
+  // time-stepper; with tol>0 Alexander2 and the embedded implicit Euler
+  // solution control the step size, otherwise implicit Euler with fixed dt
+  Dune::PDELab::OneStepThetaParameter<NumberType> euler(1.0);
+  Dune::PDELab::Alexander2Parameter<NumberType> alexander2;
+  const Dune::PDELab::TimeSteppingParameterInterface<NumberType>& method =
+    (tol>0.0) ? static_cast<const Dune::PDELab::TimeSteppingParameterInterface<NumberType>&>(alexander2) : euler;
   typedef Dune::PDELab::OneStepMethod<NumberType,typename ASSEMBLER::GO,PDESOLVER,V> OSM;
   OSM osm(method,*assembler,pdesolver);
-  osm.setVerbosityLevel(2);
+  osm.setVerbosityLevel(tol>0.0 ? 0 : 2);
+  OSM osmlow(euler,*assembler,pdesolver);
+  osmlow.setVerbosityLevel(0);
+  PIStepController controller(1,1e-8*T,T);
+
+  // super time stepping: explicit RKL2 or RKC2 steps with a lumped mass
+  // matrix, the stage count follows from dt and the spectral radius
+  RKL2Parameter<NumberType> rkl2;
+  RKCParameter<NumberType> rkc;
+  SuperTimeSteppingParameter<NumberType>& stsmethod =
+    (sts=="rkc") ? static_cast<SuperTimeSteppingParameter<NumberType>&>(rkc) : rkl2;
+  typedef SuperTimeStepping<NumberType,typename SASS::GO,LOP,V> STS;
+  STS stsosm(stsmethod,*sass,lop,*tass);
+  if (!sts.empty())
+    {
+      fs.assembleConstraints(bctype);
+      stsosm.estimateSpectralRadius(0.0,x);
+    }
 
-  // graphics for initial guess
+  // graphics for initial guess; the files are written by a background
+  // thread while the time loop continues
   Dune::PDELab::FilenameHelper fn(basename);
-  { // start a new block to automatically delete the VTKWriter object
-    Dune::SubsamplingVTKWriter<typename GM::LeafGridView> vtkwriter(grid.leafGridView(),degree-1);
-    typename FS::DGF xdgf(fs.getGFS(),x);
-    vtkwriter.addVertexData(new typename FS::VTKF(xdgf,"x_h"));
-    vtkwriter.write(fn.getName(),Dune::VTK::appendedraw);
-    fn.increment();
-  }
+  typedef HeatOutput<typename GM::LeafGridView,FS,V> OUT;
+  OUT heatoutput(grid.leafGridView(),fs,degree-1,basename,xdmf);
+  AsyncOutput<V,OUT> output(heatoutput,x);
+  output.write(x,0.0,fn.getName());
+  fn.increment();
 
   // time loop
   NumberType time = 0.0;
+  NumberType dtlast = 0.0;
+  int steps = 0;
+  double step_time = 0.0;
   while (time<T-1e-10)
     {
       // assemble constraints for new time step (assumed to be constant for all substeps)
+      dt = std::min(dt,T-time);
       problem.setTime(time+dt);
       fs.assembleConstraints(bctype);
+      if (dt!=dtlast)
+        pdesolver.invalidate();
+      dtlast = dt;
 
       // do time step
+      Dune::Timer watch;
       V xnew(fs.getGFS(),0.0);
-      osm.apply(time,dt,x,g,xnew);
+      if (!sts.empty())
+        {
+          stsosm.selectStages(dt);
+          stsosm.apply(time,dt,x,g,xnew);
+        }
+      else
+        osm.apply(time,dt,x,g,xnew);
+      step_time += watch.elapsed();
+      steps++;
+
+      // estimate the error, reject the step or propose the next step size
+      if (tol>0.0)
+        {
+          V xlow(fs.getGFS(),0.0);
+          osmlow.apply(time,dt,x,g,xlow);
+          const double err = scaled_error(xnew,xlow,tol,tol,grid.leafGridView().comm());
+          double dtnew;
+          const bool ok = controller.accept(err,dt,dtnew);
+          controller.log(time,dt,err,ok);
+          if (!ok)
+            {
+              dt = dtnew;
+              continue;
+            }
+          time += dt;
+          dt = dtnew;
+        }
+      else
+        time += dt;
 
       // output to VTK file
-      {
-        Dune::SubsamplingVTKWriter<typename GM::LeafGridView> vtkwriter(grid.leafGridView(),degree-1);
-        typename FS::DGF xdgf(fs.getGFS(),xnew);
-        vtkwriter.addVertexData(new typename FS::VTKF(xdgf,"x_h"));
-        vtkwriter.write(fn.getName(),Dune::VTK::appendedraw);
-        fn.increment();
-      }
+      output.write(xnew,time,fn.getName());
+      fn.increment();
 
       // accept time step
       x = xnew;
-      time += dt;
     }
+
+  if (tol>0.0)
+    std::cout << "time steps: " << controller.acceptedSteps() << " accepted, "
+              << controller.rejectedSteps() << " rejected" << std::endl;
+  if (!sts.empty())
+    std::cout << "time per step: " << step_time/steps << " s"
+              << " (" << steps << " steps, " << stsosm.stageCount() << " residual evaluations, "
+              << stsosm.residualTime() << " s)" << std::endl;
+  else
+    std::cout << "time per step: " << step_time/steps << " s"
+              << " (" << steps << " steps, "
+              << pdesolver.jacobianAssemblies() << " Jacobian assemblies, "
+              << pdesolver.linearSolves() << " solves, assembly "
+              << pdesolver.assemblyTime() << " s, solve "
+              << pdesolver.solveTime() << " s)" << std::endl;
+  output.finish();
+  std::cout << "output: " << output.snapshotCount() << " snapshots written in "
+            << output.writeTime() << " s in the background, time loop waited "
+            << output.waitTime() << " s" << std::endl;
+  if (xdmf)
+    std::cout << "xdmf: mesh " << heatoutput.meshBytes() << " bytes written once, data "
+              << heatoutput.dataBytes() << " bytes" << std::endl;
 }
 
 //***********************************************************************
@@ -205,14 +244,40 @@ int main(int argc, char **argv)
   Dune::MPIHelper::instance(argc,argv);
 
   // read command line arguments
-  if (argc!=4)
+  if (argc<4 || argc>6)
     {
-      std::cout << "usage: " << argv[0] << " <T> <dt> <cells>" << std::endl;
+      std::cout << "usage: " << argv[0] << " <T> <dt> <cells> [<tol>|constant|rkl2|rkc [vtk|xdmf]]" << std::endl;
+      std::cout << "with tol>0 the step size is controlled, dt is the initial step" << std::endl;
+      std::cout << "with constant the Jacobian and AMG hierarchy are set up only once" << std::endl;
+      std::cout << "rkl2 and rkc use explicit super time steps, no linear solves" << std::endl;
+      std::cout << "xdmf writes the mesh once and only the solution in every step" << std::endl;
       return 0;
     }
   double T; sscanf(argv[1],"%lg",&T);
   double dt; sscanf(argv[2],"%lg",&dt);
   int cells; sscanf(argv[3],"%d",&cells);
+  double tol = 0.0;
+  bool constant = false;
+  std::string sts;
+  if (argc>4)
+    {
+      if (std::string(argv[4])=="constant")
+        constant = true;
+      else if (std::string(argv[4])=="rkl2" || std::string(argv[4])=="rkc")
+        sts = argv[4];
+      else
+        sscanf(argv[4],"%lg",&tol);
+    }
+  bool xdmf = false;
+  if (argc>5)
+    {
+      xdmf = (std::string(argv[5])=="xdmf");
+      if (!xdmf && std::string(argv[5])!="vtk")
+        {
+          std::cout << "unknown output format " << argv[5] << std::endl;
+          return 1;
+        }
+    }
 
   // start try/catch block to get error messages from dune
   try {
@@ -230,7 +295,7 @@ int main(int argc, char **argv)
 
     std::stringstream basename;
     basename << "heat_instationary" << "_dim" << dim << "_degree" << degree;
-    do_simulation<GM,degree,elemtype,meshtype,solvertype>(T,dt,*grid,basename.str());
+    do_simulation<GM,degree,elemtype,meshtype,solvertype>(T,dt,tol,constant,sts,xdmf,*grid,basename.str());
   }
   catch (std::exception & e) {
     std::cout << "STL ERROR: " << e.what() << std::endl;
@@ -0,0 +1,255 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dune/pdelab/boilerplate/pdelab.hh>
+#include <dune/pdelab/localoperator/convectiondiffusionfem.hh>
+#include <dune/pdelab/localoperator/l2.hh>
+
+#include "../utility/constantjacobian.hh"
+#include "../utility/parareal.hh"
+
+#include "heatproblem.hh"
+
+//***********************************************************************
+//***********************************************************************
+// propagator doing equidistant steps of a one step method
+//***********************************************************************
+//***********************************************************************
+
+template<typename OSM, typename FS, typename BCType, typename Problem, typename G, typename V>
+class OneStepPropagator
+{
+public:
+  OneStepPropagator (OSM& osm_, FS& fs_, const BCType& bctype_, Problem& problem_, const G& g_, double dt_)
+    : osm(osm_), fs(fs_), bctype(bctype_), problem(problem_), g(g_), dt(dt_)
+  {}
+
+  //! the number of steps is rounded up so that dt is the same in all slices
+  void apply (double t0, double t1, const V& x0, V& x1)
+  {
+    const int steps = std::max(1,int(std::ceil((t1-t0)/dt-1e-8)));
+    const double h = (t1-t0)/steps;
+    V x(x0);
+    double time = t0;
+    for (int i=0; i<steps; i++)
+      {
+        problem.setTime(time+h);
+        fs.assembleConstraints(bctype);
+        osm.apply(time,h,x,g,x1);
+        x = x1;
+        time += h;
+      }
+  }
+
+private:
+  OSM& osm;
+  FS& fs;
+  const BCType& bctype;
+  Problem& problem;
+  const G& g;
+  double dt;
+};
+
+//***********************************************************************
+//***********************************************************************
+// Parareal on the grid of one rank group
+//***********************************************************************
+//***********************************************************************
+
+template<typename GM, unsigned int degree, Dune::GeometryType::BasicType elemtype,
+         Dune::PDELab::MeshType meshtype, Dune::SolverCategory::Category solvertype>
+void do_parareal (double T, double dt, double dtcoarse, double tol,
+                  const PararealGroups& groups, GM& grid, std::string basename)
+{
+  // define parameters
+  typedef double NumberType;
+
+  // make problem parameters
+  typedef GenericProblem<typename GM::LeafGridView,NumberType> Problem;
+  Problem problem;
+  typedef Dune::PDELab::ConvectionDiffusionBoundaryConditionAdapter<Problem> BCType;
+  BCType bctype(grid.leafGridView(),problem);
+
+  // make a finite element space
+  typedef Dune::PDELab::CGSpace<GM,NumberType,degree,BCType,elemtype,meshtype,solvertype> FS;
+  FS fs(grid,bctype);
+
+  // assemblers for finite element problem
+  typedef Dune::PDELab::ConvectionDiffusionFEM<Problem,typename FS::FEM> LOP;
+  LOP lop(problem,4);
+  typedef Dune::PDELab::GalerkinGlobalAssembler<FS,LOP,solvertype> SASS;
+  SASS sass(fs,lop);
+  typedef Dune::PDELab::L2 MLOP;
+  MLOP mlop(2*degree);
+  typedef Dune::PDELab::GalerkinGlobalAssembler<FS,MLOP,solvertype> TASS;
+  TASS tass(fs,mlop);
+  typedef Dune::PDELab::OneStepGlobalAssembler<SASS,TASS> ASSEMBLER;
+  ASSEMBLER assembler(sass,tass);
+
+  // initial value
+  typedef typename FS::DOF V;
+  V x0(fs.getGFS(),0.0);
+  typedef Dune::PDELab::ConvectionDiffusionDirichletExtensionAdapter<Problem> G;
+  G g(grid.leafGridView(),problem);
+  problem.setTime(0.0);
+  Dune::PDELab::interpolate(g,fs.getGFS(),x0);
+
+  // each propagator has a fixed step size and its own AMG hierarchy, so
+  // both set up the Jacobian only once
+  typedef Dune::PDELab::ISTLSolverBackend_CG_AMG_SSOR<FS,ASSEMBLER,solvertype> SBE;
+  typedef ConstantJacobianLinearSolver<typename ASSEMBLER::GO,typename SBE::LS,V> PDESOLVER;
+  SBE finesbe(fs,assembler,5000,0);
+  PDESOLVER finesolver(*assembler,*finesbe,1e-8);
+  SBE coarsesbe(fs,assembler,5000,0);
+  PDESOLVER coarsesolver(*assembler,*coarsesbe,1e-8);
+
+  // fine propagator: Alexander2 with dt, coarse propagator: implicit
+  // Euler with dtcoarse
+  Dune::PDELab::Alexander2Parameter<NumberType> alexander2;
+  Dune::PDELab::OneStepThetaParameter<NumberType> euler(1.0);
+  typedef Dune::PDELab::OneStepMethod<NumberType,typename ASSEMBLER::GO,PDESOLVER,V> OSM;
+  OSM fineosm(alexander2,*assembler,finesolver);
+  fineosm.setVerbosityLevel(0);
+  OSM coarseosm(euler,*assembler,coarsesolver);
+  coarseosm.setVerbosityLevel(0);
+  typedef OneStepPropagator<OSM,FS,BCType,Problem,G,V> PROPAGATOR;
+  PROPAGATOR fine(fineosm,fs,bctype,problem,g,dt);
+  PROPAGATOR coarse(coarseosm,fs,bctype,problem,g,dtcoarse);
+
+  // reference: sequential fine time stepping on the last group
+  const int J = groups.sliceCount();
+  const bool last = (groups.slice()+1==J);
+  const bool printer = last && grid.comm().rank()==0;
+  V xref(x0);
+  double sequential_time = 0.0;
+  if (last)
+    {
+      Dune::Timer watch;
+      V x(x0);
+      for (int j=0; j<J; j++)
+        {
+          const double t1 = (j+1==J) ? T : (j+1)*T/J;
+          fine.apply(j*T/J,t1,x,xref);
+          x = xref;
+        }
+      sequential_time = watch.elapsed();
+    }
+  groups.comm().barrier();
+
+  // Parareal
+  typedef Parareal<V,PROPAGATOR,PROPAGATOR> PARAREAL;
+  PARAREAL parareal(groups,fine,coarse,tol,J);
+  parareal.setVerbosityLevel(printer ? 1 : 0);
+  V x(x0);
+  parareal.apply(0.0,T,x0,x);
+  const double fine_time = groups.comm().max(parareal.fineTime());
+  const double coarse_time = groups.comm().max(parareal.coarseTime());
+
+  // accuracy at T against the exact solution and the sequential solution
+  if (last)
+    {
+      V xexact(fs.getGFS(),0.0);
+      problem.setTime(T);
+      Dune::PDELab::interpolate(g,fs.getGFS(),xexact);
+      V d(x);
+      d -= xexact;
+      const double error = grid.comm().max(d.infinity_norm());
+      d = xref;
+      d -= xexact;
+      const double referror = grid.comm().max(d.infinity_norm());
+      d = x;
+      d -= xref;
+      const double difference = grid.comm().max(d.infinity_norm());
+      if (printer)
+        {
+          const int K = parareal.iterationCount();
+          std::cout << "slices " << J << ", ranks per slice " << groups.groupSize()
+                    << ", iterations " << K << std::endl;
+          std::cout << "max error at T: parareal " << error << ", sequential " << referror
+                    << ", difference " << difference << std::endl;
+          std::cout << "wall time: parareal " << parareal.totalTime() << " s"
+                    << " (fine " << fine_time << " s, coarse " << coarse_time << " s)"
+                    << ", sequential " << sequential_time << " s" << std::endl;
+          std::cout << "speedup " << sequential_time/parareal.totalTime()
+                    << " (at most J/K = " << double(J)/K << ")" << std::endl;
+        }
+
+      // output of the final solution
+      Dune::SubsamplingVTKWriter<typename GM::LeafGridView> vtkwriter(grid.leafGridView(),degree-1);
+      typename FS::DGF xdgf(fs.getGFS(),x);
+      vtkwriter.addVertexData(new typename FS::VTKF(xdgf,"x_h"));
+      vtkwriter.write(basename,Dune::VTK::appendedraw);
+    }
+}
+
+//***********************************************************************
+//***********************************************************************
+// the main function
+//***********************************************************************
+//***********************************************************************
+
+int main(int argc, char **argv)
+{
+  // initialize MPI, finalize is done automatically on exit
+  Dune::MPIHelper& helper = Dune::MPIHelper::instance(argc,argv);
+
+  // read command line arguments
+  if (argc<5 || argc>7)
+    {
+      if (helper.rank()==0)
+        {
+          std::cout << "usage: " << argv[0] << " <T> <dt> <cells> <slices> [<dtcoarse>] [<tol>]" << std::endl;
+          std::cout << "the ranks are split into <slices> groups, one per time slice" << std::endl;
+          std::cout << "default dtcoarse is one step per slice, default tol 1e-6" << std::endl;
+        }
+      return 0;
+    }
+  double T; sscanf(argv[1],"%lg",&T);
+  double dt; sscanf(argv[2],"%lg",&dt);
+  int cells; sscanf(argv[3],"%d",&cells);
+  int slices; sscanf(argv[4],"%d",&slices);
+  double dtcoarse = T/slices;
+  if (argc>5) sscanf(argv[5],"%lg",&dtcoarse);
+  double tol = 1e-6;
+  if (argc>6) sscanf(argv[6],"%lg",&tol);
+
+  // start try/catch block to get error messages from dune
+  try {
+
+    const int dim=2;
+    const int degree=1;
+    const Dune::SolverCategory::Category solvertype = Dune::SolverCategory::overlapping;
+    const Dune::GeometryType::BasicType elemtype = Dune::GeometryType::cube;
+    const Dune::PDELab::MeshType meshtype = Dune::PDELab::MeshType::conforming;
+
+    // every group of ranks gets its own copy of the grid
+    PararealGroups groups(helper.getCommunicator(),slices);
+    typedef Dune::YaspGrid<dim> GM;
+    Dune::FieldVector<double,dim> L(1.0);
+    Dune::array<int,dim> N(Dune::fill_array<int,dim>(cells));
+    std::bitset<dim> periodic(false);
+    int overlap=1;
+    GM grid(groups.spaceComm(),L,N,periodic,overlap);
+
+    std::stringstream basename;
+    basename << "heat_parareal" << "_dim" << dim << "_degree" << degree;
+    do_parareal<GM,degree,elemtype,meshtype,solvertype>(T,dt,dtcoarse,tol,groups,grid,basename.str());
+  }
+  catch (std::exception & e) {
+    std::cout << "STL ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  catch (Dune::Exception & e) {
+    std::cout << "DUNE ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  catch (...) {
+    std::cout << "Unknown ERROR" << std::endl;
+    return 1;
+  }
+
+  // done
+  return 0;
+}
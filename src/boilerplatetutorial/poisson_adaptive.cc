@@ -3,9 +3,12 @@
 #include "config.h"
 #endif
 
+#include <dune/common/timer.hh>
 #include <dune/pdelab/boilerplate/pdelab.hh>
 #include <dune/pdelab/localoperator/convectiondiffusionfem.hh>
 
+#include "../utility/parallelmarking.hh"
+
 //***********************************************************************
 //***********************************************************************
 // define the reentrant corner in the L-domain with known exact solution
@@ -299,7 +302,7 @@ void ldomain_mesh (Factory& factory, Dune::GeometryType::BasicType elemtype)
 template<typename GM, unsigned int degree, Dune::GeometryType::BasicType elemtype,
          Dune::PDELab::MeshType meshtype, Dune::SolverCategory::Category solvertype>
 void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int maxsteps,
-             double fraction, std::string basename)
+             double fraction, std::string basename, bool nested)
 {
   // define parameters
   typedef double NumberType;
@@ -313,33 +316,56 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
   std::vector<double> ee;
   std::vector<int> N;
   std::vector<int> maxlevel;
+  std::vector<int> iterations;
+  std::vector<double> time;
+
+  // make problem parameters
+  typedef ReentrantCornerProblem<typename GM::LeafGridView,NumberType> Problem;
+  Problem problem;
+  typedef Dune::PDELab::ConvectionDiffusionBoundaryConditionAdapter<Problem> BCType;
+  BCType bctype(grid->leafGridView(),problem);
+
+  // make a finite element space and a degree of freedom vector; both
+  // live through the whole loop so that adapt_grid can transfer x
+  typedef Dune::PDELab::CGSpace<GM,NumberType,degree,BCType,elemtype,meshtype,solvertype> FS;
+  FS fs(*grid,bctype);
+  typedef typename FS::DOF X;
+  X x(fs.getGFS(),0.0);
+
+  // Nested iteration: on every level after the first, x is the solution of
+  // the previous level, whose algebraic error is already below the
+  // discretization error there. It suffices to reduce the defect by the
+  // factor by which the discretization error is expected to drop plus a
+  // safety factor, instead of a fixed 1e-8.
+  const double safety = 0.1;
+  const double full_reduction = 1e-8;
 
   // adaptive loop
+  Dune::Timer total_timer;
   for (int step=1; step<=maxsteps; step++)
     {
       std::cout << "*** adaptive step #" << step << std::endl;
+      Dune::Timer timer;
 
-      // make problem parameters
-      typedef ReentrantCornerProblem<typename GM::LeafGridView,NumberType> Problem;
-      Problem problem;
-      typedef Dune::PDELab::ConvectionDiffusionBoundaryConditionAdapter<Problem> BCType;
-      BCType bctype(grid->leafGridView(),problem);
-
-      // make a finite element space
-      typedef Dune::PDELab::CGSpace<GM,NumberType,degree,BCType,elemtype,meshtype,solvertype> FS;
-      FS fs(*grid,bctype);
       N.push_back(fs.getGFS().globalSize());
       maxlevel.push_back(grid->maxLevel());
 
-      // make a degree of freedom vector
-      typedef typename FS::DOF X;
-      X x(fs.getGFS(),0.0);
-
       // assemble constraints and Dirichlet BC
       fs.assembleConstraints(bctype);
       typedef Dune::PDELab::ConvectionDiffusionDirichletExtensionAdapter<Problem> G;
       G g(grid->leafGridView(),problem);
-      Dune::PDELab::interpolate(g,fs.getGFS(),x);
+      if (nested && step>1)
+        {
+          // keep the transferred solution, only the new constrained dofs get boundary values
+          X xg(fs.getGFS(),0.0);
+          Dune::PDELab::interpolate(g,fs.getGFS(),xg);
+          fs.copyConstrainedDOFS(xg,x);
+        }
+      else
+        {
+          x = 0.0;
+          Dune::PDELab::interpolate(g,fs.getGFS(),x);
+        }
 
       // assembler for finite elemenent problem
       typedef Dune::PDELab::ConvectionDiffusionFEM<Problem,typename FS::FEM> LOP;
@@ -354,8 +380,17 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
 
       // solve linear system in case of hanging nodes (this should go to StationaryLinearProblemSolver)
       typedef Dune::PDELab::StationaryLinearProblemSolver<typename ASS::GO,typename SBE::LS,X> SLP;
-      SLP slp(*ass,*sbe,x,1e-8);
+      double reduction = full_reduction;
+      if (nested && step>1)
+        {
+          // expected drop of the discretization error, taken from the last two levels
+          const double drop = (ee.size()>1) ? std::min(1.0,ee.back()/ee[ee.size()-2]) : 0.5;
+          reduction = std::max(full_reduction,safety*drop);
+        }
+      SLP slp(*ass,*sbe,x,reduction);
       slp.apply();
+      iterations.push_back(slp.ls_result().iterations);
+      time.push_back(timer.elapsed());
 
       // compute errors
       typename FS::DGF xdgf(fs.getGFS(),x);
@@ -384,7 +419,15 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
       typedef typename ESTFS::DOF Y;
       Y y(estfs.getGFS(),0.0);
       estass->residual(x,y);
-      NumberType estimated_error = sqrt(y.one_norm());
+      // sum over the interior elements of all ranks, overlap and ghost cells are not counted twice
+      typedef typename GM::LeafGridView::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+        InteriorIterator;
+      const typename GM::LeafGridView gv = grid->leafGridView();
+      NumberType eta_sum = 0.0;
+      for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+           it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+        eta_sum += (y.base())[gv.indexSet().index(*it)];
+      NumberType estimated_error = sqrt(gv.comm().sum(eta_sum));
       std::cout << "estimated error = " << estimated_error << std::endl;
       ee.push_back(estimated_error);
 
@@ -404,8 +447,8 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
 
       // mark elements for refinement
       NumberType eta_refine, eta_coarsen;
-      Dune::PDELab::error_fraction(y,fraction,0.0,eta_refine,eta_coarsen);
-      Dune::PDELab::mark_grid(*grid,y,eta_refine,eta_coarsen);
+      parallel_error_fraction(gv,y,fraction,0.0,eta_refine,eta_coarsen);
+      parallel_mark_grid(*grid,y,eta_refine,eta_coarsen);
 
       // do refinement
       Dune::PDELab::adapt_grid(*grid,fs.getGFS(),x,2*degree);
@@ -413,7 +456,9 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
 
   // print results
   //  std::cout << "Results on mesh=" << filename_base << std::endl;
-  std::cout << "#step N maxlevel l2 l2rate h1semi h1semirate estimator effectivity" << std::endl;
+  std::cout << "# " << (nested ? "nested iteration" : "solve from scratch on every level")
+            << ", total time " << total_timer.elapsed() << " s" << std::endl;
+  std::cout << "#step N maxlevel IT time l2 l2rate h1semi h1semirate estimator effectivity" << std::endl;
   for (std::size_t i=0; i<N.size(); i++)
     {
       double rate1=0.0;
@@ -423,6 +468,8 @@ void driver (Dune::shared_ptr<GM> grid, int prerefine_level, double tol, int max
       std::cout << std::setw(10) << i
                 << std::setw(10) << N[i]
                 << std::setw(10) << maxlevel[i]
+                << std::setw(6) << iterations[i]
+                << std::setw(12) << std::setprecision(4) << std::scientific << time[i]
                 << std::setw(12) << std::setprecision(4) << std::scientific << l2[i]
                 << std::setw(12) << std::setprecision(4) << std::scientific << rate1
                 << std::setw(12) << std::setprecision(4) << std::scientific << h1s[i]
@@ -443,15 +490,17 @@ int main(int argc, char **argv)
   try {
 
     // read command line arguments
-    if (argc<7 || argc>8)
+    if (argc<7 || argc>9)
       {
-        std::cout << "usage: " << argv[0] << " <mode> <degree> <start level> <TOL> <max steps> <fraction> [<basename>]" << std::endl;
+        std::cout << "usage: " << argv[0] << " <mode> <degree> <start level> <TOL> <max steps> <fraction> [<basename>] [nested|scratch]" << std::endl;
         std::cout << "mode=1 Alberta" << std::endl;
         std::cout << "mode=2 UG conforming" << std::endl;
         std::cout << "mode=3 ALUSimplex" << std::endl;
         std::cout << "mode=4 UG quads nonconforming" << std::endl;
         std::cout << "degree polynomial degree for conforming calculation: 1,2,3,4" << std::endl;
         std::cout << "basename for output (optional)" << std::endl;
+        std::cout << "nested: start each level from the previous solution with a solver tolerance" << std::endl;
+        std::cout << "        tied to the estimated error (default); scratch: solve every level to 1e-8" << std::endl;
         return 0;
       }
     int mode; sscanf(argv[1],"%d",&mode);
@@ -461,10 +510,13 @@ int main(int argc, char **argv)
     int maxsteps; sscanf(argv[5],"%d",&maxsteps);
     double fraction; sscanf(argv[6],"%lg",&fraction);
     char bn[129];
-    if (argc==8)
+    if (argc>=8)
       sscanf(argv[7],"%s",bn);
     else
       sscanf("ldomain","%s",bn);
+    bool nested = true;
+    if (argc==9)
+      nested = std::string(argv[8])!="scratch";
 
     const int dim=2;
     const Dune::SolverCategory::Category solvertype = Dune::SolverCategory::sequential;
@@ -481,10 +533,10 @@ int main(int argc, char **argv)
         std::stringstream basename;
         basename << bn << "_alberta_P" << degree;
 
-        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==2) driver<GM,2,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==3) driver<GM,3,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==4) driver<GM,4,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str());
+        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==2) driver<GM,2,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==3) driver<GM,3,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==4) driver<GM,4,elemtype,meshtype,solvertype>(grid,dim*start_level,TOL,maxsteps,fraction,basename.str(),nested);
       }
 #endif
 
@@ -501,10 +553,10 @@ int main(int argc, char **argv)
         std::stringstream basename;
         basename << bn << "_ug_conforming_P" << degree;
 
-        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==2) driver<GM,2,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==3) driver<GM,3,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
-        if (degree==4) driver<GM,4,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
+        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==2) driver<GM,2,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==3) driver<GM,3,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
+        if (degree==4) driver<GM,4,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
       }
     if (mode==4)
       {
@@ -520,7 +572,7 @@ int main(int argc, char **argv)
         std::stringstream basename;
         basename << bn << "_ug_conforming_Q1";
 
-        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
+        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
       }
 #endif
 
@@ -536,7 +588,7 @@ int main(int argc, char **argv)
         std::stringstream basename;
         basename << bn << "_alu_nonconforming_P1";
 
-        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str());
+        if (degree==1) driver<GM,1,elemtype,meshtype,solvertype>(grid,start_level,TOL,maxsteps,fraction,basename.str(),nested);
       }
 #endif
   }
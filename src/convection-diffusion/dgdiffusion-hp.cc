@@ -5,7 +5,12 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include<algorithm>
+#include<functional>
 #include<iostream>
+#include<memory>
+#include<sstream>
+#include<string>
 #include<vector>
 #include<map>
 #include<dune/common/parallel/mpihelper.hh>
@@ -13,6 +18,10 @@
 #include<dune/common/fvector.hh>
 #include<dune/common/timer.hh>
 #include<dune/grid/yaspgrid.hh>
+#if HAVE_UG
+#include<dune/grid/uggrid.hh>
+#include<dune/grid/utility/structuredgridfactory.hh>
+#endif
 #include<dune/istl/bvector.hh>
 #include<dune/istl/operators.hh>
 #include<dune/istl/solvers.hh>
@@ -29,6 +38,7 @@
 #include<dune/pdelab/gridfunctionspace/interpolate.hh>
 #include<dune/pdelab/constraints/common/constraints.hh>
 #include<dune/pdelab/constraints/common/constraintsparameters.hh>
+#include<dune/pdelab/constraints/p0ghost.hh>
 #include<dune/pdelab/common/function.hh>
 #include<dune/pdelab/common/vtkexport.hh>
 #include<dune/pdelab/backend/istl.hh>
@@ -36,6 +46,10 @@
 #include<dune/pdelab/stationary/linearproblem.hh>
 #include<dune/pdelab/gridoperator/gridoperator.hh>
 
+#include"../utility/legendresmoothness.hh"
+#include"../utility/loadbalancing.hh"
+#include"../utility/pmultigrid.hh"
+
 // Select Problem
 #include"problemA.hh"  // exp(-norm(x,y))
 #include"problemB.hh"  // Like problem A but corners have small parts with Neumann boundary
@@ -55,12 +69,16 @@ static const int monom_max_order = 5;
 #define MAKE_VTK_OUTPUT
 //#define CALCULATE_L2_ERROR
 //#define CALCULATE_ABSOLUTE_ERROR
-#define USE_SUPER_LU
+//#define USE_SUPER_LU   // default is BiCGStab with p-multigrid
 //#define REFINE_STEPWISE
+#define P_ADAPTIVE_STEPS 4      // 0: fixed bands of polynomial degree
+#define P_ADAPTIVE_FRACTION 0.3 // fraction of elements whose degree is raised
 
-// Solve the given problem with OBB, NIPG or SIPG
+// Solve the given problem with OBB, NIPG or SIPG; eta returns the p-adaptivity
+// indicator per element (norm of the highest Legendre modes of the solution)
 template<class GV, class FEM>
-void solve_dg (const GV& gv, const FEM& fem, std::string filename, const bool verbose)
+void solve_dg (const GV& gv, const FEM& fem, std::string filename, const bool verbose,
+               std::vector<double>& eta)
 {
   typedef double Real;
     typedef double RF;
@@ -128,19 +146,39 @@ void solve_dg (const GV& gv, const FEM& fem, std::string filename, const bool ve
     typedef typename GO::Traits::Domain V;
     V solution(gfs,0.0);
 
-    //Warning: Iterative solver does not work. Please use SuperLU here!
-    //typedef Dune::PDELab::ISTLBackend_SEQ_BCGS_ILU0 LS;
-    //LS ls(10000,2);
+    // One-level preconditioners (ILU0, SSOR) stagnate on the variable degree
+    // DG system; p-multigrid with element block smoothers does converge. Its
+    // coarsest level is P1 for OBB, which is not stable with piecewise
+    // constants, and P0 otherwise.
+#ifdef USE_SUPER_LU
     typedef Dune::PDELab::ISTLBackend_SEQ_SuperLU LS;
     LS ls(1);
+#else
+    typedef ISTLBackend_SEQ_BCGS_PMG<GFS> LS;
+    LS ls(gfs,(DG_METHOD==0) ? 1 : 0,5000,verbose ? 1 : 0);
+#endif
+    watch.reset();
     typedef Dune::PDELab::StationaryLinearProblemSolver<GO,LS,V> SLP;
     SLP slp(go,ls,solution,1e-12);
     slp.apply();
+    if (verbose)
+    {
+        std::cout << "=== dofs " << gfs.globalSize()
+                  << " iterations " << slp.ls_result().iterations
+                  << " solve " << watch.elapsed() << " s" << std::endl;
+    }
 
     // make discrete function object
     typedef Dune::PDELab::DiscreteGridFunction<GFS,V> DGF;
     DGF dgf(gfs,solution);
 
+    // p-adaptivity indicator
+    LegendreSmoothnessIndicator<DGF> legendre(dgf,monom_max_order);
+    eta.assign(gv.size(0),0.0);
+    for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+         it!=gv.template end<0>(); ++it)
+        eta[gv.indexSet().index(*it)] = legendre.tail(*it,fem.getOrder(*it));
+
 #ifdef MAKE_VTK_OUTPUT
     // output grid function with SubsamplingVTKWriter
     //KType<GV,RF> k2(gv);
@@ -152,6 +190,126 @@ void solve_dg (const GV& gv, const FEM& fem, std::string filename, const bool ve
 #endif
 }
 
+// raise the degree on the given fraction of the elements with the largest
+// indicators among those that have not reached monom_max_order yet
+template<class GV, class FEM>
+void raise_order (const GV& gv, FEM& fem, const std::vector<double>& eta, double fraction)
+{
+    typedef typename GV::template Codim<0>::Iterator Iterator;
+    std::vector<double> candidates;
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+        if (fem.getOrder(*it)<unsigned(monom_max_order))
+            candidates.push_back(eta[gv.indexSet().index(*it)]);
+    if (candidates.empty()) return;
+
+    const std::size_t n = std::max(std::size_t(1),std::size_t(fraction*candidates.size()));
+    std::nth_element(candidates.begin(),candidates.begin()+(n-1),candidates.end(),
+                     std::greater<double>());
+    const double threshold = candidates[n-1];
+
+    int raised = 0;
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+        if (fem.getOrder(*it)<unsigned(monom_max_order) && eta[gv.indexSet().index(*it)]>=threshold)
+        {
+            fem.setOrder(*it,fem.getOrder(*it)+1);
+            raised++;
+        }
+    std::cout << "=== raised polynomial degree on " << raised << " elements" << std::endl;
+}
+
+// polynomial degree increasing in bands from 2 to monom_max_order in y
+// direction; it only depends on the position, so the degree of an element
+// stays the same when the element changes its rank
+template<class E>
+unsigned int band_order (const E& e)
+{
+    const double y = e.geometry().center()[1];
+    return 2 + std::min(monom_max_order-2,int(y*(monom_max_order-1)));
+}
+
+// Distribute the grid with recursive coordinate or inertial bisection,
+// either by the number of elements or by the element cost, and solve the
+// problem in parallel. Returns the time to solution (assembly and solve).
+template<class Grid>
+double solve_dg_balanced (Grid& grid, bool weighted, bool inertial)
+{
+    typedef double Real;
+    typedef double RF;
+    typedef typename Grid::LeafGridView GV;
+    const int dim = GV::dimension;
+    typedef Dune::SingleCodimSingleGeomTypeMapper<GV,0> CellMapper;
+    typedef Dune::PDELab::VariableMonomLocalFiniteElementMap<
+        CellMapper,double,double,dim,monom_max_order> FEM;
+    typedef Dune::PDELab::P0ParallelGhostConstraints CON;
+    typedef Dune::PDELab::ISTLVectorBackend<Dune::PDELab::ISTLParameters::static_blocking,BLOCK_SIZE> VBE;
+    typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+
+    // partition; the cost of an element is the size of its diagonal matrix block
+    {
+        GV gv = grid.leafGridView();
+        CellMapper cellmapper(gv);
+        FEM fem(cellmapper,2);
+        for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+             it!=gv.template end<0>(); ++it)
+            fem.setOrder(*it,band_order(*it));
+        GFS gfs(gv,fem);
+        std::vector<double> weights = dof_weights(gfs,weighted ? 2.0 : 0.0);
+        grid.loadBalance(recursive_bisection(gv,weights,inertial),0);
+    }
+
+    GV gv = grid.leafGridView();
+    CellMapper cellmapper(gv);
+    FEM fem(cellmapper,2);
+    for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+         it!=gv.template end<0>(); ++it)
+        fem.setOrder(*it,band_order(*it));
+    GFS gfs(gv,fem);
+    const double cost_imbalance = imbalance(gv,dof_weights(gfs,2.0));
+
+    Dune::Timer watch;
+
+    // checkerboard permeability (problem C)
+    typedef K_C<GV,RF> KType;
+    typedef F_C<GV,RF> FType;
+    typedef BCTypeParam_C BType;
+    typedef G_C<GV,RF> GType;
+    typedef J_C<GV,RF> JType;
+    KType k(gv);
+    FType f(gv);
+    BType bctype;
+    GType g(gv);
+    JType j(gv);
+
+    // ghost elements are constrained, so the overlapping solvers apply
+    typedef typename GFS::template ConstraintsContainer<Real>::Type CC;
+    CC cc;
+    Dune::PDELab::constraints(gfs,cc,false);
+
+    typedef Dune::PDELab::DiffusionDG<KType,FType,BType,GType,JType> LOP;
+    LOP lop(k,f,bctype,g,j,DG_METHOD);
+    typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+    MBE mbe(27);
+    typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+    GO go(gfs,cc,gfs,cc,lop,mbe);
+    typedef typename GO::Traits::Domain V;
+    V solution(gfs,0.0);
+
+    // block Jacobi with exact subdomain solves, the parallel analogue of SuperLU
+    typedef Dune::PDELab::ISTLBackend_OVLP_BCGS_SuperLU<GFS,CC> LS;
+    LS ls(gfs,cc,5000,0);
+    typedef Dune::PDELab::StationaryLinearProblemSolver<GO,LS,V> SLP;
+    SLP slp(go,ls,solution,1e-10);
+    slp.apply();
+    const double time = gv.comm().max(watch.elapsed());
+
+    if (gv.comm().rank()==0)
+        std::cout << (weighted ? "cost weighted " : "element count ")
+                  << " imbalance=" << cost_imbalance
+                  << " iterations=" << slp.ls_result().iterations
+                  << " time to solution=" << time << " s" << std::endl;
+    return time;
+}
+
 int main(int argc, char** argv)
 {
     //Maybe initialize Mpi
@@ -164,8 +322,50 @@ int main(int argc, char** argv)
             std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
     }
 
+    // partitioner of the parallel run: recursive coordinate (rcb) or
+    // inertial (rib) bisection
+    if (argc>2)
+    {
+        if(helper.rank()==0)
+            std::cout << "usage: ./dgdiffusion-hp [rcb|rib]" << std::endl;
+        return 1;
+    }
+    const bool inertial = (argc>1 && std::string(argv[1])=="rib");
+    if (argc>1 && !inertial && std::string(argv[1])!="rcb")
+    {
+        if(helper.rank()==0)
+            std::cout << "unknown partitioner " << argv[1] << ", use rcb or rib" << std::endl;
+        return 1;
+    }
+
     try
     {
+        // 2D, parallel: compare element count and cost weighted partitions
+        if (helper.size()>1)
+        {
+#if HAVE_UG && HAVE_SUPERLU
+            const int dim=2;
+            typedef Dune::UGGrid<dim> Grid;
+            Dune::FieldVector<Grid::ctype,dim> ll(0.0);
+            Dune::FieldVector<Grid::ctype,dim> ur(1.0);
+            std::array<unsigned int,dim> elements;
+            std::fill(elements.begin(),elements.end(),32);
+            double time[2];
+            for (int weighted=0; weighted<2; weighted++)
+            {
+                std::shared_ptr<Grid> grid = Dune::StructuredGridFactory<Grid>::createCubeGrid(ll,ur,elements);
+                grid->loadBalance();
+                time[weighted] = solve_dg_balanced(*grid,weighted==1,inertial);
+            }
+            if (helper.rank()==0)
+                std::cout << "speedup of cost weighted partition: " << time[0]/time[1] << std::endl;
+#else
+            if (helper.rank()==0)
+                std::cout << "The parallel run requires UG and SuperLU!" << std::endl;
+#endif
+            return 0;
+        }
+
         // 2D
         {
             // make grid
@@ -191,6 +391,18 @@ int main(int argc, char** argv)
                 CellMapper,double,double,2,monom_max_order> FEM;
             FEM fem(cellmapper, 2); // works only for cubes
 
+#if P_ADAPTIVE_STEPS>0
+            // start with degree 2 and raise it where the solution is not resolved
+            for (int step=0; step<=P_ADAPTIVE_STEPS; ++step)
+            {
+                std::stringstream filename;
+                filename << "DG_Yasp_2d_p" << step;
+                std::vector<double> eta;
+                solve_dg(grid.leafGridView(),fem,filename.str(),true,eta);
+                if (step<P_ADAPTIVE_STEPS)
+                    raise_order(grid.leafGridView(),fem,eta,P_ADAPTIVE_FRACTION);
+            }
+#else
             // set polynomial order per element
             unsigned int range = std::ceil( double(cellmapper.size()) / (monom_max_order-1) );
             for (Grid::LeafGridView::Codim<0>::Iterator it = grid.leafGridView().begin<0>(), end = grid.leafGridView().end<0>();
@@ -200,7 +412,9 @@ int main(int argc, char** argv)
             }
 
             // solve problem :)
-            solve_dg(grid.leafGridView(),fem,"DG_Yasp_2d",true);
+            std::vector<double> eta;
+            solve_dg(grid.leafGridView(),fem,"DG_Yasp_2d",true,eta);
+#endif
 #endif
         }
 
@@ -0,0 +1,350 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+/** \file
+    \brief hp-adaptive discontinuous Galerkin method for the reentrant corner problem
+
+    Cells marked by the DG error indicator are either p-enriched or
+    h-refined. The choice is made from the decay of the Legendre
+    coefficients of the local solution: where the solution is smooth the
+    degree is raised, near the singularity the cell is refined.
+*/
+#ifdef HAVE_CONFIG_H
+#include "config.h"           // file constructed by ./configure script
+#endif
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <dune/common/parallel/mpihelper.hh> // include mpi helper class
+#include <dune/common/parametertree.hh>
+#include <dune/common/parametertreeparser.hh>
+
+#include <dune/grid/io/file/vtk/subsamplingvtkwriter.hh>
+#include <dune/grid/common/scsgmapper.hh>
+
+#if HAVE_UG
+#include <dune/grid/uggrid.hh>
+#endif
+
+#include<dune/istl/bvector.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/io.hh>
+#include<dune/istl/superlu.hh>
+#include <dune/pdelab/common/function.hh>
+#include <dune/pdelab/common/functionutilities.hh>
+#include <dune/pdelab/common/vtkexport.hh>
+#include <dune/pdelab/backend/istl.hh>
+#include <dune/pdelab/gridfunctionspace/gridfunctionspace.hh>
+#include <dune/pdelab/gridfunctionspace/gridfunctionspaceutilities.hh>
+#include <dune/pdelab/gridfunctionspace/interpolate.hh>
+#include <dune/pdelab/constraints/common/constraints.hh>
+#include <dune/pdelab/gridoperator/gridoperator.hh>
+#include<dune/pdelab/finiteelementmap/p0fem.hh>
+#include<dune/pdelab/finiteelementmap/variablemonomfem.hh>
+#include<dune/pdelab/localoperator/convectiondiffusionparameter.hh>
+#include<dune/pdelab/localoperator/convectiondiffusiondg.hh>
+#include<dune/pdelab/localoperator/errorindicatordg.hh>
+
+#include<dune/pdelab/stationary/linearproblem.hh>
+
+#include<dune/pdelab/adaptivity/adaptivity.hh>
+
+#include"../utility/gridexamples.hh"
+#include"../utility/legendresmoothness.hh"
+
+#include "reentrantcornerproblem.hh"
+
+// highest polynomial degree used in p-enrichment
+static const int hp_max_order = 6;
+
+//! polynomial degree of e, inherited from the closest ancestor if e is new
+template<typename IdSet, typename OrderMap, typename Element>
+unsigned int inheritedOrder (const IdSet& idset, const OrderMap& orders,
+                             const Element& e, unsigned int defaultorder)
+{
+  typename OrderMap::const_iterator o = orders.find(idset.id(e));
+  Element f(e);
+  while (o==orders.end() && f.hasFather())
+    {
+      f = f.father();
+      o = orders.find(idset.id(f));
+    }
+  return (o==orders.end()) ? defaultorder : o->second;
+}
+
+//! Solve problem on leaf grid view and adapt grid and polynomial degrees
+template<typename Grid>
+void driverHP (Grid& grid, const Dune::ParameterTree& configuration)
+{
+  int verbose = configuration.get<int>("general.verbose");
+  int strategy = configuration.get<int>("adaptivity.strategy");
+  std::stringstream vtu;
+  vtu << "dghpldomain_s" << strategy;
+  std::string filename_base (vtu.str());
+
+  // some types
+  typedef typename Grid::LeafGridView GV;
+  typedef typename Grid::ctype Coord;
+  typedef double Real;
+  const int dim = GV::dimension;
+  typedef typename GV::template Codim<0>::Iterator ElementIterator;
+  typedef typename Grid::LocalIdSet IdSet;
+  typedef std::map<typename IdSet::IdType,unsigned int> OrderMap;
+  const IdSet& idset = grid.localIdSet();
+
+  typedef ReentrantCornerProblem<GV,Real> Problem;
+  Problem problem;
+  typedef Dune::PDELab::ConvectionDiffusionDirichletExtensionAdapter<Problem> ESOL;
+
+  // some arrays to store results
+  std::vector<double> l2;
+  std::vector<double> h1s;
+  std::vector<double> ee;
+  std::vector<int> N;
+  std::vector<int> nH, nP; // cells refined in h and enriched in p
+
+  // some local operator parameters
+  double alpha = 2.0;
+  Dune::PDELab::ConvectionDiffusionDGMethod::Type m
+    = Dune::PDELab::ConvectionDiffusionDGMethod::SIPG;
+  Dune::PDELab::ConvectionDiffusionDGWeights::Type w
+    = Dune::PDELab::ConvectionDiffusionDGWeights::weightsOn;
+
+  int maxsteps = configuration.get<int>("adaptivity.maxsteps");
+  double TOL = configuration.get<double>("adaptivity.TOL");
+  double refinementfraction = configuration.get<double>("adaptivity.refinementfraction");
+  const unsigned int initialorder = configuration.get<int>("hp.initialorder");
+  const double sigma0 = configuration.get<double>("hp.smoothness");
+
+  // polynomial degree per element id; survives adaptation of the grid,
+  // new elements take the degree of their parent
+  OrderMap orders;
+
+  // refinement loop
+  for (int step=0; step<maxsteps; step++)
+    {
+      std::cout << "***************************************" << std::endl;
+      std::cout << "hp-Refinement Step " << step << std::endl;
+      std::cout << "***************************************" << std::endl;
+
+      // get current leaf view
+      const GV& gv=grid.leafGridView();
+
+      // the finite element map stores the degrees by cell index, so it is
+      // set up again on every grid
+      typedef Dune::SingleCodimSingleGeomTypeMapper<GV,0> CellMapper;
+      CellMapper cellmapper(gv);
+      typedef Dune::PDELab::VariableMonomLocalFiniteElementMap
+        <CellMapper,Coord,Real,dim,hp_max_order> FEM;
+      FEM fem(cellmapper,initialorder);
+      for (ElementIterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+        fem.setOrder(*it,inheritedOrder(idset,orders,*it,initialorder));
+
+      // make grid function space
+      typedef Dune::PDELab::NoConstraints CON;
+      typedef Dune::PDELab::istl::VectorBackend<> VBE;
+      typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+      GFS gfs(gv,fem);
+      typedef typename GFS::template ConstraintsContainer<Real>::Type CC;
+      CC cc;
+      N.push_back(gfs.globalSize());
+
+      // make local operator
+      typedef Dune::PDELab::ConvectionDiffusionDG<Problem,FEM> LOP;
+      LOP lop(problem,m,w,alpha);
+      typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+      // 5 cells with 6 monomials of degree 2; hanging nodes and higher
+      // degrees use the overflow area
+      MBE mbe(30);
+      typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+      GO go(gfs,cc,gfs,cc,lop,mbe);
+
+      // make linear solver and solve problem; the monomial basis gets
+      // badly conditioned for higher degrees, so use a direct solver
+      using U = Dune::PDELab::Backend::Vector<GFS,Real>;
+      U u(gfs,0.0);
+      typedef Dune::PDELab::ISTLBackend_SEQ_SuperLU LS;
+      LS ls(verbose);
+      typedef Dune::PDELab::StationaryLinearProblemSolver<GO,LS,U> SLP;
+      double reduction = configuration.get<double>("istl.reduction");
+      SLP slp(go,ls,u,reduction);
+      slp.apply();
+
+      // compute errors
+      ESOL exactsolution(gv,problem);
+      typedef Dune::PDELab::DiscreteGridFunction<GFS,U> DGF;
+      DGF udgf(gfs,u);
+      typedef DifferenceSquaredAdapter<ESOL,DGF> DifferenceSquared;
+      DifferenceSquared differencesquared(exactsolution,udgf);
+      typename DifferenceSquared::Traits::RangeType l2errorsquared(0.0);
+      Dune::PDELab::integrateGridFunction(differencesquared,l2errorsquared,2*hp_max_order);
+      l2.push_back(sqrt(l2errorsquared));
+      typedef Dune::PDELab::DiscreteGridFunctionGradient<GFS,U> DGFGrad;
+      DGFGrad udgfgrad(gfs,u);
+      typedef ExactGradient<GV,Real> Grad;
+      Grad grad(gv);
+      typedef DifferenceSquaredAdapter<Grad,DGFGrad> GradDifferenceSquared;
+      GradDifferenceSquared graddifferencesquared(grad,udgfgrad);
+      typename GradDifferenceSquared::Traits::RangeType h1semierrorsquared(0.0);
+      Dune::PDELab::integrateGridFunction(graddifferencesquared,h1semierrorsquared,2*hp_max_order);
+      h1s.push_back(sqrt(h1semierrorsquared));
+
+      // compute estimated error
+      typedef Dune::PDELab::P0LocalFiniteElementMap<Coord,Real,dim> P0FEM;
+      Dune::GeometryType gt;
+      gt.makeCube(dim);
+      P0FEM p0fem(gt);
+      typedef Dune::PDELab::GridFunctionSpace<GV,P0FEM,Dune::PDELab::NoConstraints,VBE> P0GFS;
+      P0GFS p0gfs(gv,p0fem);
+      typedef Dune::PDELab::ConvectionDiffusionDG_ErrorIndicator<Problem> ESTLOP;
+      ESTLOP estlop(problem,m,w,alpha);
+      typedef Dune::PDELab::EmptyTransformation NoTrafo;
+      typedef Dune::PDELab::GridOperator<GFS,P0GFS,ESTLOP,MBE,Real,Real,Real,NoTrafo,NoTrafo> ESTGO;
+      ESTGO estgo(gfs,p0gfs,estlop,mbe);
+      using U0 = Dune::PDELab::Backend::Vector<P0GFS,Real>;
+      U0 eta(p0gfs,0.0);
+      estgo.residual(u,eta);
+      for( typename U0::iterator it = eta.begin(), end = eta.end();
+           it != end; ++it )
+        *it = sqrt(*it);
+      Real estimated_error = eta.two_norm();
+      ee.push_back(estimated_error);
+
+      // write vtk file
+      typedef Dune::PDELab::DiscreteGridFunction<P0GFS,U0> DGF0;
+      DGF0 udgf0(p0gfs,eta);
+      Dune::SubsamplingVTKWriter<GV> vtkwriter(gv,2);
+      std::stringstream fullname;
+      fullname << "vtk/" << filename_base << "_step" << step;
+      vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<DGF> >(udgf,"u_h"));
+      vtkwriter.addCellData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<DGF0> >(udgf0,"estimated error"));
+      vtkwriter.addCellData(std::make_shared<Dune::PDELab::VTKFiniteElementMapAdapter<GV,FEM> >(fem,"fem order"));
+      vtkwriter.write(fullname.str(),Dune::VTK::appendedraw);
+
+      // error control
+      if (estimated_error <= TOL || step==maxsteps-1)
+        {
+          nH.push_back(0); nP.push_back(0);
+          break;
+        }
+
+      // select the cells to adapt
+      double alpha_r(refinementfraction);
+      double refine_threshold(0);
+      double beta_c(0);       // no coarsening here
+      double eta_beta(0);     // dummy
+      if( strategy == 1)
+        error_fraction( eta, alpha_r, beta_c, refine_threshold, eta_beta, verbose );
+      else
+        element_fraction( eta, alpha_r, beta_c, refine_threshold, eta_beta, verbose );
+
+      // decide between p-enrichment and h-refinement for each selected cell
+      LegendreSmoothnessIndicator<DGF> smoothness(udgf,hp_max_order);
+      int refined = 0, enriched = 0;
+      for (ElementIterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+        {
+          const unsigned int p = fem.getOrder(*it);
+          orders[idset.id(*it)] = p;
+          if (Dune::PDELab::Backend::native(eta)[gv.indexSet().index(*it)] < refine_threshold)
+            continue;
+          if (p<static_cast<unsigned int>(hp_max_order) && smoothness.decay(*it,p)>sigma0)
+            {
+              orders[idset.id(*it)] = p+1;
+              enriched++;
+            }
+          else
+            {
+              grid.mark(1,*it);
+              refined++;
+            }
+        }
+      nH.push_back(refined);
+      nP.push_back(enriched);
+
+      // adapt grid; the solution is not transferred since the next
+      // space has different degrees anyway and the solve is direct
+      grid.preAdapt();
+      grid.adapt();
+      grid.postAdapt();
+    }
+
+  // print results; exponential convergence shows up as a straight line
+  // of log(error) over N^(1/3)
+  std::cout << "Results for hp-DG with degrees " << initialorder << ".." << hp_max_order
+            << " and smoothness threshold " << sigma0 << std::endl;
+  std::cout << "           N"
+            << "   N^(1/3)"
+            << "     h"
+            << "     p"
+            << "          l2"
+            << "      h1semi"
+            << "   estimator"
+            << " effectivity" << std::endl;
+  for (std::size_t i=0; i<N.size(); i++)
+    {
+      std::cout << std::setw(3) << i
+                << std::setw(9) << N[i]
+                << std::setw(10) << std::setprecision(4) << std::fixed << std::pow(double(N[i]),1.0/3.0)
+                << std::setw(6) << nH[i]
+                << std::setw(6) << nP[i]
+                << std::setw(12) << std::setprecision(4) << std::scientific << l2[i]
+                << std::setw(12) << std::setprecision(4) << std::scientific << h1s[i]
+                << std::setw(12) << std::setprecision(4) << std::scientific << ee[i]
+                << std::setw(12) << std::setprecision(4) << std::scientific << ee[i]/(h1s[i])
+                << std::endl;
+    }
+
+  std::cout << "View results using: \n paraview --data=vtk/" << vtu.str() << "_step..vtu" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  // initialize MPI, finalize is done automatically on exit
+  Dune::MPIHelper::instance(argc,argv);
+
+  // start try/catch block to get error messages from dune
+  try {
+
+    std::string config_file("ldomain.ini");
+    Dune::ParameterTree configuration;
+    Dune::ParameterTreeParser parser;
+    try{
+      parser.readINITree( config_file, configuration );
+    }
+    catch(...){
+      std::cerr << "Could not read config file \""
+                << config_file << "\"!" << std::endl;
+      exit(1);
+    }
+
+#if HAVE_UG
+    // the smoothness indicator works on the reference cube, so use the
+    // L-shaped domain with quadrilaterals and hanging nodes
+    const int dim=2;
+    typedef UGLDomainCubes GridType;
+    GridType grid(configuration.get<int>("ug.heapsize"));
+    grid.setClosureType( Dune::UGGrid<dim>::NONE );
+    grid.globalRefine( configuration.get<int>("grid.baselevel") );
+    driverHP<GridType>(grid,configuration);
+#else
+    std::cout << "This example requires UG!" << std::endl;
+#endif
+  }
+  catch (std::exception & e) {
+    std::cout << "STL ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  catch (Dune::Exception & e) {
+    std::cout << "DUNE ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  catch (...) {
+    std::cout << "Unknown ERROR" << std::endl;
+    return 1;
+  }
+
+  // done
+  return 0;
+}
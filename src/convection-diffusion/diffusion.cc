@@ -54,6 +54,8 @@
 
 #include<dune/pdelab/gridfunctionspace/vtk.hh>
 
+#include"../utility/batchedassembler.hh"
+
 
 //===============================================================
 // Choose among one of the problems A-F here:
@@ -263,6 +265,106 @@ void runFEM (const GV& gv, const FEM& fem, PROBLEM& problem, std::string basenam
     }
 }
 
+//! solve problem with P1/Q1 FEM, volume terms assembled in batches of elements
+template<class GV, class FEM, class PROBLEM>
+void runBatchedFEM (const GV& gv, const FEM& fem, PROBLEM& problem, std::string basename, int level)
+{
+  // coordinate and result type
+  typedef typename FEM::Traits::FiniteElementType::Traits::LocalBasisType::Traits::RangeFieldType Real;
+  const int dim = GV::Grid::dimension;
+  std::stringstream fullname;
+  fullname << "vtk/" << basename << "_BATCHED" << "_k1" << "_dim" << dim << "_level" << level;
+
+  // make grid function space
+  typedef Dune::PDELab::istl::VectorBackend<> VBE;
+  typedef Dune::PDELab::ConformingDirichletConstraints CON;
+  typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+  GFS gfs(gv,fem);
+
+  // make constraints container
+  typedef typename GFS::template ConstraintsContainer<Real>::Type CC;
+  CC cc;
+  Dune::PDELab::ConvectionDiffusionBoundaryConditionAdapter<PROBLEM> bctype(gv,problem);
+  Dune::PDELab::constraints(bctype,gfs,cc);
+
+  // standard grid operator, only used for comparison
+  typedef Dune::PDELab::ConvectionDiffusionFEM<PROBLEM,FEM> LOP;
+  LOP lop(problem);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(5); // Maximal number of nonzeroes per row can be cross-checked by patternStatistics().
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+  GO go(gfs,cc,gfs,cc,lop,mbe);
+
+  // boundary terms through a grid operator, volume terms in batches
+  typedef BoundaryOnlyLocalOperator<LOP> BLOP;
+  BLOP blop(problem);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,BLOP,MBE,Real,Real,Real,CC,CC> BGO;
+  BGO bgo(gfs,cc,gfs,cc,blop,mbe);
+  Dune::Timer timer;
+  typedef BatchedAssembler<GFS,CC,PROBLEM> BA;
+  BA ba(gfs,cc,problem);
+  double t_setup = timer.elapsed();
+
+  // make a vector of degree of freedom vectors and initialize it with Dirichlet extension
+  typedef typename GO::Traits::Domain U;
+  U u(gfs,0.0);
+  typedef Dune::PDELab::ConvectionDiffusionDirichletExtensionAdapter<PROBLEM> G;
+  G g(gv,problem);
+  Dune::PDELab::interpolate(g,gfs,u);
+  Dune::PDELab::set_nonconstrained_dofs(cc,0.0,u);
+
+  // assemble the matrix both ways
+  typedef typename GO::Traits::Jacobian M;
+  M m(go);
+  timer.reset();
+  m = 0.0;
+  go.jacobian(u,m);
+  double t_standard = timer.elapsed();
+  typedef typename BGO::Traits::Jacobian BM;
+  BM bm(bgo);
+  timer.reset();
+  bm = 0.0;
+  bgo.jacobian(u,bm);
+  ba.jacobian(bm);
+  double t_batched = timer.elapsed();
+  std::cout << fullname.str()
+            << " elements=" << ba.elements()
+            << " setup=" << t_setup << "s"
+            << " standard=" << ba.elements()/t_standard << " elements/s"
+            << " batched(" << BATCHED_ASSEMBLY_WIDTH << " lanes)=" << ba.elements()/t_batched << " elements/s"
+            << std::endl;
+
+  // residual and solve
+  U r(gfs,0.0);
+  bgo.residual(u,r);
+  ba.residual(u,r);
+  typedef Dune::PDELab::ISTLBackend_SEQ_CG_ILU0 LS;
+  LS ls(10000,1);
+  U z(gfs,0.0);
+  ls.apply(bm,z,r,1e-12);
+  u -= z;
+
+  // compute L2 error
+  typedef Dune::PDELab::DiscreteGridFunction<GFS,U> UDGF;
+  UDGF udgf(gfs,u);
+  typedef DifferenceSquaredAdapter<G,UDGF> DifferenceSquared;
+  DifferenceSquared differencesquared(g,udgf);
+  typename DifferenceSquared::Traits::RangeType l2errorsquared(0.0);
+  Dune::PDELab::integrateGridFunction(differencesquared,l2errorsquared,12);
+  std::cout << fullname.str()
+            << " N=" << std::setw(11) << gfs.globalSize()
+            << " L2ERROR=" << std::setw(11) << std::setprecision(3) << std::scientific << std::uppercase << sqrt(l2errorsquared[0]) << std::endl;
+
+  // write vtk file
+  if (graphics)
+    {
+      Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
+      vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<UDGF> >(udgf,"u_h"));
+      vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<G> >(g,"u"));
+      vtkwriter.write(fullname.str(),Dune::VTK::appendedraw);
+    }
+}
+
 int main(int argc, char** argv)
 {
 
@@ -283,11 +385,12 @@ int main(int argc, char** argv)
       std::cout << "       <dim> = 2 | 3" << std::endl;
       std::cout << "       <geometry> = cube | simplex" << std::endl;
       std::cout << "       <maxlevel> = a nonnegative integer" << std::endl;
-      std::cout << "       <method> = FEM | SIPG" << std::endl;
+      std::cout << "       <method> = FEM | SIPG | BATCHED (degree 1 only)" << std::endl;
       std::cout << "       <degree> : polynomial degree (integer)" << std::endl;
       std::cout << std::endl;
       std::cout << "e.g.: ./diffusion 2 cube 3 FEM 1" << std::endl;
       std::cout << "      ./diffusion 2 cube 3 SIPG 1" << std::endl;
+      std::cout << "      ./diffusion 2 cube 8 BATCHED 1" << std::endl;
       std::cout << std::endl;
       return 0;
     }
@@ -347,6 +450,11 @@ int main(int argc, char** argv)
                   runDG<GV,FEMDG,Problem,Real,degree,blocksize>(gv,femdg,problem,problemlabel.str(),i,"SIPG","ON",2.0);
                 }
               }
+              if (method=="BATCHED" && degree_dyn==1) {
+                typedef Dune::PDELab::QkLocalFiniteElementMap<GV,Grid::ctype,Real,1> FEMCG;
+                FEMCG femcg(gv);
+                runBatchedFEM<GV,FEMCG,Problem>(gv,femcg,problem,problemlabel.str(),i);
+              }
               if (method=="FEM") {
                 if (degree_dyn==1) {
                   const int degree=1;
@@ -418,6 +526,11 @@ int main(int argc, char** argv)
                   runDG<GV,FEMDG,Problem,Real,degree,blocksize>(gv,femdg,problem,problemlabel.str(),i,"SIPG","ON",2.0);
                 }
               }
+              if (method=="BATCHED" && degree_dyn==1) {
+                typedef Dune::PDELab::QkLocalFiniteElementMap<GV,Grid::ctype,Real,1> FEMCG;
+                FEMCG femcg(gv);
+                runBatchedFEM<GV,FEMCG,Problem>(gv,femcg,problem,problemlabel.str(),i);
+              }
               if (method=="FEM") {
                 if (degree_dyn==1) {
                   const int degree=1;
@@ -484,6 +597,11 @@ int main(int argc, char** argv)
                 }
               }
 
+              if (method=="BATCHED" && degree_dyn==1) {
+                typedef Dune::PDELab::PkLocalFiniteElementMap<GV,Grid::ctype,Real,1> FEMCG;
+                FEMCG femcg(gv);
+                runBatchedFEM<GV,FEMCG,Problem>(gv,femcg,problem,problemlabel.str(),i);
+              }
               if (method=="FEM") {
                 if (degree_dyn==1) {
                   const int degree=1;
@@ -555,6 +673,11 @@ int main(int argc, char** argv)
                 }
               }
 
+              if (method=="BATCHED" && degree_dyn==1) {
+                typedef Dune::PDELab::PkLocalFiniteElementMap<GV,Grid::ctype,Real,1> FEMCG;
+                FEMCG femcg(gv);
+                runBatchedFEM<GV,FEMCG,Problem>(gv,femcg,problem,problemlabel.str(),i);
+              }
               if (method=="FEM") {
                 if (degree_dyn==1) {
                   const int degree=1;
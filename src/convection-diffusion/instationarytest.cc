@@ -45,6 +45,9 @@
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
 #include"l2interpolationerror.hh"
+#include"../utility/timestepcontrol.hh"
+#include"../utility/constantjacobian.hh"
+#include"../utility/exponentialintegrator.hh"
 
 //==============================================================================
 // Parameter class for the convection diffusion problem
@@ -176,8 +179,10 @@ private:
 //===============================================================
 
 // a sequential variant
+// t_level gives the (initial) time step 0.125/2^t_level; with tol>0 the
+// step size is controlled by comparing with an embedded Alexander2 solution
 template<class GV>
-void sequential (const GV& gv, int t_level)
+void sequential (const GV& gv, int t_level, double tol)
 {
   // <<<1>>> Choose domain and range field type
   typedef typename GV::Grid::ctype Coord;
@@ -237,7 +242,12 @@ void sequential (const GV& gv, int t_level)
 
   // <<<8>>> time-stepper
   Dune::PDELab::OneStepMethod<Real,IGO,PDESOLVER,V,V> osm(method,igo,tnewton);
-  osm.setVerbosityLevel(2);
+  osm.setVerbosityLevel(tol>0.0 ? 0 : 2);
+  Dune::PDELab::Alexander2Parameter<Real> embedded;
+  Dune::PDELab::OneStepMethod<Real,IGO,PDESOLVER,V,V> osmlow(embedded,igo,tnewton);
+  osmlow.setVerbosityLevel(0);
+  const Real T = 0.125;
+  PIStepController controller(2,1e-8*T,T);
 
   // <<<9>>> initial value and initial value for first time step with b.c. set
   V xold(gfs,0.0);
@@ -262,10 +272,34 @@ void sequential (const GV& gv, int t_level)
   param.setTime(dt);
   Dune::PDELab::interpolate(g,gfs,x);
   Dune::PDELab::set_nonconstrained_dofs(cg,0.0,x);
-  for (int i=1; i<=N; i++)
+  int steps = 0;
+  double step_time = 0.0;
+  while (time<T-1e-10)
     {
       // do time step
+      dt = std::min(dt,T-time);
+      Dune::Timer watch;
       osm.apply(time,dt,xold,x);
+      step_time += watch.elapsed();
+      steps++;
+      if (tol>0.0)
+        {
+          V xlow(gfs,0.0);
+          osmlow.apply(time,dt,xold,xlow);
+          const double err = scaled_error(x,xlow,tol,tol,gv.comm());
+          double dtnew;
+          const bool ok = controller.accept(err,dt,dtnew);
+          controller.log(time,dt,err,ok);
+          if (!ok)
+            {
+              dt = dtnew;
+              continue;
+            }
+          time += dt;
+          dt = dtnew;
+        }
+      else
+        time += dt;
 
       // graphics
       typedef Dune::PDELab::DiscreteGridFunction<GFS,V> DGF;
@@ -280,8 +314,11 @@ void sequential (const GV& gv, int t_level)
       //       std::cout << "solution maximum: "
       //                 << std::scientific << x.infinity_norm() << std::endl;
       xold = x;
-      time += dt;
     }
+  if (tol>0.0)
+    std::cout << "time steps: " << controller.acceptedSteps() << " accepted, "
+              << controller.rejectedSteps() << " rejected" << std::endl;
+  std::cout << "time per step: " << step_time/steps << " s" << std::endl;
 
   // evaluate discretization error
   U<GV,Real> u(gv);
@@ -296,6 +333,192 @@ void sequential (const GV& gv, int t_level)
   }
 }
 
+// a sequential variant for fixed dt: the problem is linear with time
+// independent coefficients and Alexander3 has the same diagonal
+// coefficient in all stages, so the stage Jacobian is the same in every
+// step. It is assembled once, the AMG hierarchy is kept, and a stage
+// only needs a residual evaluation and a Krylov solve.
+template<class GV>
+void sequential_constant (const GV& gv, int t_level)
+{
+  // <<<1>>> Choose domain and range field type
+  typedef typename GV::Grid::ctype Coord;
+  typedef double Real;
+
+  // <<<2>>> Make grid function space
+  const int degree=2;
+  typedef Dune::PDELab::QkLocalFiniteElementMap<GV,Coord,Real,degree> FEM;
+  FEM fem(gv);
+  typedef Dune::PDELab::ConformingDirichletConstraints CON;
+  typedef Dune::PDELab::ISTLVectorBackend<> VBE;
+  typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+  GFS gfs(gv,fem);
+
+  // <<<2b>>> define problem parameters
+  typedef ConvectionDiffusionProblem<GV,Real> Param;
+  Param param;
+  Dune::PDELab::BCTypeParam_CD<Param> bctype(gv,param);
+  typedef Dune::PDELab::DirichletBoundaryCondition_CD<Param> G;
+  G g(gv,param);
+
+  // <<<3>>> Compute constrained space
+  typedef typename GFS::template ConstraintsContainer<Real>::Type C;
+  C cg;
+  Dune::PDELab::constraints( bctype, gfs, cg );
+
+  // <<<5>>> Make grid operator space for time-dependent problem
+  typedef Dune::PDELab::ConvectionDiffusion<Param> LOP;
+  LOP lop(param,4);
+  typedef Dune::PDELab::L2 MLOP;
+  MLOP mlop(4);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(5);
+  Dune::PDELab::Alexander3Parameter<Real> method;
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,C,C> GO0;
+  GO0 go0(gfs,cg,gfs,cg,lop,mbe);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,MLOP,MBE,Real,Real,Real,C,C> GO1;
+  GO1 go1(gfs,cg,gfs,cg,mlop,mbe);
+  typedef Dune::PDELab::OneStepGridOperator<GO0,GO1> IGO;
+  IGO igo(go0,go1);
+  typedef typename IGO::Traits::Domain V;
+
+  // <<<6>>> Make a linear solver with AMG and a stage solver keeping the matrix
+  typedef Dune::PDELab::ISTLBackend_SEQ_BCGS_AMG_SSOR<IGO> LS;
+  LS ls(5000,0);
+  typedef ConstantJacobianLinearSolver<IGO,LS,V> PDESOLVER;
+  PDESOLVER solver(igo,ls,1e-9);
+
+  // <<<8>>> time-stepper
+  Dune::PDELab::OneStepMethod<Real,IGO,PDESOLVER,V,V> osm(method,igo,solver);
+  osm.setVerbosityLevel(2);
+  const Real T = 0.125;
+
+  // <<<9>>> initial value and initial value for first time step with b.c. set
+  V xold(gfs,0.0);
+  Real time = 0.0;
+  int N=1; for (int i=0; i<t_level; i++) N *= 2;
+  Real dt = 0.125/N;
+  V x(gfs,0.0);
+  param.setTime(dt);
+  Dune::PDELab::interpolate(g,gfs,x);
+  Dune::PDELab::set_nonconstrained_dofs(cg,0.0,x);
+
+  // <<<11>>> time loop, no graphics to measure the time per step
+  int steps = 0;
+  double step_time = 0.0;
+  while (time<T-1e-10)
+    {
+      Dune::Timer watch;
+      osm.apply(time,dt,xold,x);
+      step_time += watch.elapsed();
+      steps++;
+      time += dt;
+      xold = x;
+    }
+  std::cout << "time per step: " << step_time/steps << " s"
+            << " (" << steps << " steps, "
+            << solver.jacobianAssemblies() << " Jacobian assemblies, "
+            << solver.linearSolves() << " solves, assembly "
+            << solver.assemblyTime() << " s, solve "
+            << solver.solveTime() << " s)" << std::endl;
+
+  // evaluate discretization error
+  U<GV,Real> u(gv);
+  std::cout.precision(8);
+  std::cout << "space time discretization error: "
+            << std::setw(8) << gv.size(0) << " elements "
+            << std::scientific << l2interpolationerror(u,gfs,x,8) << std::endl;
+}
+
+// a sequential variant with the exponential Rosenbrock-Euler method:
+// the operator is linear and time independent, so the Jacobian is
+// assembled once and the step size is only limited by the accuracy in
+// time of the source term; compare with sequential_constant
+template<class GV>
+void sequential_exponential (const GV& gv, int t_level)
+{
+  // <<<1>>> Choose domain and range field type
+  typedef typename GV::Grid::ctype Coord;
+  typedef double Real;
+
+  // <<<2>>> Make grid function space
+  const int degree=2;
+  typedef Dune::PDELab::QkLocalFiniteElementMap<GV,Coord,Real,degree> FEM;
+  FEM fem(gv);
+  typedef Dune::PDELab::ConformingDirichletConstraints CON;
+  typedef Dune::PDELab::ISTLVectorBackend<> VBE;
+  typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+  GFS gfs(gv,fem);
+
+  // <<<2b>>> define problem parameters
+  typedef ConvectionDiffusionProblem<GV,Real> Param;
+  Param param;
+  Dune::PDELab::BCTypeParam_CD<Param> bctype(gv,param);
+  typedef Dune::PDELab::DirichletBoundaryCondition_CD<Param> G;
+  G g(gv,param);
+
+  // <<<3>>> Compute constrained space
+  typedef typename GFS::template ConstraintsContainer<Real>::Type C;
+  C cg;
+  Dune::PDELab::constraints( bctype, gfs, cg );
+
+  // <<<5>>> Make grid operators for the spatial part and the mass matrix
+  typedef Dune::PDELab::ConvectionDiffusion<Param> LOP;
+  LOP lop(param,4);
+  typedef Dune::PDELab::L2 MLOP;
+  MLOP mlop(4);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(5);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,C,C> GO0;
+  GO0 go0(gfs,cg,gfs,cg,lop,mbe);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,MLOP,MBE,Real,Real,Real,C,C> GO1;
+  GO1 go1(gfs,cg,gfs,cg,mlop,mbe);
+  typedef typename GO0::Traits::Domain V;
+
+  // <<<6>>> Make a linear solver for the mass matrix
+  typedef Dune::PDELab::ISTLBackend_SEQ_CG_SSOR LS;
+  LS ls(5000,0);
+
+  // <<<8>>> time-stepper
+  typedef ExponentialRosenbrockEuler<GO0,GO1,LOP,LS,V> EXPINT;
+  EXPINT expint(go0,go1,lop,ls);
+  expint.setVerbosityLevel(2);
+  const Real T = 0.125;
+
+  // <<<9>>> initial value
+  V xold(gfs,0.0);
+  Real time = 0.0;
+  int N=1; for (int i=0; i<t_level; i++) N *= 2;
+  Real dt = 0.125/N;
+  V x(gfs,0.0);
+
+  // <<<11>>> time loop, no graphics to measure the time per step
+  int steps = 0;
+  double step_time = 0.0;
+  while (time<T-1e-10)
+    {
+      Dune::Timer watch;
+      expint.apply(time,dt,xold,x);
+      step_time += watch.elapsed();
+      steps++;
+      time += dt;
+      xold = x;
+    }
+  std::cout << "time per step: " << step_time/steps << " s"
+            << " (" << steps << " steps, " << expint.stepCount() << " substeps, "
+            << "Krylov dimension " << expint.averageKrylovDimension() << ", "
+            << expint.massSolves() << " mass solves, assembly "
+            << expint.assemblyTime() << " s, Krylov "
+            << expint.krylovTime() << " s)" << std::endl;
+
+  // evaluate discretization error
+  U<GV,Real> u(gv);
+  std::cout.precision(8);
+  std::cout << "space time discretization error: "
+            << std::setw(8) << gv.size(0) << " elements "
+            << std::scientific << l2interpolationerror(u,gfs,x,8) << std::endl;
+}
+
 //===============================================================
 // Main program with grid setup
 //===============================================================
@@ -313,10 +536,10 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
-    if (argc!=3)
+    if (argc!=3 && argc!=4)
       {
         if(helper.rank()==0)
-          std::cout << "usage: ./instationarytest <t_level> <x_level>" << std::endl;
+          std::cout << "usage: ./instationarytest <t_level> <x_level> [<tol>|constant|exponential]" << std::endl;
         return 1;
       }
 
@@ -326,6 +549,19 @@ int main(int argc, char** argv)
     int x_level;
     sscanf(argv[2],"%d",&x_level);
 
+    double tol = 0.0;
+    bool constant = false;
+    bool exponential = false;
+    if (argc>3)
+      {
+        if (std::string(argv[3])=="constant")
+          constant = true;
+        else if (std::string(argv[3])=="exponential")
+          exponential = true;
+        else
+          sscanf(argv[3],"%lg",&tol);
+      }
+
     // sequential version
     {
       const int dim = 2;
@@ -337,7 +573,12 @@ int main(int argc, char** argv)
       grid.globalRefine(x_level);
       typedef Dune::YaspGrid<dim>::LeafGridView GV;
       const GV& gv=grid.leafGridView();
-      sequential(gv,t_level);
+      if (constant)
+        sequential_constant(gv,t_level);
+      else if (exponential)
+        sequential_exponential(gv,t_level);
+      else
+        sequential(gv,t_level,tol);
     }
   }
 
@@ -50,6 +50,8 @@
 #include<dune/pdelab/localoperator/convectiondiffusionfem.hh>
 #include<dune/pdelab/stationary/linearproblem.hh>
 
+#include"../utility/loadbalancing.hh"
+
 #define PROBLEM_A
 
 #ifdef PROBLEM_A
@@ -154,6 +156,22 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
+    // partitioner of the unstructured grids: recursive coordinate (rcb) or
+    // inertial (rib) bisection
+    if (argc>2)
+      {
+        if(helper.rank()==0)
+          std::cout << "usage: ./nonoverlappingsinglephaseflow [rcb|rib]" << std::endl;
+        return 1;
+      }
+    bool inertial = false;
+    if (argc>1)
+      {
+        inertial = (std::string(argv[1])=="rib");
+        if (!inertial && std::string(argv[1])!="rcb")
+          DUNE_THROW(Dune::Exception,"unknown partitioner " << argv[1]);
+      }
+
     // Q1, 2d
     if (false)
     {
@@ -267,7 +285,10 @@ int main(int argc, char** argv)
       std::vector<int> element_index_to_physical_entity;
       Dune::GmshReader<GridType>::read(factory,"grids/cube1045.msh",true,true);
       factory.createGrid();
-      grid.loadBalance();
+
+      // distribute by recursive bisection of the element centroids
+      std::vector<double> weights(grid.leafGridView().size(0),1.0);
+      grid.loadBalance(recursive_bisection(grid.leafGridView(),weights,inertial),0);
 
       std::cout << " after load balance /" << helper.rank() << "/ " << grid.size(0) << std::endl;
       //grid.globalRefine(1);
@@ -316,15 +337,19 @@ int main(int argc, char** argv)
 
 #if HAVE_DUNE_ALUGRID
     // ALU Pk 3D test
-    if (false)
+    if (true)
     {
       typedef Dune::ALUGrid<3,3,Dune::simplex,Dune::nonconforming> GridType;
-      GridType* grid;
+      Dune::GridFactory<GridType> factory;
       if (helper.rank()==0)
-      {
-        grid = Dune::GmshReader<GridType>::read("grids/cube1045.msh", true, false);
-      }
-      grid->loadBalance();
+        Dune::GmshReader<GridType>::read(factory,"grids/cube1045.msh",true,false);
+      GridType* grid = factory.createGrid();
+
+      // distribute the macro elements by recursive bisection
+      std::vector<double> weights(grid->levelGridView(0).size(0),1.0);
+      const std::vector<int> target = recursive_bisection(grid->levelGridView(0),weights,inertial);
+      PartitionLoadBalanceHandle<GridType> handle(*grid,target);
+      grid->repartition(handle);
       std::cout << " after load balance /" << helper.rank() << "/ " << grid->size(0) << std::endl;
       //grid->globalRefine(1);
       std::cout << " after refinement /" << helper.rank() << "/ " << grid->size(0) << std::endl;
@@ -44,6 +44,8 @@
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
 
+#include"../utility/activeset.hh"
+
 //==============================================================================
 // Parameter class for the convection diffusion problem
 //==============================================================================
@@ -214,7 +216,7 @@ void stationary (const GV& gv)
 
 // example using implicit time-stepping
 template<class GV>
-void implicit_scheme (const GV& gv, double Tend, double timestep)
+void implicit_scheme (const GV& gv, double Tend, double timestep, bool activeset)
 {
   // <<<1>>> Choose domain and range field type
   typedef typename GV::Grid::ctype Coord;
@@ -246,9 +248,15 @@ void implicit_scheme (const GV& gv, double Tend, double timestep)
   std::cout << "constrained dofs=" << cg.size()
             << " of " << gfs.globalSize() << std::endl;
 
-  // <<<4>>> Make grid operator
-  typedef Dune::PDELab::CCFVSpatialTransportOperator<Param> LOP;
-  LOP lop(param);
+  // <<<4>>> Make grid operator; contributions of cells whose state did
+  // not change are reused from the previous evaluation
+  typedef Dune::PDELab::CCFVSpatialTransportOperator<Param> TransportLOP;
+  TransportLOP transportlop(param);
+  typedef ActiveSetLocalOperator<GV,TransportLOP> LOP;
+  LOP lop(gv,transportlop,1e-12);
+  lop.setActive(activeset);
+  const int full_reassembly = 10; // time steps between full reassemblies
+  const int activeset_verbosity = 0; // >0: statistics of every time step
   typedef Dune::PDELab::CCFVTemporalOperator<Param> SLOP;
   SLOP slop(param);
   typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
@@ -272,7 +280,7 @@ void implicit_scheme (const GV& gv, double Tend, double timestep)
   LS ls(gfs,cg,5000,1,1);
 
   // <<<7>>> make Newton for time-dependent problem
-  typedef Dune::PDELab::Newton<IGO,LS,V> PDESOLVER;
+  typedef AssemblyTimedNewton<Dune::PDELab::Newton<IGO,LS,V> > PDESOLVER;
   PDESOLVER tnewton(igo,ls);
   tnewton.setReassembleThreshold(0.0);
   tnewton.setVerbosityLevel(0);
@@ -302,10 +310,21 @@ void implicit_scheme (const GV& gv, double Tend, double timestep)
   Real time = 0.0;
   Real dt = timestep;
   x = 0;
+  int step = 0;
+  std::size_t computed_total = 0, reused_total = 0;
   while (time < Tend)
     {
       // do time step
+      if (++step%full_reassembly==0)
+        lop.invalidate();
       osm.apply(time,dt,xold,x);
+      std::size_t computed, reused;
+      lop.statistics(computed,reused);
+      computed_total += computed;
+      reused_total += reused;
+      if (activeset_verbosity>0)
+        std::cout << "active set: " << computed << " contributions computed, "
+                  << reused << " reused" << std::endl;
 
       // graphics
       typedef Dune::PDELab::DiscreteGridFunction<GFS,V> DGF;
@@ -318,6 +337,14 @@ void implicit_scheme (const GV& gv, double Tend, double timestep)
       xold = x;
       time += dt;
     }
+
+  // assembly time with the active set against the plain operator
+  if (activeset)
+    std::cout << "active set: " << computed_total << " contributions computed, "
+              << reused_total << " reused, ";
+  else
+    std::cout << "plain transport operator: ";
+  std::cout << "Jacobian assembly " << tnewton.assemblyTime() << " s" << std::endl;
 }
 
 
@@ -442,10 +469,10 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
-    if (argc!=5)
+    if (argc<5 || argc>6)
       {
         if(helper.rank()==0)
-          std::cout << "usage: ./transporttest <end time> <time step> <elements on a side> <overlap>" << std::endl;
+          std::cout << "usage: ./transporttest <end time> <time step> <elements on a side> <overlap> [activeset|plain]" << std::endl;
         return 1;
       }
 
@@ -461,6 +488,15 @@ int main(int argc, char** argv)
     int o;
     sscanf(argv[4],"%d",&o);
 
+    // reuse of unchanged contributions in the implicit scheme, or the plain operator
+    bool activeset = true;
+    if (argc>5)
+      {
+        activeset = (std::string(argv[5])=="activeset");
+        if (!activeset && std::string(argv[5])!="plain")
+          DUNE_THROW(Dune::Exception,"unknown assembly mode " << argv[5]);
+      }
+
     // parallel overlapping version
     if (true)
       {
@@ -477,7 +513,7 @@ int main(int argc, char** argv)
         stationary(gv);
 
         std::cout << "\n implicit_scheme" << std::endl;
-        implicit_scheme(gv,Tend,timestep);
+        implicit_scheme(gv,Tend,timestep,activeset);
 
         std::cout << "\n explicit_scheme" << std::endl;
         explicit_scheme(gv,Tend,timestep);
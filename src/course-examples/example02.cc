@@ -57,6 +57,9 @@
 #include"example02_bcextension.hh"
 #include"example02_operator.hh"
 #include"example02_Q1.hh"
+#include"example02_parameter.hh"
+#include"../utility/batchedassembler.hh"
+#include"example02_Q1batched.hh"
 
 //===============================================================
 // Main program with grid setup
@@ -75,16 +78,20 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
-    if (argc!=2)
+    if (argc!=2 && argc!=3)
       {
         if(helper.rank()==0)
-          std::cout << "usage: ./example02 <level>" << std::endl;
+          std::cout << "usage: ./example02 <level> [standard|batched]" << std::endl;
         return 1;
       }
 
     int level;
     sscanf(argv[1],"%d",&level);
 
+    std::string mode("standard");
+    if (argc==3)
+      mode = argv[2];
+
     // sequential version
     if (1 && helper.size()==1)
     {
@@ -96,7 +103,10 @@ int main(int argc, char** argv)
       grid.globalRefine(level);
       typedef Dune::YaspGrid<2>::LeafGridView GV;
       const GV& gv=grid.leafGridView();
-      example02_Q1(gv);
+      if (mode=="batched")
+        example02_Q1_batched(gv);
+      else
+        example02_Q1(gv);
     }
   }
   catch (Dune::Exception &e){
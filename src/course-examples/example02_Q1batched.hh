@@ -0,0 +1,89 @@
+template<class GV> void example02_Q1_batched (const GV& gv)
+{
+  // <<<1>>> Choose domain and range field type
+  typedef typename GV::Grid::ctype Coord;
+  typedef double Real;
+
+  // <<<2>>> Make grid function space
+  typedef Dune::PDELab::QkLocalFiniteElementMap<GV,Coord,Real,1> FEM;
+  FEM fem(gv);
+  typedef Dune::PDELab::ConformingDirichletConstraints CON; // constraints class
+  typedef Dune::PDELab::ISTLVectorBackend<> VBE;
+  typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE> GFS;
+  GFS gfs(gv,fem);
+  gfs.name("solution");
+  BCTypeParam bctype; // boundary condition type
+  typedef typename GFS::template ConstraintsContainer<Real>::Type CC;
+  CC cc;
+  Dune::PDELab::constraints( bctype, gfs, cc ); // assemble constraints
+  std::cout << "constrained dofs=" << cc.size() << " of " << gfs.globalSize() << std::endl;
+
+  // <<<3>>> Make grid operators
+  // standard element-by-element assembly, for comparison
+  typedef Example02LocalOperator<BCTypeParam> LOP;
+  LOP lop( bctype );
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(9);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+  GO go(gfs,cc,gfs,cc,lop,mbe);
+
+  // boundary terms, pattern and constraints through the grid operator ...
+  typedef BoundaryOnlyLocalOperator<LOP> BLOP;
+  BLOP blop( bctype );
+  typedef Dune::PDELab::GridOperator<GFS,GFS,BLOP,MBE,Real,Real,Real,CC,CC> BGO;
+  BGO bgo(gfs,cc,gfs,cc,blop,mbe);
+
+  // ... and volume terms in batches of elements
+  typedef Example02Parameter<GV,Real> PARAM;
+  PARAM param;
+  typedef BatchedAssembler<GFS,CC,PARAM> BA;
+  Dune::Timer timer;
+  BA ba(gfs,cc,param);
+  std::cout << "batched assembler setup: " << timer.elapsed() << " s" << std::endl;
+
+  // <<<4>>> Make FE function extending Dirichlet boundary conditions
+  typedef typename GO::Traits::Domain U;
+  U u(gfs,0.0);
+  typedef BCExtension<GV,Real> G;
+  G g(gv);
+  Dune::PDELab::interpolate(g,gfs,u);
+
+  // <<<5>>> assemble matrix both ways and compare throughput
+  typedef typename GO::Traits::Jacobian M;
+  M m(go);
+  timer.reset();
+  m = 0.0;
+  go.jacobian(u,m);
+  double t_standard = timer.elapsed();
+
+  typedef typename BGO::Traits::Jacobian BM;
+  BM bm(bgo);
+  timer.reset();
+  bm = 0.0;
+  bgo.jacobian(u,bm);
+  ba.jacobian(bm);
+  double t_batched = timer.elapsed();
+
+  std::cout << "jacobian assembly: standard " << t_standard << " s ("
+            << ba.elements()/t_standard << " elements/s), batched with "
+            << BATCHED_ASSEMBLY_WIDTH << " lanes " << t_batched << " s ("
+            << ba.elements()/t_batched << " elements/s)" << std::endl;
+
+  // <<<6>>> residual and solve
+  U r(gfs,0.0);
+  timer.reset();
+  bgo.residual(u,r);
+  ba.residual(u,r);
+  std::cout << "batched residual assembly: " << timer.elapsed() << " s" << std::endl;
+
+  typedef Dune::PDELab::ISTLBackend_SEQ_BCGS_SSOR LS;
+  LS ls(5000,true);
+  U z(gfs,0.0);
+  ls.apply(bm,z,r,1e-10);
+  u -= z;
+
+  // <<<7>>> graphical output
+  Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
+  Dune::PDELab::addSolutionToVTKWriter(vtkwriter,gfs,u);
+  vtkwriter.write("example02_Q1_batched",Dune::VTK::appendedraw);
+}
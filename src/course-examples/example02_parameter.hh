@@ -0,0 +1,47 @@
+#include<dune/pdelab/localoperator/convectiondiffusionparameter.hh>
+
+/** \brief Coefficients of the volume terms of Example02LocalOperator
+ *
+ * Provides -\Delta u + a*u = f with a=f=0 in the interface of the
+ * convection-diffusion parameter classes, as needed by BatchedAssembler.
+ * Boundary conditions are still taken from BCTypeParam.
+ */
+template<typename GV, typename RF>
+class Example02Parameter
+{
+public:
+  typedef Dune::PDELab::ConvectionDiffusionParameterTraits<GV,RF> Traits;
+
+  //! tensor diffusion coefficient
+  typename Traits::PermTensorType
+  A (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  {
+    typename Traits::PermTensorType I;
+    for (int i=0; i<GV::dimension; i++)
+      for (int j=0; j<GV::dimension; j++)
+        I[i][j] = (i==j) ? 1.0 : 0.0;
+    return I;
+  }
+
+  //! velocity field
+  typename Traits::RangeType
+  b (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  {
+    typename Traits::RangeType v(0.0);
+    return v;
+  }
+
+  //! reaction term a
+  typename Traits::RangeFieldType
+  c (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  {
+    return 0.0;
+  }
+
+  //! source term
+  typename Traits::RangeFieldType
+  f (const typename Traits::ElementType& e, const typename Traits::DomainType& x) const
+  {
+    return 0.0;
+  }
+};
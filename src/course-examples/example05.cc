@@ -12,6 +12,7 @@
 #include<map>
 #include<string>
 #include<stdlib.h>
+#include<type_traits>
 
 #include<dune/common/parallel/mpihelper.hh>
 #include<dune/common/exceptions.hh>
@@ -45,9 +46,12 @@
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
 
+#include"../utility/imex.hh"
+
 #include"example05_operator.hh"
 #include"example05_toperator.hh"
 #include"example05_initial.hh"
+#include"example05_sumfact.hh"
 #include"example05_QkQk.hh"
 
 //===============================================================
@@ -67,10 +71,10 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
-    if (argc!=6)
+    if (argc<6 || argc>8)
       {
         if(helper.rank()==0) {
-          std::cout << "usage: ./example05 <level> <dtstart> <dtmax> <tend> <k>" << std::endl;
+          std::cout << "usage: ./example05 <level> <dtstart> <dtmax> <tend> <k> [<dim>] [implicit|imex|compare]" << std::endl;
           std::cout << "suggestion: ./example05 5 1e-3 1.0 200.0 1" << std::endl;
         }
         return 1;
@@ -91,8 +95,19 @@ int main(int argc, char** argv)
     int degree;
     sscanf(argv[5],"%d",&degree);
 
+    int dim = 2;
+    if (argc>=7)
+      sscanf(argv[6],"%d",&dim);
+
+    // time stepping: fully implicit (default), IMEX or both
+    std::string mode("implicit");
+    if (argc==8)
+      mode = argv[7];
+    if (mode!="implicit" && mode!="imex" && mode!="compare")
+      DUNE_THROW(Dune::Exception,"unknown time stepping " << mode);
+
     // sequential version
-    if (1 && helper.size()==1)
+    if (dim==2 && helper.size()==1)
     {
       Dune::FieldVector<double,2> L(2.0);
       Dune::array<int,2> N(Dune::fill_array<int,2>(1));
@@ -102,8 +117,25 @@ int main(int argc, char** argv)
       grid.globalRefine(level);
       typedef Dune::YaspGrid<2>::LeafGridView GV;
       const GV& gv=grid.leafGridView();
-      if (degree==1) example05_QkQk<1>(gv,dtstart,dtmax,tend); // Q1Q1
-      if (degree==2) example05_QkQk<2>(gv,dtstart,dtmax,tend); // Q2Q2
+      if (degree==1) example05_QkQk<1>(gv,dtstart,dtmax,tend,mode); // Q1Q1
+      if (degree==2) example05_QkQk<2>(gv,dtstart,dtmax,tend,mode); // Q2Q2
+      if (degree==3) example05_QkQk<3>(gv,dtstart,dtmax,tend,mode); // Q3Q3
+    }
+
+    // sequential version in 3D
+    if (dim==3 && helper.size()==1)
+    {
+      Dune::FieldVector<double,3> L(2.0);
+      Dune::array<int,3> N(Dune::fill_array<int,3>(1));
+      std::bitset<3> periodic(false);
+      int overlap=0;
+      Dune::YaspGrid<3> grid(L,N,periodic,overlap);
+      grid.globalRefine(level);
+      typedef Dune::YaspGrid<3>::LeafGridView GV;
+      const GV& gv=grid.leafGridView();
+      if (degree==1) example05_QkQk<1>(gv,dtstart,dtmax,tend,mode); // Q1Q1
+      if (degree==2) example05_QkQk<2>(gv,dtstart,dtmax,tend,mode); // Q2Q2
+      if (degree==3) example05_QkQk<3>(gv,dtstart,dtmax,tend,mode); // Q3Q3
     }
   }
   catch (Dune::Exception &e){
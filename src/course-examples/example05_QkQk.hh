@@ -1,5 +1,11 @@
+/** Fitzhugh-Nagumo system with Qk elements. With mode "implicit" all
+ *  terms are treated implicitly with Newton's method, with "imex" only
+ *  diffusion is implicit and the reaction terms are explicit, "compare"
+ *  runs both and prints the difference of the solutions at tend.
+ */
 template<int k, class GV>
-void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend)
+void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend,
+                     std::string mode="implicit")
 {
   // <<<1>>> Choose domain and range field type
   typedef typename GV::Grid::ctype Coord;
@@ -35,12 +41,20 @@ void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend)
   Real sigma = 1.0;
   Real kappa = -0.05;
   Real tau = 0.1;
-  typedef Example05LocalOperator LOP;
+  // for k>=2 use the sum-factorized operators
+  const int dim = GV::dimension;
+  typedef typename std::conditional<(k>=2),
+    Example05SumFactLocalOperator<k,dim>,
+    Example05LocalOperator>::type LOP;
   LOP lop(d_0,d_1,lambda,sigma,kappa,2*k);
-  typedef Example05TimeLocalOperator TLOP;
+  typedef typename std::conditional<(k>=2),
+    Example05SumFactTimeLocalOperator<k,dim>,
+    Example05TimeLocalOperator>::type TLOP;
   TLOP tlop(tau,2*k);
   typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
-  MBE mbe(k == 1 ? 9 : 25);
+  int entries = 1;
+  for (int i=0; i<dim; i++) entries *= 2*k+1;
+  MBE mbe(entries);
   typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO0;
   GO0 go0(gfs,gfs,lop,mbe);
   typedef Dune::PDELab::GridOperator<GFS,GFS,TLOP,MBE,Real,Real,Real,CC,CC> GO1;
@@ -85,7 +99,7 @@ void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend)
 
   // <<<8>>> graphics for initial guess
   std::stringstream basename;
-  basename << "example05_Q" << k << "Q" << k;
+  basename << "example05_Q" << k << "Q" << k << "_" << dim << "d";
   Dune::PDELab::FilenameHelper fn(basename.str());
   {
     typedef Dune::PDELab::DiscreteGridFunction<U0SUB,U> U0DGF;
@@ -100,13 +114,23 @@ void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend)
   }
 
   // <<<9>>> time loop
+  const bool compare = (mode=="compare");
+  U uimplicit(gfs,0.0);
+  uimplicit = uold;
   U unew(gfs,0.0);
   unew = uold;
   double dt = dtstart;
-  while (time<tend-1e-8)
+  Dune::Timer timer;
+  double steptime = 0.0;
+  int steps = 0;
+  while ((mode=="implicit" || compare) && time<tend-1e-8)
     {
-      // do time step
-      osm.apply(time,dt,uold,unew);
+      // do time step, hit tend exactly when comparing
+      if (compare)
+        dt = std::min(dt,tend-time);
+      timer.reset();
+      osm.apply(time,dt,uimplicit,unew);
+      steptime += timer.elapsed();
 
       // graphics
       typedef Dune::PDELab::DiscreteGridFunction<U0SUB,U> U0DGF;
@@ -119,9 +143,84 @@ void example05_QkQk (const GV& gv, double dtstart, double dtmax, double tend)
       vtkwriter.write(fn.getName(),Dune::VTK::appendedraw);
       fn.increment();
 
-      uold = unew;
+      uimplicit = unew;
       time += dt;
+      steps++;
       if (dt<dtmax-1e-8)
         dt = std::min(dt*1.1,dtmax);
     }
+  if (mode=="implicit" || compare)
+    {
+      std::cout << "time spent in time steps: " << steptime << " s" << std::endl;
+      std::cout << "implicit: steps=" << steps << " time per simulated time unit="
+                << steptime/tend << " s" << std::endl;
+    }
+
+  // <<<10>>> IMEX time loop: the linear diffusion part is implicit with a
+  // matrix assembled once and a stage matrix that is only rebuilt when dt
+  // changes, the reaction part is explicit, so there is no Newton
+  // iteration. dt is limited by the spectral radius of the reaction part.
+  if (mode!="imex" && !compare)
+    return;
+  typedef Example05LocalOperator PLOP;
+  PLOP dlop(d_0,d_1,lambda,sigma,kappa,2*k,PLOP::diffusion);
+  PLOP rlop(d_0,d_1,lambda,sigma,kappa,2*k,PLOP::reaction);
+  typedef Example05TimeLocalOperator MLOP;
+  MLOP mlop(tau,2*k);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,PLOP,MBE,Real,Real,Real,CC,CC> GOP;
+  GOP god(gfs,gfs,dlop,mbe);
+  GOP gor(gfs,gfs,rlop,mbe);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,MLOP,MBE,Real,Real,Real,CC,CC> GOM;
+  GOM gom(gfs,gfs,mlop,mbe);
+  typedef Dune::PDELab::ISTLBackend_SEQ_CG_AMG_SSOR<GOP> ILS;
+  ILS ils(5000,0);
+  ARS222Parameter<Real> imexmethod;
+  IMEXRungeKutta<GOP,GOP,GOM,ILS,U> imex(imexmethod,god,gor,gom,ils);
+
+  Dune::PDELab::FilenameHelper fnimex(basename.str()+"_imex");
+  U uimex(gfs,0.0);
+  Dune::PDELab::interpolate(uinitial,gfs,uimex);
+  time = 0.0;
+  dt = dtstart;
+  steptime = 0.0;
+  steps = 0;
+  while (time<tend-1e-8)
+    {
+      // the stability limit depends on the solution
+      timer.reset();
+      dt = imex.suggestTimestep(uimex,dt,dtmax);
+      const double h = std::min(dt,tend-time);
+      imex.apply(time,h,uimex,unew);
+      steptime += timer.elapsed();
+
+      // graphics
+      typedef Dune::PDELab::DiscreteGridFunction<U0SUB,U> U0DGF;
+      U0DGF u0dgf(u0sub,unew);
+      typedef Dune::PDELab::DiscreteGridFunction<U1SUB,U> U1DGF;
+      U1DGF u1dgf(u1sub,unew);
+      Dune::SubsamplingVTKWriter<GV> vtkwriter(gv,3*(k-1));
+      vtkwriter.addVertexData(new Dune::PDELab::VTKGridFunctionAdapter<U0DGF>(u0dgf,"u0"));
+      vtkwriter.addVertexData(new Dune::PDELab::VTKGridFunctionAdapter<U1DGF>(u1dgf,"u1"));
+      vtkwriter.write(fnimex.getName(),Dune::VTK::appendedraw);
+      fnimex.increment();
+
+      uimex = unew;
+      time += h;
+      steps++;
+    }
+  std::cout << imexmethod.name() << ": steps=" << steps
+            << " linear solves=" << imex.linearSolves()
+            << " matrix setups=" << imex.matrixSetups()
+            << " time per simulated time unit=" << steptime/tend << " s"
+            << " (solver " << imex.solveTime() << " s, residuals " << imex.residualTime() << " s)"
+            << std::endl;
+
+  // <<<11>>> difference of both solutions at tend
+  if (compare)
+    {
+      unew = uimex;
+      unew -= uimplicit;
+      std::cout << "relative difference implicit/IMEX at tend: "
+                << unew.two_norm()/uimplicit.two_norm() << std::endl;
+    }
 }
@@ -18,6 +18,9 @@
  *   \nabla u_1 \cdot v = 0   on \partial\Omega
  *
  * with conforming finite elements on all types of grids in any dimension
+ *
+ * The diffusion and the reaction terms can be assembled separately for
+ * IMEX time stepping, which treats only diffusion implicitly.
  */
 class Example05LocalOperator :
   public Dune::PDELab::NumericalJacobianApplyVolume<Example05LocalOperator >,
@@ -33,11 +36,15 @@ public:
   // residual assembly flags
   enum { doAlphaVolume = true };
 
+  //! terms to assemble
+  enum Part { all, diffusion, reaction };
+
   // constructor stores parameters
   Example05LocalOperator (double d_0_, double d_1_, double lambda_, double sigma_,
-                          double kappa_, unsigned int intorder_=2)
+                          double kappa_, unsigned int intorder_=2, Part part=all)
     : intorder(intorder_), d_0(d_0_), d_1(d_1_), lambda(lambda_),
-      sigma(sigma_), kappa(kappa_)
+      sigma(sigma_), kappa(kappa_),
+      wd(part==reaction ? 0.0 : 1.0), wr(part==diffusion ? 0.0 : 1.0)
   {}
 
   // volume integral depending on test and ansatz functions
@@ -114,17 +121,18 @@ public:
         RF factor = it->weight()*eg.geometry().integrationElement(it->position());
         // eq. 0: - d_0 \Delta u_0 - (\lambda*u_0 - u_0^3 - \sigma* u_1 + \kappa) = 0
         for (size_type i=0; i<lfsu0.size(); i++)
-          r.accumulate(lfsu0,i,(d_0*(gradu0*gradphi0[i])
-				-(lambda*u_0-u_0*u_0*u_0-sigma*u_1+kappa)
+          r.accumulate(lfsu0,i,(wd*d_0*(gradu0*gradphi0[i])
+				-wr*(lambda*u_0-u_0*u_0*u_0-sigma*u_1+kappa)
 				*phi0[i])*factor);
         // eq. 1: - d_1 \Delta u_1 - (u_0 - u_1) = 0
         for (size_type i=0; i<lfsu1.size(); i++)
-          r.accumulate(lfsu1,i,(d_1*(gradu1*gradphi1[i])
-				-(u_0-u_1)*phi1[i])*factor);
+          r.accumulate(lfsu1,i,(wd*d_1*(gradu1*gradphi1[i])
+				-wr*(u_0-u_1)*phi1[i])*factor);
       }
   }
 
 private:
   unsigned int intorder;
   double d_0, d_1, lambda, sigma, kappa;
+  double wd, wr;  // weights of diffusion and reaction terms
 };
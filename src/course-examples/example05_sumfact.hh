@@ -0,0 +1,493 @@
+#include<algorithm>
+#include<vector>
+#include<dune/common/fvector.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/geometry/type.hh>
+#include<dune/geometry/quadraturerules.hh>
+#include<dune/pdelab/common/geometrywrapper.hh>
+#include<dune/pdelab/localoperator/pattern.hh>
+#include<dune/pdelab/localoperator/flags.hh>
+#include<dune/pdelab/localoperator/idefault.hh>
+
+/** \brief Sum factorization for tensor-product Q_k bases on cubes
+ *
+ * The Q_k basis is the tensor product of the one-dimensional Lagrange
+ * polynomials on equidistant nodes, numbered lexicographically with
+ * the x-direction running fastest (this is the numbering used by
+ * QkLocalFiniteElement). Values and reference gradients of a function
+ * given by its n^dim coefficients (n=k+1) are evaluated at the q^dim
+ * points of a tensor Gauss rule by applying the 1d matrices direction
+ * by direction. The transposed operations integrate against all test
+ * functions at once. Both cost O(k^(dim+1)) instead of the O(k^(2dim))
+ * of evaluating the full basis at every quadrature point.
+ */
+template<typename DF, typename RF, int k, int dim>
+class QkSumFactorization
+{
+public:
+  enum { n = k+1 };  // number of 1d basis functions
+
+  QkSumFactorization (unsigned int intorder)
+  {
+    const Dune::QuadratureRule<DF,1>& rule =
+      Dune::QuadratureRules<DF,1>::rule(Dune::GeometryType(Dune::GeometryType::cube,1),intorder);
+    q = rule.size();
+
+    // 1d basis values and derivatives at the 1d quadrature points
+    std::vector<DF> x1d(q), w1d(q);
+    B.resize(q*n);
+    D.resize(q*n);
+    for (int a=0; a<q; a++)
+      {
+        x1d[a] = rule[a].position()[0];
+        w1d[a] = rule[a].weight();
+        for (int j=0; j<n; j++)
+          {
+            B[a*n+j] = phi(j,x1d[a]);
+            D[a*n+j] = dphi(j,x1d[a]);
+          }
+      }
+
+    // tensor quadrature rule, same lexicographic numbering as the basis
+    nqp = 1;
+    for (int l=0; l<dim; l++) nqp *= q;
+    points.resize(nqp);
+    weights.resize(nqp);
+    for (int p=0; p<nqp; p++)
+      {
+        int rest = p;
+        weights[p] = 1.0;
+        for (int l=0; l<dim; l++)
+          {
+            points[p][l] = x1d[rest%q];
+            weights[p] *= w1d[rest%q];
+            rest /= q;
+          }
+      }
+  }
+
+  //! number of quadrature points
+  int size () const { return nqp; }
+
+  //! position of quadrature point p on the reference element
+  const Dune::FieldVector<DF,dim>& position (int p) const { return points[p]; }
+
+  //! weight of quadrature point p
+  DF weight (int p) const { return weights[p]; }
+
+  //! evaluate the function with coefficients c at all quadrature points
+  void evaluate (const std::vector<RF>& c, std::vector<RF>& u) const
+  {
+    sweep(c,u,-1,false);
+  }
+
+  //! evaluate the reference gradient at all quadrature points
+  void evaluateGradient (const std::vector<RF>& c,
+                         std::vector<Dune::FieldVector<RF,dim> >& gradu) const
+  {
+    gradu.resize(nqp);
+    std::vector<RF> tmp;
+    for (int d=0; d<dim; d++)
+      {
+        sweep(c,tmp,d,false);
+        for (int p=0; p<nqp; p++) gradu[p][d] = tmp[p];
+      }
+  }
+
+  //! r_i += sum_p f_p phi_i(x_p)
+  void integrate (const std::vector<RF>& f, std::vector<RF>& r) const
+  {
+    std::vector<RF> tmp;
+    sweep(f,tmp,-1,true);
+    for (std::size_t i=0; i<r.size(); i++) r[i] += tmp[i];
+  }
+
+  //! r_i += sum_p g_p \cdot \hat\nabla phi_i(x_p)
+  void integrateGradient (const std::vector<Dune::FieldVector<RF,dim> >& g,
+                          std::vector<RF>& r) const
+  {
+    std::vector<RF> in(nqp), tmp;
+    for (int d=0; d<dim; d++)
+      {
+        for (int p=0; p<nqp; p++) in[p] = g[p][d];
+        sweep(in,tmp,d,true);
+        for (std::size_t i=0; i<r.size(); i++) r[i] += tmp[i];
+      }
+  }
+
+private:
+  static int pow (int base)
+  {
+    int result = 1;
+    for (int l=0; l<dim; l++) result *= base;
+    return result;
+  }
+
+  // Lagrange polynomial j on the nodes 0,1/k,...,1
+  static DF phi (int j, DF x)
+  {
+    DF result = 1.0;
+    for (int l=0; l<n; l++)
+      if (l!=j) result *= (k*x-l)/(j-l);
+    return result;
+  }
+
+  // derivative of phi(j,.)
+  static DF dphi (int j, DF x)
+  {
+    DF result = 0.0;
+    for (int m=0; m<n; m++)
+      {
+        if (m==j) continue;
+        DF prod = static_cast<DF>(k)/(j-m);
+        for (int l=0; l<n; l++)
+          if (l!=j && l!=m) prod *= (k*x-l)/(j-l);
+        result += prod;
+      }
+    return result;
+  }
+
+  // Apply the 1d matrices in all directions. In direction deriv the
+  // derivative matrix D is used, in all others the value matrix B.
+  // Without transpose n^dim coefficients are mapped to q^dim point
+  // values, with transpose the other way round.
+  void sweep (const std::vector<RF>& in, std::vector<RF>& out,
+              int deriv, bool transpose) const
+  {
+    const int m_in = transpose ? q : n;
+    const int m_out = transpose ? n : q;
+    std::vector<RF> tmp(in);
+    int inner = 1;
+    int outer = pow(m_in);
+    for (int d=0; d<dim; d++)
+      {
+        const std::vector<DF>& A = (d==deriv) ? D : B;
+        outer /= m_in;
+        out.assign(inner*m_out*outer,0.0);
+        for (int o=0; o<outer; o++)
+          for (int a=0; a<m_out; a++)
+            for (int b=0; b<m_in; b++)
+              {
+                const DF coeff = transpose ? A[b*n+a] : A[a*n+b];
+                const RF* src = &tmp[(o*m_in+b)*inner];
+                RF* dst = &out[(o*m_out+a)*inner];
+                for (int i=0; i<inner; i++)
+                  dst[i] += coeff*src[i];
+              }
+        inner *= m_out;
+        tmp.swap(out);
+      }
+    out.swap(tmp);
+  }
+
+  int q, nqp;
+  std::vector<DF> B, D;  // q x n matrices, row = quadrature point
+  std::vector<Dune::FieldVector<DF,dim> > points;
+  std::vector<DF> weights;
+};
+
+/** \brief Geometry data at the quadrature points of a sum factorization
+ *
+ * Stores K = J^{-1} J^{-T} scaled with weight and integration element,
+ * so that \nabla u \cdot \nabla v = (K \hat\nabla u) \cdot \hat\nabla v.
+ * Affine geometries (e.g. YaspGrid) are evaluated only once.
+ */
+template<typename SF, typename Geometry, typename RF, int dim>
+void sumfactGeometry (const SF& sumfact, const Geometry& geo,
+                      std::vector<RF>& factor,
+                      std::vector<Dune::FieldMatrix<RF,dim,dim> >& K)
+{
+  factor.resize(sumfact.size());
+  K.resize(sumfact.size());
+  for (int p=0; p<sumfact.size(); p++)
+    {
+      if (p>0 && geo.affine())
+        {
+          factor[p] = factor[0]/sumfact.weight(0)*sumfact.weight(p);
+          K[p] = K[0];
+          K[p] *= factor[p]/factor[0];
+          continue;
+        }
+      const typename Geometry::JacobianInverseTransposed
+        jit = geo.jacobianInverseTransposed(sumfact.position(p));
+      factor[p] = sumfact.weight(p)*geo.integrationElement(sumfact.position(p));
+      for (int i=0; i<dim; i++)
+        for (int j=0; j<dim; j++)
+          {
+            K[p][i][j] = 0.0;
+            for (int l=0; l<dim; l++)
+              K[p][i][j] += jit[l][i]*jit[l][j];
+            K[p][i][j] *= factor[p];
+          }
+    }
+}
+
+/** \brief Sum-factorized version of Example05LocalOperator for Q_k, k>=2
+ *
+ * Same residual as Example05LocalOperator, but restricted to cube
+ * elements with QkLocalFiniteElementMap. Instead of the numerical
+ * Jacobian an exact linearization is provided, both matrix-free
+ * (jacobian_apply_volume, for Krylov solvers) and assembled
+ * (jacobian_volume, computed column by column with the same kernel).
+ */
+template<int k, int dim>
+class Example05SumFactLocalOperator :
+  public Dune::PDELab::FullVolumePattern,
+  public Dune::PDELab::LocalOperatorDefaultFlags,
+  public Dune::PDELab::InstationaryLocalOperatorDefaultMethods<double>
+{
+  typedef QkSumFactorization<double,double,k,dim> SumFact;
+
+public:
+  // pattern assembly flags
+  enum { doPatternVolume = true };
+
+  // residual assembly flags
+  enum { doAlphaVolume = true };
+
+  // constructor stores parameters
+  Example05SumFactLocalOperator (double d_0_, double d_1_, double lambda_, double sigma_,
+                                 double kappa_, unsigned int intorder_=2)
+    : sumfact(intorder_), d_0(d_0_), d_1(d_1_), lambda(lambda_),
+      sigma(sigma_), kappa(kappa_)
+  {}
+
+  // volume integral depending on test and ansatz functions
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv, R& r) const
+  {
+    const typename LFSU::template Child<0>::Type& lfsu0 = lfsu.template child<0>();
+    const typename LFSU::template Child<1>::Type& lfsu1 = lfsu.template child<1>();
+
+    // gather coefficients
+    std::vector<double> x0(lfsu0.size()), x1(lfsu1.size());
+    for (std::size_t i=0; i<lfsu0.size(); i++) x0[i] = x(lfsu0,i);
+    for (std::size_t i=0; i<lfsu1.size(); i++) x1[i] = x(lfsu1,i);
+
+    // values and gradients at all quadrature points
+    std::vector<double> u0, u1;
+    std::vector<Dune::FieldVector<double,dim> > gradu0, gradu1;
+    sumfact.evaluate(x0,u0);
+    sumfact.evaluate(x1,u1);
+    sumfact.evaluateGradient(x0,gradu0);
+    sumfact.evaluateGradient(x1,gradu1);
+
+    std::vector<double> factor;
+    std::vector<Dune::FieldMatrix<double,dim,dim> > K;
+    sumfactGeometry(sumfact,eg.geometry(),factor,K);
+
+    // pointwise fluxes and sources
+    std::vector<Dune::FieldVector<double,dim> > flux0(sumfact.size()), flux1(sumfact.size());
+    std::vector<double> f0(sumfact.size()), f1(sumfact.size());
+    for (int p=0; p<sumfact.size(); p++)
+      {
+        K[p].mv(gradu0[p],flux0[p]); flux0[p] *= d_0;
+        K[p].mv(gradu1[p],flux1[p]); flux1[p] *= d_1;
+        f0[p] = -(lambda*u0[p]-u0[p]*u0[p]*u0[p]-sigma*u1[p]+kappa)*factor[p];
+        f1[p] = -(u0[p]-u1[p])*factor[p];
+      }
+
+    // integrate against all test functions
+    std::vector<double> r0(lfsv.template child<0>().size(),0.0);
+    std::vector<double> r1(lfsv.template child<1>().size(),0.0);
+    sumfact.integrateGradient(flux0,r0);
+    sumfact.integrate(f0,r0);
+    sumfact.integrateGradient(flux1,r1);
+    sumfact.integrate(f1,r1);
+    for (std::size_t i=0; i<r0.size(); i++) r.accumulate(lfsv.template child<0>(),i,r0[i]);
+    for (std::size_t i=0; i<r1.size(); i++) r.accumulate(lfsv.template child<1>(),i,r1[i]);
+  }
+
+  // apply the Jacobian linearized at x to z without assembling it
+  template<typename EG, typename LFSU, typename X, typename Z, typename LFSV, typename Y>
+  void jacobian_apply_volume (const EG& eg, const LFSU& lfsu, const X& x, const Z& z,
+                              const LFSV& lfsv, Y& y) const
+  {
+    const typename LFSU::template Child<0>::Type& lfsu0 = lfsu.template child<0>();
+    const typename LFSU::template Child<1>::Type& lfsu1 = lfsu.template child<1>();
+
+    std::vector<double> x0(lfsu0.size()), z0(lfsu0.size()), z1(lfsu1.size());
+    for (std::size_t i=0; i<lfsu0.size(); i++) { x0[i] = x(lfsu0,i); z0[i] = z(lfsu0,i); }
+    for (std::size_t i=0; i<lfsu1.size(); i++) z1[i] = z(lfsu1,i);
+
+    std::vector<double> u0, factor;
+    std::vector<Dune::FieldMatrix<double,dim,dim> > K;
+    sumfact.evaluate(x0,u0);
+    sumfactGeometry(sumfact,eg.geometry(),factor,K);
+
+    std::vector<double> y0(z0.size(),0.0), y1(z1.size(),0.0);
+    linearizedApply(u0,factor,K,z0,z1,y0,y1);
+    for (std::size_t i=0; i<y0.size(); i++) y.accumulate(lfsv.template child<0>(),i,y0[i]);
+    for (std::size_t i=0; i<y1.size(); i++) y.accumulate(lfsv.template child<1>(),i,y1[i]);
+  }
+
+  // jacobian of volume term, assembled column by column with the sum-factorized kernel
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename M>
+  void jacobian_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv,
+                        M& mat) const
+  {
+    const typename LFSU::template Child<0>::Type& lfsu0 = lfsu.template child<0>();
+    const typename LFSU::template Child<1>::Type& lfsu1 = lfsu.template child<1>();
+    const typename LFSV::template Child<0>::Type& lfsv0 = lfsv.template child<0>();
+    const typename LFSV::template Child<1>::Type& lfsv1 = lfsv.template child<1>();
+
+    std::vector<double> x0(lfsu0.size());
+    for (std::size_t i=0; i<lfsu0.size(); i++) x0[i] = x(lfsu0,i);
+
+    std::vector<double> u0, factor;
+    std::vector<Dune::FieldMatrix<double,dim,dim> > K;
+    sumfact.evaluate(x0,u0);
+    sumfactGeometry(sumfact,eg.geometry(),factor,K);
+
+    std::vector<double> z0(lfsu0.size(),0.0), z1(lfsu1.size(),0.0);
+    std::vector<double> y0(lfsv0.size()), y1(lfsv1.size());
+    for (std::size_t j=0; j<lfsu0.size(); j++)
+      {
+        z0[j] = 1.0;
+        std::fill(y0.begin(),y0.end(),0.0);
+        std::fill(y1.begin(),y1.end(),0.0);
+        linearizedApply(u0,factor,K,z0,z1,y0,y1);
+        for (std::size_t i=0; i<y0.size(); i++) mat.accumulate(lfsv0,i,lfsu0,j,y0[i]);
+        for (std::size_t i=0; i<y1.size(); i++) mat.accumulate(lfsv1,i,lfsu0,j,y1[i]);
+        z0[j] = 0.0;
+      }
+    for (std::size_t j=0; j<lfsu1.size(); j++)
+      {
+        z1[j] = 1.0;
+        std::fill(y0.begin(),y0.end(),0.0);
+        std::fill(y1.begin(),y1.end(),0.0);
+        linearizedApply(u0,factor,K,z0,z1,y0,y1);
+        for (std::size_t i=0; i<y0.size(); i++) mat.accumulate(lfsv0,i,lfsu1,j,y0[i]);
+        for (std::size_t i=0; i<y1.size(); i++) mat.accumulate(lfsv1,i,lfsu1,j,y1[i]);
+        z1[j] = 0.0;
+      }
+  }
+
+private:
+  // y += J(u0) z for both components
+  void linearizedApply (const std::vector<double>& u0, const std::vector<double>& factor,
+                        const std::vector<Dune::FieldMatrix<double,dim,dim> >& K,
+                        const std::vector<double>& z0, const std::vector<double>& z1,
+                        std::vector<double>& y0, std::vector<double>& y1) const
+  {
+    std::vector<double> v0, v1;
+    std::vector<Dune::FieldVector<double,dim> > gradv0, gradv1;
+    sumfact.evaluate(z0,v0);
+    sumfact.evaluate(z1,v1);
+    sumfact.evaluateGradient(z0,gradv0);
+    sumfact.evaluateGradient(z1,gradv1);
+
+    std::vector<Dune::FieldVector<double,dim> > flux0(sumfact.size()), flux1(sumfact.size());
+    std::vector<double> f0(sumfact.size()), f1(sumfact.size());
+    for (int p=0; p<sumfact.size(); p++)
+      {
+        K[p].mv(gradv0[p],flux0[p]); flux0[p] *= d_0;
+        K[p].mv(gradv1[p],flux1[p]); flux1[p] *= d_1;
+        f0[p] = (-(lambda-3.0*u0[p]*u0[p])*v0[p]+sigma*v1[p])*factor[p];
+        f1[p] = (-v0[p]+v1[p])*factor[p];
+      }
+
+    sumfact.integrateGradient(flux0,y0);
+    sumfact.integrate(f0,y0);
+    sumfact.integrateGradient(flux1,y1);
+    sumfact.integrate(f1,y1);
+  }
+
+  SumFact sumfact;
+  double d_0, d_1, lambda, sigma, kappa;
+};
+
+/** \brief Sum-factorized version of Example05TimeLocalOperator for Q_k, k>=2 */
+template<int k, int dim>
+class Example05SumFactTimeLocalOperator
+  : public Dune::PDELab::FullVolumePattern,
+    public Dune::PDELab::LocalOperatorDefaultFlags,
+    public Dune::PDELab::InstationaryLocalOperatorDefaultMethods<double>
+{
+  typedef QkSumFactorization<double,double,k,dim> SumFact;
+
+public:
+  // pattern assembly flags
+  enum { doPatternVolume = true };
+
+  // residual assembly flags
+  enum { doAlphaVolume = true };
+
+  // constructor remembers parameters
+  Example05SumFactTimeLocalOperator (double tau_, unsigned int intorder_=2)
+    : sumfact(intorder_), tau(tau_) {}
+
+  // volume integral depending on test and ansatz functions
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv, R& r) const
+  {
+    const typename LFSU::template Child<0>::Type& lfsu0 = lfsu.template child<0>();
+    const typename LFSU::template Child<1>::Type& lfsu1 = lfsu.template child<1>();
+
+    std::vector<double> x0(lfsu0.size()), x1(lfsu1.size());
+    for (std::size_t i=0; i<lfsu0.size(); i++) x0[i] = x(lfsu0,i);
+    for (std::size_t i=0; i<lfsu1.size(); i++) x1[i] = x(lfsu1,i);
+
+    std::vector<double> r0(x0.size(),0.0), r1(x1.size(),0.0);
+    apply(eg.geometry(),x0,x1,r0,r1);
+    for (std::size_t i=0; i<r0.size(); i++) r.accumulate(lfsv.template child<0>(),i,r0[i]);
+    for (std::size_t i=0; i<r1.size(); i++) r.accumulate(lfsv.template child<1>(),i,r1[i]);
+  }
+
+  // the operator is linear, so the Jacobian does not depend on x
+  template<typename EG, typename LFSU, typename X, typename Z, typename LFSV, typename Y>
+  void jacobian_apply_volume (const EG& eg, const LFSU& lfsu, const X& x, const Z& z,
+                              const LFSV& lfsv, Y& y) const
+  {
+    alpha_volume(eg,lfsu,z,lfsv,y);
+  }
+
+  // mass matrix, assembled column by column
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename M>
+  void jacobian_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv,
+                        M& mat) const
+  {
+    const typename LFSU::template Child<0>::Type& lfsu0 = lfsu.template child<0>();
+    const typename LFSU::template Child<1>::Type& lfsu1 = lfsu.template child<1>();
+    const typename LFSV::template Child<0>::Type& lfsv0 = lfsv.template child<0>();
+    const typename LFSV::template Child<1>::Type& lfsv1 = lfsv.template child<1>();
+
+    // the components do not couple, and both use the same scalar mass matrix
+    std::vector<double> z(lfsu0.size(),0.0), empty(lfsu1.size(),0.0);
+    std::vector<double> y0(lfsv0.size()), y1(lfsv1.size());
+    for (std::size_t j=0; j<lfsu0.size(); j++)
+      {
+        z[j] = 1.0;
+        std::fill(y0.begin(),y0.end(),0.0);
+        std::fill(y1.begin(),y1.end(),0.0);
+        apply(eg.geometry(),z,empty,y0,y1);
+        for (std::size_t i=0; i<y0.size(); i++)
+          {
+            mat.accumulate(lfsv0,i,lfsu0,j,y0[i]);
+            mat.accumulate(lfsv1,i,lfsu1,j,tau*y0[i]);
+          }
+        z[j] = 0.0;
+      }
+  }
+
+private:
+  template<typename Geometry>
+  void apply (const Geometry& geo, const std::vector<double>& x0, const std::vector<double>& x1,
+              std::vector<double>& r0, std::vector<double>& r1) const
+  {
+    std::vector<double> u0, u1;
+    sumfact.evaluate(x0,u0);
+    sumfact.evaluate(x1,u1);
+    for (int p=0; p<sumfact.size(); p++)
+      {
+        const double factor = sumfact.weight(p)*geo.integrationElement(sumfact.position(p));
+        u0[p] *= factor;
+        u1[p] *= tau*factor;
+      }
+    sumfact.integrate(u0,r0);
+    sumfact.integrate(u1,r1);
+  }
+
+  SumFact sumfact;
+  double tau;
+};
@@ -7,6 +7,7 @@
 #include "config.h"
 #endif
 #include<math.h>
+#include<algorithm>
 #include<iostream>
 #include<vector>
 #include<map>
@@ -44,6 +45,9 @@
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
 
+#include"../utility/timestepcontrol.hh"
+#include"../utility/imex.hh"
+
 #include"example05_operator.hh"
 #include"example05_toperator.hh"
 #include"example05_initial.hh"
@@ -67,10 +71,10 @@ int main(int argc, char** argv)
           std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
       }
 
-    if (argc!=6)
+    if (argc!=6 && argc!=7)
       {
         if(helper.rank()==0)
-          std::cout << "usage: ./example06 <coarse_size> <level> <dtstart> <dtmax> <tend>" << std::endl;
+          std::cout << "usage: ./example06 <coarse_size> <level> <dtstart> <dtmax> <tend> [newton|fixed|imex]" << std::endl;
         return 1;
       }
 
@@ -89,6 +93,14 @@ int main(int argc, char** argv)
     double tend;
     sscanf(argv[5],"%lg",&tend);
 
+    // time step control: from Newton convergence (default), fixed growth
+    // or IMEX time stepping limited by the explicit reaction part
+    std::string control("newton");
+    if (argc==7)
+      control = argv[6];
+    if (control!="newton" && control!="fixed" && control!="imex")
+      DUNE_THROW(Dune::Exception,"unknown step control " << control);
+
     // 2D
     {
       // make grid
@@ -100,7 +112,7 @@ int main(int argc, char** argv)
       grid.globalRefine(level);
       typedef Dune::YaspGrid<2>::LeafGridView GV;
       const GV& gv=grid.leafGridView();
-      example06_Q1Q1(gv,dtstart,dtmax,tend);
+      example06_Q1Q1(gv,dtstart,dtmax,tend,control);
     }
   }
   catch (Dune::Exception &e){
@@ -1,5 +1,46 @@
+/** Newton's method that records its work over all stages of a time step.
+ *  The one step method calls apply for every stage; failed solves count as
+ *  well since their iterations have been spent.
+ */
+template<class IGO, class LS, class U>
+class CountingNewton : public Dune::PDELab::Newton<IGO,LS,U>
+{
+  typedef Dune::PDELab::Newton<IGO,LS,U> Base;
+public:
+  CountingNewton (IGO& igo, LS& ls)
+    : Base(igo,ls), iterations(0), step_iterations(0), stage_solves(0), contraction(0.0)
+  {}
+
+  void apply (U& u)
+  {
+    stage_solves++;
+    try {
+      Base::apply(u);
+    }
+    catch (...) {
+      iterations += this->result().iterations;
+      throw;
+    }
+    iterations += this->result().iterations;
+    contraction = std::max(contraction,double(this->result().conv_rate));
+  }
+
+  //! reset the counters of the current step
+  void startStep () { step_iterations = iterations; stage_solves = 0; contraction = 0.0; }
+  double iterationsPerStage () const
+  {
+    return stage_solves>0 ? double(iterations-step_iterations)/stage_solves : 0.0;
+  }
+
+  int iterations;        // total over the simulation
+  int step_iterations;   // total at the start of the current step
+  int stage_solves;      // stages solved in the current step
+  double contraction;    // worst contraction rate in the current step
+};
+
 template<class GV>
-void example06_Q1Q1 (const GV& gv, double dtstart, double dtmax, double tend)
+void example06_Q1Q1 (const GV& gv, double dtstart, double dtmax, double tend,
+                     std::string control)
 {
   // <<<1>>> Choose domain and range field type
   typedef typename GV::Grid::ctype Coord;
@@ -74,7 +115,7 @@ void example06_Q1Q1 (const GV& gv, double dtstart, double dtmax, double tend)
   LS ls(gfs,cc,5000,5,1);
 
   // <<<6>>> Solver for non-linear problem per stage
-  typedef Dune::PDELab::Newton<IGO,LS,U> PDESOLVER;
+  typedef CountingNewton<IGO,LS,U> PDESOLVER;
   PDESOLVER pdesolver(igo,ls);
   pdesolver.setReassembleThreshold(0.0);
   pdesolver.setVerbosityLevel(2);
@@ -97,14 +138,84 @@ void example06_Q1Q1 (const GV& gv, double dtstart, double dtmax, double tend)
     fn.increment();
   }
 
-  // <<<9>>> time loop
+  // <<<9>>> IMEX alternative: only the linear diffusion is implicit, its
+  // matrix is assembled once and the stage matrix with its AMG hierarchy
+  // is only rebuilt when dt changes; the reaction is explicit, so there is
+  // no Newton iteration, but dt is limited by its spectral radius
+  if (control=="imex")
+    {
+      LOP dlop(d_0,d_1,lambda,sigma,kappa,2,LOP::diffusion);
+      LOP rlop(d_0,d_1,lambda,sigma,kappa,2,LOP::reaction);
+      GO0 god(gfs,cc,gfs,cc,dlop,mbe);
+      GO0 gor(gfs,cc,gfs,cc,rlop,mbe);
+      typedef Dune::PDELab::ISTLBackend_CG_AMG_SSOR<GO0> ILS;
+      ILS ils(gfs,5000,0);
+      ARS222Parameter<Real> imexmethod;
+      IMEXRungeKutta<GO0,GO0,GO1,ILS,U> imex(imexmethod,god,gor,go1,ils);
+      imex.setVerbosityLevel(gv.comm().rank()==0 ? 1 : 0);
+
+      U unew(gfs,0.0);
+      double dt = dtstart;
+      int steps = 0;
+      Dune::Timer watch;
+      while (time<tend-1e-8)
+        {
+          dt = imex.suggestTimestep(uold,dt,dtmax);
+          const double h = std::min(dt,tend-time);
+          imex.apply(time,h,uold,unew);
+
+          // graphics
+          Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
+          Dune::PDELab::addSolutionToVTKWriter(vtkwriter,gfs,unew);
+          vtkwriter.write(fn.getName(),Dune::VTK::appendedraw);
+          fn.increment();
+
+          uold = unew;
+          time += h;
+          steps++;
+        }
+      const double elapsed = gv.comm().max(watch.elapsed());
+      if (gv.comm().rank()==0)
+        std::cout << "step control: imex (" << imexmethod.name() << ")"
+                  << " steps=" << steps
+                  << " linear solves=" << imex.linearSolves()
+                  << " matrix setups=" << imex.matrixSetups()
+                  << " wall time=" << elapsed << " s"
+                  << " per simulated time unit=" << elapsed/tend << " s" << std::endl;
+      return;
+    }
+
+  // <<<10>>> time loop; with newton_control the step size is chosen from the
+  // convergence of Newton's method, a failed step is repeated with half the
+  // step size starting from uold, otherwise dt grows by a fixed factor 1.1
+  // and a failure aborts the simulation
+  const bool newton_control = (control=="newton");
   U unew(gfs,0.0);
   unew = uold;
   double dt = dtstart;
+  NewtonStepController controller(5.0,1e-4*dtstart,dtmax);
+  int steps = 0;
+  Dune::Timer watch;
   while (time<tend-1e-8)
     {
       // do time step
-      osm.apply(time,dt,uold,unew);
+      pdesolver.startStep();
+      if (newton_control)
+        {
+          dt = std::min(dt,tend-time);
+          try {
+            osm.apply(time,dt,uold,unew);
+          }
+          catch (Dune::PDELab::NewtonError& e) {
+            if (gv.comm().rank()==0)
+              std::cout << "Newton failed with dt=" << dt << ", repeating step" << std::endl;
+            unew = uold;   // copy into the existing vector, no reallocation
+            dt = controller.reject(dt);
+            continue;
+          }
+        }
+      else
+        osm.apply(time,dt,uold,unew);
 
       // graphics
       Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
@@ -114,7 +225,20 @@ void example06_Q1Q1 (const GV& gv, double dtstart, double dtmax, double tend)
 
       uold = unew;
       time += dt;
-      if (dt<dtmax-1e-8)
+      steps++;
+      if (newton_control)
+        dt = controller.next(dt,pdesolver.iterationsPerStage(),pdesolver.contraction);
+      else if (dt<dtmax-1e-8)
         dt = std::min(dt*1.1,dtmax);
     }
+
+  // <<<11>>> work of the whole simulation
+  const double elapsed = gv.comm().max(watch.elapsed());
+  if (gv.comm().rank()==0)
+    std::cout << "step control: " << (newton_control ? "newton" : "fixed")
+              << " steps=" << steps
+              << " rejected=" << controller.rejectedSteps()
+              << " Newton iterations=" << pdesolver.iterations
+              << " wall time=" << elapsed << " s"
+              << " per simulated time unit=" << elapsed/tend << " s" << std::endl;
 }
@@ -47,11 +47,15 @@
 
 #include<dune/pdelab/adaptivity/adaptivity.hh>
 
+#include"../utility/parallelmarking.hh"
+#include"../utility/loadbalancing.hh"
+
 #include"example02_bctype.hh"
 #include"example02_bcextension.hh"
 #include"example02_operator.hh"
 #include"example07_error_indicator.hh"
 #include"example07_adaptivity.hh"
+#include"example07_parallel.hh"
 
 //===============================================================
 // Main program with grid setup
@@ -107,6 +111,29 @@ int main(int argc, char** argv)
       adaptivity(*grid,gv,startLevel,maxLevel);
 #else
       std::cout << "This example requires UG!" << std::endl;
+#endif
+    }
+
+    // parallel version with dynamic load balancing
+    if (helper.size()>1)
+    {
+#if HAVE_UG
+      // make grid on rank 0 and distribute it
+      const int dim = 2;
+      typedef Dune::UGGrid<dim> Grid;
+      Dune::FieldVector<Grid::ctype, dim> ll(0.0);
+      Dune::FieldVector<Grid::ctype, dim> ur(1.0);
+      std::array<unsigned int, dim> elements;
+      std::fill(elements.begin(), elements.end(), 1);
+
+      std::shared_ptr<Grid> grid = Dune::StructuredGridFactory<Grid>::createSimplexGrid(ll, ur, elements);
+      grid->globalRefine(startLevel);
+      grid->loadBalance();
+
+      adaptivity_parallel(*grid,startLevel,maxLevel);
+#else
+      if(helper.rank()==0)
+        std::cout << "This example requires UG!" << std::endl;
 #endif
     }
   }
@@ -28,8 +28,29 @@ void adaptivity (Grid& grid, const GV& gv, int startLevel, int maxLevel)
   G g(gv);
   Dune::PDELab::interpolate(g,gfs,u);                    // interpolate coefficient vector
 
+  // <<<5>>> Make grid operator and linear solver once; they refer to gfs and cc,
+  // which are updated in place after each adaptation step
+  typedef Example02LocalOperator<BCTypeParam> LOP;       // operator including boundary
+  LOP lop(bctype);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(7);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+  GO go(gfs,cc,gfs,cc,lop,mbe);
+
+  // Select a linear solver backend
+  typedef Dune::PDELab::ISTLBackend_SEQ_CG_SSOR LS;
+  LS ls(5000,true);
+
+  // The first solve reduces the defect by 1e-10. On the following levels u is
+  // the solution transferred from the previous grid, so we only ask for the
+  // same absolute defect instead of a relative reduction of a small defect.
+  double min_defect = 1e-99;
+  double cumulative_time = 0.0;
+  int cumulative_iterations = 0;
+
   for (int i = 0; i <= maxLevel - startLevel; i++)
   {
+    Dune::Timer timer;
     std::stringstream s;
     s << i;
     std::string iter;
@@ -38,32 +59,23 @@ void adaptivity (Grid& grid, const GV& gv, int startLevel, int maxLevel)
     std::cout << "constrained dofs=" << cc.size()
             << " of " << gfs.globalSize() << std::endl;
 
-    //  Make grid operator
-    typedef Example02LocalOperator<BCTypeParam> LOP;       // operator including boundary
-    LOP lop(bctype);
-    typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
-    MBE mbe(7);
-    typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
-    GO go(gfs,cc,gfs,cc,lop,mbe);
-
-    // Select a linear solver backend
-    typedef Dune::PDELab::ISTLBackend_SEQ_CG_SSOR LS;
-    LS ls(5000,true);
-
     // Select linear problem solver
     typedef Dune::PDELab::StationaryLinearProblemSolver<GO,LS,U> SLP;
-    SLP slp(go,ls,u,1e-10);
+    SLP slp(go,ls,u,1e-10,min_defect);
 
     // Preparation: Define types for the computation of the error estimate eta.
     typedef Dune::PDELab::P0LocalFiniteElementMap<Coord,Real,dim> P0FEM;
     P0FEM p0fem(Dune::GeometryType(Dune::GeometryType::simplex,dim));
     typedef Dune::PDELab::GridFunctionSpace<GV,P0FEM,Dune::PDELab::NoConstraints,VBE> P0GFS;
-    typedef Dune::PDELab::ExampleErrorEstimator ESTLOP;
+    typedef Dune::PDELab::ExampleErrorEstimator<GV> ESTLOP;
     typedef Dune::PDELab::EmptyTransformation NoTrafo;
     using U0 = Dune::PDELab::Backend::Vector<P0GFS,Real>;
 
     // <<<8>>> Solve linear problem.
     slp.apply();
+    if (i==0)
+      min_defect = 1e-10*slp.result().first_defect;
+    cumulative_iterations += slp.result().linear_solver_iterations;
 
     // <<<9>>> graphical output
     Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
@@ -72,7 +84,7 @@ void adaptivity (Grid& grid, const GV& gv, int startLevel, int maxLevel)
 
     // <<<10>>> compute estimated error eta
     P0GFS p0gfs(gv,p0fem);
-    ESTLOP estlop;
+    ESTLOP estlop(gv);
     typedef Dune::PDELab::GridOperator<GFS,P0GFS,ESTLOP,MBE,Real,Real,Real,NoTrafo,NoTrafo> ESTGO;
     ESTGO estgo(gfs,p0gfs,estlop,mbe);
     U0 eta(p0gfs,0.0);
@@ -81,6 +93,20 @@ void adaptivity (Grid& grid, const GV& gv, int startLevel, int maxLevel)
     for (unsigned int i=0; i<eta.flatsize(); i++)
       eta.base()[i] = sqrt(eta.base()[i]); // eta contains squares
 
+    // global estimate, summed over interior elements of all ranks
+    typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+      InteriorIterator;
+    Real eta_sum = 0.0;
+    for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      {
+        const Real eta_T = eta.base()[gv.indexSet().index(*it)];
+        eta_sum += eta_T*eta_T;
+      }
+    eta_sum = gv.comm().sum(eta_sum);
+    if (gv.comm().rank()==0)
+      std::cout << "estimated error: " << sqrt(eta_sum) << std::endl;
+
     // Use eta to refine the grid following two different strategies based
     // (1) element fraction
     // (2) error fraction
@@ -92,15 +118,27 @@ void adaptivity (Grid& grid, const GV& gv, int startLevel, int maxLevel)
     int verbose = 0;
 
     // <<<10>>> Adapt the grid locally...
+    // The thresholds are selected over the interior elements of all ranks,
+    // so every rank marks with the same values.
     // with strategy 1:
-    Dune::PDELab::element_fraction( eta, alpha, beta, eta_alpha, eta_beta, verbose );
+    parallel_element_fraction( gv, eta, alpha, beta, eta_alpha, eta_beta, verbose );
     // or, alternatively, with strategy 2:
-    //Dune::PDELab::error_fraction( eta, alpha, beta, eta_alpha, eta_beta, verbose );
+    //parallel_error_fraction( gv, eta, alpha, beta, eta_alpha, eta_beta, verbose );
 
-    Dune::PDELab::mark_grid( grid, eta, eta_alpha, 0.0 ,0 , 100, verbose);
+    parallel_mark_grid( grid, eta, eta_alpha, 0.0 ,0 , 100, verbose);
     Dune::PDELab::adapt_grid( grid, gfs, u, 2 );
 
+    // Reassemble constraints and set the Dirichlet values on the new
+    // constrained dofs; all other dofs keep the transferred solution,
+    // which is the initial guess on the next level.
     Dune::PDELab::constraints(bctype,gfs,cc);
-    Dune::PDELab::interpolate(g,gfs,u); // this will overwrite the solution !
+    U ug(gfs,0.0);
+    Dune::PDELab::interpolate(g,gfs,ug);
+    Dune::PDELab::copy_constrained_dofs(cc,ug,u);
+
+    cumulative_time += timer.elapsed();
+    std::cout << "time for iteration " << iter << ": " << timer.elapsed()
+              << " s, cumulative: " << cumulative_time << " s, "
+              << cumulative_iterations << " linear iterations" << std::endl;
   }
 }
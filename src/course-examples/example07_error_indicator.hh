@@ -14,10 +14,15 @@ namespace Dune {
      *   However, the second order derivatives are ignored!
      * - Convection/reaction terms are ignored
      *
+     * The element diameters are computed once in the constructor, so the
+     * operator has to be constructed again after the grid has changed.
      */
+    template<typename GV>
     class ExampleErrorEstimator
       : public Dune::PDELab::LocalOperatorDefaultFlags
     {
+      typedef typename GV::Grid::ctype DF;
+      typedef typename GV::Traits::template Codim<0>::Iterator ElementIterator;
 
     public:
       // pattern assembly flags
@@ -27,6 +32,13 @@ namespace Dune {
       // residual assembly flags
       enum { doAlphaSkeleton  = true };
 
+      ExampleErrorEstimator (const GV& gv_)
+        : gv(gv_), h(gv_.size(0))
+      {
+        for (ElementIterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+          h[gv.indexSet().index(*it)] = diameter(it->geometry());
+      }
+
       // skeleton integral depending on test and ansatz functions
       // each face is only visited ONCE!
       template<typename IG,
@@ -40,8 +52,6 @@ namespace Dune {
                            R& r_s, R& r_n) const
       {
         // domain and range field type
-        typedef typename LFSU::Traits::FiniteElementType::
-          Traits::LocalBasisType::Traits::DomainFieldType DF;
         typedef typename LFSU::Traits::FiniteElementType::
           Traits::LocalBasisType::Traits::RangeFieldType RF;
         typedef typename LFSU::Traits::FiniteElementType::
@@ -96,8 +106,8 @@ namespace Dune {
           }
 
         // accumulate indicator
-        DF h_T = std::max( diameter(ig.inside()->geometry()),
-                           diameter(ig.outside()->geometry()) );
+        DF h_T = std::max( h[gv.indexSet().index(*ig.inside())],
+                           h[gv.indexSet().index(*ig.outside())] );
 
         r_s.accumulate(lfsv_s,0,h_T*sum);
         r_n.accumulate(lfsv_n,0,h_T*sum);
@@ -108,9 +118,8 @@ namespace Dune {
     private:
 
       template<class GEO>
-      typename GEO::ctype diameter (const GEO& geo) const
+      static DF diameter (const GEO& geo)
       {
-        typedef typename GEO::ctype DF;
         DF hmax = -1.0E00;
         const int dim = GEO::coorddimension;
         for (int i=0; i<geo.corners(); i++)
@@ -126,6 +135,9 @@ namespace Dune {
         return hmax;
       }
 
+      GV gv;
+      std::vector<DF> h; // diameters indexed by element index
+
     };
 
   }
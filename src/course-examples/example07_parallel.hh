@@ -0,0 +1,224 @@
+// sends a vector per element from the interior elements to their ghost copies
+template<typename GV, typename T>
+class ElementDataHandle
+  : public Dune::CommDataHandleIF<ElementDataHandle<GV,T>,T>
+{
+public:
+  ElementDataHandle (const GV& gv_, std::vector<T>& data_)
+    : gv(gv_), data(data_)
+  {}
+
+  bool contains (int dim, int codim) const { return codim==0; }
+  bool fixedsize (int dim, int codim) const { return true; }
+
+  template<typename E>
+  std::size_t size (const E& e) const { return 1; }
+
+  template<typename MessageBuffer, typename E>
+  void gather (MessageBuffer& buff, const E& e) const
+  {
+    buff.write(data[gv.indexSet().index(e)]);
+  }
+
+  template<typename MessageBuffer, typename E>
+  void scatter (MessageBuffer& buff, const E& e, std::size_t n)
+  {
+    buff.read(data[gv.indexSet().index(e)]);
+  }
+
+private:
+  const GV& gv;
+  std::vector<T>& data;
+};
+
+// largest distance of two corners, as in ExampleErrorEstimator
+template<typename Geometry>
+double element_diameter (const Geometry& geo)
+{
+  double h = 0.0;
+  for (int i=0; i<geo.corners(); i++)
+    for (int j=i+1; j<geo.corners(); j++)
+      {
+        typename Geometry::GlobalCoordinate d = geo.corner(j);
+        d -= geo.corner(i);
+        h = std::max(h,d.two_norm());
+      }
+  return h;
+}
+
+/* Add the jump terms of ExampleErrorEstimator on faces between ranks to
+ * the squared indicators eta2. The assembly on the nonoverlapping entity
+ * set skips these faces, which would make the indicators depend on the
+ * partition. The gradient of the P1 solution is constant on a simplex,
+ * so it is evaluated at the center of every interior element and sent to
+ * the ghost copies; each rank then adds the jump to its own element.
+ */
+template<typename GV, typename GFS, typename U, typename U0>
+void add_partition_jumps (const GV& gv, const GFS& gfs, const U& u, U0& eta2)
+{
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    InteriorIterator;
+  typedef typename GV::IntersectionIterator IntersectionIterator;
+  const int dim = GV::dimension;
+  typedef Dune::FieldVector<double,dim> Gradient;
+
+  typedef Dune::PDELab::DiscreteGridFunctionGradient<GFS,U> DGFG;
+  DGFG dgfg(gfs,u);
+  std::vector<Gradient> gradient(gv.size(0),Gradient(0.0));
+  for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    {
+      typename DGFG::Traits::RangeType g;
+      dgfg.evaluate(*it,it->geometry().local(it->geometry().center()),g);
+      gradient[gv.indexSet().index(*it)] = g;
+    }
+  ElementDataHandle<GV,Gradient> handle(gv,gradient);
+  gv.communicate(handle,Dune::InteriorBorder_All_Interface,Dune::ForwardCommunication);
+
+  for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    for (IntersectionIterator iit=gv.ibegin(*it); iit!=gv.iend(*it); ++iit)
+      {
+        if (!iit->neighbor() || iit->outside()->partitionType()!=Dune::GhostEntity)
+          continue;
+        const double jump = iit->centerUnitOuterNormal()*gradient[gv.indexSet().index(*it)]
+          - iit->centerUnitOuterNormal()*gradient[gv.indexSet().index(*iit->outside())];
+        const double h_T = std::max(element_diameter(it->geometry()),
+                                    element_diameter(iit->outside()->geometry()));
+        Dune::PDELab::Backend::native(eta2)[gv.indexSet().index(*it)]
+          += h_T*0.25*jump*jump*iit->geometry().volume();
+      }
+}
+
+template<class Grid>
+void adaptivity_parallel (Grid& grid, int startLevel, int maxLevel)
+{
+  // <<<1>>> Choose domain and range field type
+  typedef typename Grid::LeafGridView GV;
+  typedef typename Grid::ctype Coord;
+  typedef double Real;
+  const int dim = GV::dimension;
+  GV gv = grid.leafGridView();
+  typedef Dune::PDELab::NonOverlappingEntitySet<GV> ES;
+  ES es(gv);
+
+  // <<<2>>> Make grid function space
+  typedef Dune::PDELab::PkLocalFiniteElementMap<ES,Coord,Real,1> FEM;
+  FEM fem(es);
+  typedef Dune::PDELab::ConformingDirichletConstraints CON;     // constraints class
+  typedef Dune::PDELab::istl::VectorBackend<> VBE;
+  typedef Dune::PDELab::GridFunctionSpace<ES,FEM,CON,VBE> GFS;
+  CON con;
+  GFS gfs(es,fem,con);
+  gfs.name("solution");
+
+  // <<<3>>> assemble constraints on this space
+  BCTypeParam bctype; // boundary condition type
+  typedef typename GFS::template ConstraintsContainer<Real>::Type CC;
+  CC cc;
+  Dune::PDELab::constraints( bctype, gfs, cc, false );
+
+  // <<<4>>> make DOF vector
+  using U = Dune::PDELab::Backend::Vector<GFS,Real>;
+  U u(gfs,0.0);
+  typedef BCExtension<GV,Real> G;                        // boundary value + extension
+  G g(gv);
+  Dune::PDELab::interpolate(g,gfs,u);                    // interpolate coefficient vector
+
+  // <<<5>>> Make grid operator once; it follows the changes of the space
+  typedef Example02LocalOperator<BCTypeParam> LOP;       // operator including boundary
+  LOP lop(bctype);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(7);
+  typedef Dune::PDELab::GridOperator<GFS,GFS,LOP,MBE,Real,Real,Real,CC,CC> GO;
+  GO go(gfs,cc,gfs,cc,lop,mbe);
+  typedef Dune::PDELab::ISTLBackend_NOVLP_CG_SSORk<GO> LS;
+
+  double min_defect = 1e-99;
+  const int rank = gv.comm().rank();
+
+  for (int i = 0; i <= maxLevel - startLevel; i++)
+  {
+    Dune::Timer timer;
+    std::stringstream s;
+    s << i;
+    std::string iter;
+    s >> iter;
+
+    // <<<6>>> Solve linear problem. The backend keeps a parallel helper
+    // of the space, so it is built for the adapted and rebalanced grid.
+    LS ls(go,5000,3,0);
+    typedef Dune::PDELab::StationaryLinearProblemSolver<GO,LS,U> SLP;
+    SLP slp(go,ls,u,1e-10,min_defect);
+    slp.apply();
+    if (i==0)
+      min_defect = 1e-10*slp.result().first_defect;
+
+    // <<<7>>> graphical output, one piece per rank
+    Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
+    Dune::PDELab::addSolutionToVTKWriter(vtkwriter,gfs,u);
+    vtkwriter.write("adaptivity_parallel_"+iter,Dune::VTK::appendedraw);
+
+    // <<<8>>> compute estimated error eta on the interior elements; the
+    // faces between ranks are added separately, so eta does not depend on
+    // the partition
+    typedef Dune::PDELab::P0LocalFiniteElementMap<Coord,Real,dim> P0FEM;
+    P0FEM p0fem(Dune::GeometryType(Dune::GeometryType::simplex,dim));
+    typedef Dune::PDELab::GridFunctionSpace<GV,P0FEM,Dune::PDELab::NoConstraints,VBE> P0GFS;
+    P0GFS p0gfs(gv,p0fem);
+    typedef Dune::PDELab::ExampleErrorEstimator<GV> ESTLOP;
+    ESTLOP estlop(gv);
+    typedef Dune::PDELab::EmptyTransformation NoTrafo;
+    typedef Dune::PDELab::GridOperator<GFS,P0GFS,ESTLOP,MBE,Real,Real,Real,NoTrafo,NoTrafo> ESTGO;
+    ESTGO estgo(gfs,p0gfs,estlop,mbe);
+    using U0 = Dune::PDELab::Backend::Vector<P0GFS,Real>;
+    U0 eta(p0gfs,0.0);
+    estgo.residual(u,eta);
+    add_partition_jumps(gv,gfs,u,eta);
+    for (unsigned int i=0; i<eta.flatsize(); i++)
+      eta.base()[i] = sqrt(eta.base()[i]); // eta contains squares
+
+    // <<<9>>> Adapt the grid with thresholds that are the same on all ranks
+    double alpha(0.4);       // refinement fraction
+    double eta_alpha(0);     // refinement threshold
+    double beta(0.0);        // coarsening fraction
+    double eta_beta(0);      // coarsening threshold
+    parallel_element_fraction( gv, eta, alpha, beta, eta_alpha, eta_beta );
+    parallel_mark_grid( grid, eta, eta_alpha, 0.0, 0, 100 );
+    Dune::PDELab::adapt_grid( grid, gfs, u, 2 );
+    const double t_step = gv.comm().max(timer.elapsed());
+
+    // <<<10>>> Rebalance: the weight of an element is its number of
+    // degrees of freedom, the solution migrates along with the elements
+    timer.reset();
+    std::vector<double> weights = dof_weights(gfs);
+    const double imbalance_before = imbalance(gv,weights);
+    const std::vector<int> target = recursive_bisection(gv,weights);
+    rebalance(grid,gfs,u,target);
+    weights = dof_weights(gfs);
+    const double imbalance_after = imbalance(gv,weights);
+    const double t_balance = gv.comm().max(timer.elapsed());
+
+    // Reassemble constraints and set the Dirichlet values on the new
+    // constrained dofs; all other dofs keep the transferred solution.
+    Dune::PDELab::constraints(bctype,gfs,cc,false);
+    U ug(gfs,0.0);
+    Dune::PDELab::interpolate(g,gfs,ug);
+    Dune::PDELab::copy_constrained_dofs(cc,ug,u);
+
+    typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+      InteriorIterator;
+    int elements = 0;
+    for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      elements++;
+    elements = gv.comm().sum(elements);
+    if (rank==0)
+      std::cout << "Iteration: " << iter
+                << " elements=" << elements
+                << " imbalance before=" << imbalance_before
+                << " after=" << imbalance_after
+                << " time step=" << t_step << " s"
+                << " rebalance=" << t_balance << " s" << std::endl;
+  }
+}
@@ -10,9 +10,11 @@
 #include "config.h"
 #endif
 #include<math.h>
+#include<iomanip>
 #include<iostream>
 #include<vector>
 #include<map>
+#include<memory>
 #include<string>
 
 #include<dune/common/parallel/mpihelper.hh>
@@ -52,6 +54,9 @@
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/gridoperator/gridoperator.hh>
 
+#include"../utility/explicitdg.hh"
+#include"../utility/asyncoutput.hh"
+
 //==============================================================================
 // Parameter class for the linear acoustics problem
 //==============================================================================
@@ -195,9 +200,36 @@ private:
 //===============================================================
 
 
+// VTK output of one snapshot, called on the writer thread
+template<typename GFS, typename V>
+class AcousticsVTKOutput
+{
+  typedef typename GFS::Traits::GridViewType GV;
+
+public:
+  AcousticsVTKOutput (const GFS& gfs_, int refinement_, std::string basename)
+    : gfs(gfs_), refinement(refinement_), collection(gfs_.gridView(),basename,"vtk")
+  {}
+
+  void write (const V& x, double time, const std::string& name)
+  {
+    typedef Dune::PDELab::VectorDiscreteGridFunction<GFS,V> DGF;
+    DGF xdgf(gfs,x);
+    VTKPieceWriter<GV,Dune::SubsamplingVTKWriter<GV> > vtkwriter(gfs.gridView(),refinement);
+    vtkwriter.addVertexData(new Dune::PDELab::VTKGridFunctionAdapter<DGF>(xdgf,"u"));
+    collection.write(vtkwriter,time,name,Dune::VTK::appendedraw);
+  }
+
+private:
+  const GFS& gfs;
+  int refinement;
+  VTKCollection collection;
+};
+
 // example using explicit time-stepping
 template<class GV, class FEMDG, int degree>
-void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double timestep, std::string name, int modulo)
+void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double timestep, std::string name, int modulo,
+                      std::string engine)
 {
   std::cout << "using degree " << degree << std::endl;
   // <<<1>>> Choose domain and range field type
@@ -218,6 +250,8 @@ void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double time
   C cg;
   gfs.update(); // initializing the gfs
   std::cout << "degrees of freedom: " << gfs.globalSize() << std::endl;
+  // globalSize() counts the dofs of this rank only
+  const std::size_t dofs = gv.comm().sum(gfs.globalSize());
 
   // <<<2b>>> define problem parameters
   typedef RiemannProblem<GV,Real> Param;
@@ -271,46 +305,141 @@ void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double time
   Dune::PDELab::ExplicitOneStepMethod<Real,IGO,LS,V,V,TC> osm(*method,igo,ls,tc);
   osm.setVerbosityLevel(2);
 
-  // <<<10>>> graphics for initial guess
+  // low storage methods need two state vectors for any number of stages
+  Williamson3Parameter<Real> lsmethod3;
+  CarpenterKennedy4Parameter<Real> lsmethod4;
+  BerlandRK46Parameter<Real> lsmethod46;
+  const LowStorageRKParameter<Real>* lsmethod = 0;
+  if (engine=="w3") lsmethod = &lsmethod3;
+  if (engine=="ck4") lsmethod = &lsmethod4;
+  if (engine=="rk46") lsmethod = &lsmethod46;
+  const bool lowstorage = (lsmethod!=0);
+  const int s = lowstorage ? lsmethod->s() : method->s();
+
+  // only the selected engine is built, so its vectors and inverse mass
+  // blocks are the only ones allocated
+  typedef ExplicitDGRungeKutta<Real,GO0,LOP,TC,V> DGRK;
+  typedef LowStorageDGRungeKutta<Real,GO0,LOP,TC,V> LSRK;
+  std::shared_ptr<DGRK> dgrk;
+  std::shared_ptr<LSRK> lsrk;
+  if (engine=="dg")
+    {
+      // the same method without mass matrix assembly and linear solver
+      dgrk = std::make_shared<DGRK>(*method,go0,lop,go1,tc);
+      dgrk->setVerbosityLevel(2);
+      std::cout << "explicit DG engine, inverse mass "
+                << (dgrk->scalarMass() ? "scaled identity" : "element blocks") << std::endl;
+    }
+  if (lowstorage)
+    {
+      lsrk = std::make_shared<LSRK>(*lsmethod,go0,lop,go1,tc);
+      lsrk->setVerbosityLevel(2);
+    }
+
+  // estimated memory of the time stepping scheme in state sized vectors
+  // on all ranks, xold and x included, counted from the vectors each
+  // engine allocates; ExplicitOneStepMethod keeps the s+1 stage vectors
+  // from xold to x, two residuals and the mass matrix
+  const int vectors = lowstorage ? lsrk->storage()+2
+    : (engine=="dg" ? dgrk->storage()+2 : method->s()+3);
+  std::cout << "estimated time stepping storage: " << vectors << " vectors, "
+            << vectors*dofs*sizeof(Real)/1048576.0 << " MB"
+            << (engine=="pdelab" ? " plus solver vectors and mass matrix" : "") << std::endl;
+
+  // time convergence study: errors at Tend for dt, dt/2, dt/4, dt/8
+  // against a solution with dt/64, without graphics
+  if (modulo<=0)
+    {
+      typedef Dune::PDELab::SimpleTimeController<Real> STC;
+      STC stc;
+      typedef LowStorageDGRungeKutta<Real,GO0,LOP,STC,V> SLSRK;
+      typedef ExplicitDGRungeKutta<Real,GO0,LOP,STC,V> SDGRK;
+      std::shared_ptr<SLSRK> slsrk;
+      std::shared_ptr<SDGRK> sdgrk;
+      if (lowstorage)
+        {
+          slsrk = std::make_shared<SLSRK>(*lsmethod,go0,lop,go1,stc);
+          slsrk->setVerbosityLevel(0);
+        }
+      else
+        {
+          sdgrk = std::make_shared<SDGRK>(*method,go0,lop,go1,stc);
+          sdgrk->setVerbosityLevel(0);
+        }
+      V reference(gfs,0.0), x(gfs,0.0);
+      if (lowstorage) dg_integrate(*slsrk,0.0,Tend,timestep/64.0,xold,reference);
+      else dg_integrate(*sdgrk,0.0,Tend,timestep/64.0,xold,reference);
+      double olderror = 0.0;
+      for (int k=0; k<4; k++)
+        {
+          const double h = timestep/(1<<k);
+          if (lowstorage) dg_integrate(*slsrk,0.0,Tend,h,xold,x);
+          else dg_integrate(*sdgrk,0.0,Tend,h,xold,x);
+          x -= reference;
+          const double error = gv.comm().max(x.infinity_norm());
+          std::cout << "dt=" << std::scientific << std::setprecision(3) << h
+                    << " error=" << error;
+          if (k>0)
+            std::cout << " order=" << std::fixed << std::setprecision(2)
+                      << std::log(olderror/error)/std::log(2.0);
+          std::cout << std::endl;
+          olderror = error;
+        }
+      return;
+    }
+
+  // <<<10>>> graphics for initial guess; the files are written by a
+  // background thread while the time loop continues
   Dune::PDELab::FilenameHelper fn(name);
   int counter=0;
-  {
-    typedef Dune::PDELab::VectorDiscreteGridFunction<GFS,V> DGF;
-    DGF xdgf(gfs,xold);
-    int refinement = std::max(degree-1,0);
-    if (degree>=2) refinement+=2;
-    Dune::SubsamplingVTKWriter<GV> vtkwriter(gv,refinement);
-    vtkwriter.addVertexData(new Dune::PDELab::VTKGridFunctionAdapter<DGF>(xdgf,"u"));
-    vtkwriter.pwrite(fn.getName(),"vtk","",Dune::VTK::appendedraw);
-    fn.increment();
-  }
+  int refinement = std::max(degree-1,0);
+  if (degree>=2) refinement+=2;
+  typedef AcousticsVTKOutput<GFS,V> OUT;
+  OUT vtkoutput(gfs,refinement,name);
+  AsyncOutput<V,OUT> output(vtkoutput,xold);
+  output.write(xold,0.0,fn.getName());
+  fn.increment();
 
   // <<<11>>> time loop
   Real time = 0.0;
   Real dt = timestep;
   V x(gfs,0.0);
+  int stages = 0;
+  double step_time = 0.0;
   while (time < Tend)
     {
       // do time step
-      osm.apply(time,dt,xold,x);
+      Dune::Timer watch;
+      if (lowstorage)
+        dt = lsrk->apply(time,dt,xold,x);
+      else if (engine=="dg")
+        dt = dgrk->apply(time,dt,xold,x);
+      else
+        dt = osm.apply(time,dt,xold,x);
+      step_time += watch.elapsed();
+      stages += s;
 
       // graphics
       counter++;
       if (counter%modulo==0)
         {
-          typedef Dune::PDELab::VectorDiscreteGridFunction<GFS,V> DGF;
-          DGF xdgf(gfs,x);
-          int refinement = std::max(degree-1,0);
-          if (degree>=2) refinement+=2;
-          Dune::SubsamplingVTKWriter<GV> vtkwriter(gv,refinement);
-          vtkwriter.addVertexData(new Dune::PDELab::VTKGridFunctionAdapter<DGF>(xdgf,"u"));
-          vtkwriter.pwrite(fn.getName(),"vtk","",Dune::VTK::appendedraw);
+          output.write(x,time+dt,fn.getName());
           fn.increment();
         }
 
       xold = x;
       time += dt;
     }
+
+  // stage throughput
+  std::cout << engine << " engine: "
+            << stages << " stages in " << step_time << " s, "
+            << stages/step_time << " stages/s, "
+            << dofs*(stages/step_time) << " dof updates/s" << std::endl;
+  output.finish();
+  std::cout << "output: " << output.snapshotCount() << " snapshots written in "
+            << output.writeTime() << " s in the background, time loop waited "
+            << output.waitTime() << " s" << std::endl;
 }
 
 //===============================================================
@@ -330,14 +459,17 @@ int main(int argc, char** argv)
 		  std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
 	  }
 
-    if (argc!=7)
+    if (argc!=7 && argc!=8)
       {
         if(helper.rank()==0)
           {
-            std::cout << "usage: " << argv[0] << " <end time> <time step> <grid file> <refinement> <degree> <modulo>" << std::endl;
+            std::cout << "usage: " << argv[0] << " <end time> <time step> <grid file> <refinement> <degree> <modulo> [<engine>]" << std::endl;
             std::cout << "         <grid file> = 'yaspgrid' || <a gmsh file>"  << std::endl;
             std::cout << "         <refinement> = nonnegative integer, initial mesh has h=1/20" << std::endl;
             std::cout << "         <modulo> = write vtk file every modulo'th time step" << std::endl;
+            std::cout << "         <modulo> = 0: time convergence study instead of output" << std::endl;
+            std::cout << "         <engine> = dg (default) || pdelab = ExplicitOneStepMethod ||" << std::endl;
+            std::cout << "                    w3 || ck4 || rk46 = low storage Runge-Kutta" << std::endl;
             std::cout << "coarse example:" << std::endl;
             std::cout << "./heterogeneoussquare 0.1 0.001 'yaspgrid' 1 1 5" << std::endl;
           }
@@ -352,6 +484,11 @@ int main(int argc, char** argv)
     int max_level; sscanf(argv[4],"%d",&max_level);
     int p; sscanf(argv[5],"%d",&p);
     int modulo; sscanf(argv[6],"%d",&modulo);
+    std::string engine("dg");
+    if (argc==8)
+      engine = argv[7];
+    if (engine!="dg" && engine!="pdelab" && engine!="w3" && engine!="ck4" && engine!="rk46")
+      DUNE_THROW(Dune::Exception,"unknown time stepping engine " << engine);
 
     // parallel overlapping yaspgrid version
     if (grid_file=="yaspgrid")
@@ -372,7 +509,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==1)
           {
@@ -381,7 +518,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==2)
           {
@@ -390,7 +527,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==3)
           {
@@ -399,7 +536,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         return 0;
       }
@@ -427,7 +564,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==1)
           {
@@ -436,7 +573,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==2)
           {
@@ -445,7 +582,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
         if (p==3)
           {
@@ -454,7 +591,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo,engine);
           }
       }
 #endif
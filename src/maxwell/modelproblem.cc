@@ -6,6 +6,8 @@
 #include "config.h"
 #endif
 
+#include<algorithm>
+#include<iomanip>
 #include<iostream>
 #include<map>
 #include<memory>
@@ -19,6 +21,8 @@
 #include<dune/common/parallel/mpihelper.hh>
 #include<dune/common/timer.hh>
 
+#include<dune/geometry/referenceelements.hh>
+
 #include<dune/grid/io/file/gmshreader.hh>
 #include<dune/grid/io/file/vtk/subsamplingvtkwriter.hh>
 #if HAVE_UG
@@ -49,6 +53,10 @@
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
 #include<dune/pdelab/localoperator/maxwelldg.hh>
 
+#include"../utility/explicitdg.hh"
+#include"../utility/localtimestepping.hh"
+#include"../utility/asyncoutput.hh"
+
 //==============================================================================
 // Parameter class for Maxwell Problem
 //==============================================================================
@@ -141,75 +149,144 @@ private:
   RF time;
 };
 
+//==============================================================================
+// Time step from the CFL condition
+//==============================================================================
+
+/** \brief largest stable time step of the explicit DG Maxwell scheme
+ *
+ * dt = cfl * min_E |E| / (c_E |dE| (2k+1)) with the speed of light
+ * c_E = 1/sqrt(eps mu) at the element center and the polynomial degree
+ * k. For k=0 and cfl=1 this is the CFL condition of the upwind finite
+ * volume scheme. The bound holds for the Runge-Kutta method of order
+ * k+1; other integrators pass their stability interval relative to it as
+ * stability factor, which scales dt. The mesh and the coefficients do
+ * not change, so the step is computed once.
+ */
+template<typename R, typename GV, typename Param>
+class MaxwellCFLTimeController : public Dune::PDELab::TimeControllerInterface<R>
+{
+public:
+  MaxwellCFLTimeController (const GV& gv, const Param& param, int degree, R cfl,
+                            R stability=1.0)
+    : dtmax(1e100)
+  {
+    typedef typename GV::template Codim<0>::Iterator Iterator;
+    typedef typename GV::ctype DF;
+    const int dim = GV::dimension;
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      {
+        const Dune::FieldVector<DF,dim> center =
+          Dune::ReferenceElements<DF,dim>::general(it->type()).position(0,0);
+        const R c = 1.0/std::sqrt(param.eps(*it,center)*param.mu(*it,center));
+        const R h = dg_element_size(gv,*it)/dim;   // |E|/|dE|
+        dtmax = std::min(dtmax,stability*cfl*h/(c*(2*degree+1)));
+      }
+    dtmax = gv.comm().min(dtmax);
+  }
+
+  virtual R suggestTimestep (R time, R givendt)
+  {
+    return dtmax;
+  }
+
+  R maxTimestep () const
+  {
+    return dtmax;
+  }
+
+private:
+  R dtmax;
+};
+
 //===============================================================
 // driver
 //===============================================================
 
-template<class FN, class GFS, class V>
-void do_output(FN& fn, const GFS& gfs, const V& x, int degree)
+// VTK output of one snapshot, called on the writer thread
+template<class GFS, class V>
+class MaxwellVTKOutput
 {
-  using std::make_shared;
-  using std::max;
-  using Dune::TypeTree::TreePath;
-  using Dune::PDELab::DiscreteGridFunction;
-  using Dune::PDELab::GridFunctionSubSpace;
-  using Dune::PDELab::VTKGridFunctionAdapter;
-
-  using U0SUB = GridFunctionSubSpace<GFS, TreePath<0> >;
-  using U1SUB = GridFunctionSubSpace<GFS, TreePath<1> >;
-  using U2SUB = GridFunctionSubSpace<GFS, TreePath<2> >;
-  using U3SUB = GridFunctionSubSpace<GFS, TreePath<3> >;
-  using U4SUB = GridFunctionSubSpace<GFS, TreePath<4> >;
-  using U5SUB = GridFunctionSubSpace<GFS, TreePath<5> >;
-
-  U0SUB u0sub(gfs);
-  U1SUB u1sub(gfs);
-  U2SUB u2sub(gfs);
-  U3SUB u3sub(gfs);
-  U4SUB u4sub(gfs);
-  U5SUB u5sub(gfs);
-
-  using U0DGF = DiscreteGridFunction<U0SUB, V>;
-  using U1DGF = DiscreteGridFunction<U1SUB, V>;
-  using U2DGF = DiscreteGridFunction<U2SUB, V>;
-  using U3DGF = DiscreteGridFunction<U3SUB, V>;
-  using U4DGF = DiscreteGridFunction<U4SUB, V>;
-  using U5DGF = DiscreteGridFunction<U5SUB, V>;
-
-  U0DGF u0dgf(u0sub,x);
-  U1DGF u1dgf(u1sub,x);
-  U2DGF u2dgf(u2sub,x);
-  U3DGF u3dgf(u3sub,x);
-  U4DGF u4dgf(u4sub,x);
-  U5DGF u5dgf(u5sub,x);
-
-  int refinement = max(degree-1,0);
-  if (degree>=2) refinement+=1;
-
   using GV = typename GFS::Traits::GridViewType;
-  const GV& gv = gfs.gridView();
-  Dune::SubsamplingVTKWriter<GV> vtkwriter(gv,refinement);
-
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U0DGF> >(u0dgf,"D_x"));
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U1DGF> >(u1dgf,"D_y"));
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U2DGF> >(u2dgf,"D_z"));
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U3DGF> >(u3dgf,"B_x"));
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U4DGF> >(u4dgf,"B_y"));
-  vtkwriter.addVertexData
-    (make_shared<VTKGridFunctionAdapter<U5DGF> >(u5dgf,"B_z"));
-
-  vtkwriter.pwrite(fn.getName(), "vtk", "", Dune::VTK::appendedraw);
-  fn.increment();
+  using U0SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<0> >;
+  using U1SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<1> >;
+  using U2SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<2> >;
+  using U3SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<3> >;
+  using U4SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<4> >;
+  using U5SUB = Dune::PDELab::GridFunctionSubSpace<GFS, Dune::TypeTree::TreePath<5> >;
+
+public:
+  MaxwellVTKOutput (const GFS& gfs_, int degree, std::string basename)
+    : gfs(gfs_), u0sub(gfs_), u1sub(gfs_), u2sub(gfs_), u3sub(gfs_), u4sub(gfs_), u5sub(gfs_),
+      refinement(std::max(degree-1,0)+(degree>=2 ? 1 : 0)),
+      collection(gfs_.gridView(),basename,"vtk")
+  {}
+
+  void write (const V& x, double time, const std::string& name)
+  {
+    using std::make_shared;
+    using Dune::PDELab::DiscreteGridFunction;
+    using Dune::PDELab::VTKGridFunctionAdapter;
+
+    using U0DGF = DiscreteGridFunction<U0SUB, V>;
+    using U1DGF = DiscreteGridFunction<U1SUB, V>;
+    using U2DGF = DiscreteGridFunction<U2SUB, V>;
+    using U3DGF = DiscreteGridFunction<U3SUB, V>;
+    using U4DGF = DiscreteGridFunction<U4SUB, V>;
+    using U5DGF = DiscreteGridFunction<U5SUB, V>;
+
+    U0DGF u0dgf(u0sub,x);
+    U1DGF u1dgf(u1sub,x);
+    U2DGF u2dgf(u2sub,x);
+    U3DGF u3dgf(u3sub,x);
+    U4DGF u4dgf(u4sub,x);
+    U5DGF u5dgf(u5sub,x);
+
+    VTKPieceWriter<GV,Dune::SubsamplingVTKWriter<GV> > vtkwriter(gfs.gridView(),refinement);
+
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U0DGF> >(u0dgf,"D_x"));
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U1DGF> >(u1dgf,"D_y"));
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U2DGF> >(u2dgf,"D_z"));
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U3DGF> >(u3dgf,"B_x"));
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U4DGF> >(u4dgf,"B_y"));
+    vtkwriter.addVertexData
+      (make_shared<VTKGridFunctionAdapter<U5DGF> >(u5dgf,"B_z"));
+
+    collection.write(vtkwriter,time,name,Dune::VTK::appendedraw);
+  }
+
+private:
+  const GFS& gfs;
+  U0SUB u0sub;
+  U1SUB u1sub;
+  U2SUB u2sub;
+  U3SUB u3sub;
+  U4SUB u4sub;
+  U5SUB u5sub;
+  int refinement;
+  VTKCollection collection;
+};
+
+//! output statistics of the background writer
+template<class OUTPUT>
+void print_output_statistics (OUTPUT& output)
+{
+  output.finish();
+  std::cout << "output: " << output.snapshotCount() << " snapshots written in "
+            << output.writeTime() << " s in the background, time loop waited "
+            << output.waitTime() << " s" << std::endl;
 }
 
 // example using explicit time-stepping
 template<class GV, class FEMDG, int degree>
-void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double timestep, std::string name, int modulo)
+void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double timestep, double cfl,
+                      std::string name, int modulo,
+                      std::string engine)
 {
   std::cout << "using degree " << degree << std::endl;
   // <<<1>>> Choose domain and range field type
@@ -230,6 +307,8 @@ void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double time
   typedef typename GFS::template ConstraintsContainer<Real>::Type C;
   C cg;
   std::cout << "degrees of freedom: " << gfs.globalSize() << std::endl;
+  // globalSize() counts the dofs of this rank only
+  const std::size_t dofs = gv.comm().sum(gfs.globalSize());
 
   // <<<2b>>> define problem parameters
   typedef MaxwellModelProblem<GV,Real> Param;
@@ -277,34 +356,212 @@ void explicit_scheme (const GV& gv, const FEMDG& femdg, double Tend, double time
   typedef Dune::PDELab::ISTLBackend_OVLP_ExplicitDiagonal<GFS> LS;
   LS ls(gfs);
 
-  // <<<6>>> time-stepper
-  typedef Dune::PDELab::SimpleTimeController<Real> TC;
-  TC tc;
+  // <<<6>>> time-stepper; with cfl>0 every step is the largest stable one
+  typedef Dune::PDELab::TimeControllerInterface<Real> TC;
+  Dune::PDELab::SimpleTimeController<Real> simpletc;
+  // the Adams-Bashforth engines are stable on a shorter interval than
+  // the Runge-Kutta method the CFL bound is set for
+  Real stability = 1.0;
+  if (engine=="lts" || engine=="ab3")
+    stability = ab3_stability_interval()/rk_stability_interval(degree+1);
+  MaxwellCFLTimeController<Real,GV,Param> cfltc(gv,param,degree,cfl,stability);
+  TC& tc = (cfl>0.0) ? static_cast<TC&>(cfltc) : static_cast<TC&>(simpletc);
+  if (cfl>0.0)
+    {
+      timestep = cfltc.maxTimestep();
+      std::cout << "time step from CFL condition: " << timestep
+                << ", stability factor " << stability << std::endl;
+    }
   Dune::PDELab::ExplicitOneStepMethod<Real,IGO,LS,V,V,TC> osm(*method,igo,ls,tc);
   osm.setVerbosityLevel(2);
 
-  // <<<7>>> graphics for initial guess
+  // low storage methods need two state vectors for any number of stages
+  Williamson3Parameter<Real> lsmethod3;
+  CarpenterKennedy4Parameter<Real> lsmethod4;
+  BerlandRK46Parameter<Real> lsmethod46;
+  const LowStorageRKParameter<Real>* lsmethod = 0;
+  if (engine=="w3") lsmethod = &lsmethod3;
+  if (engine=="ck4") lsmethod = &lsmethod4;
+  if (engine=="rk46") lsmethod = &lsmethod46;
+  const bool lowstorage = (lsmethod!=0);
+  const int s = lowstorage ? lsmethod->s() : method->s();
+
+  // only the selected engine is built, so its vectors and inverse mass
+  // blocks are the only ones allocated
+  typedef ExplicitDGRungeKutta<Real,GO0,LOP,TC,V> DGRK;
+  typedef LowStorageDGRungeKutta<Real,GO0,LOP,TC,V> LSRK;
+  std::shared_ptr<DGRK> dgrk;
+  std::shared_ptr<LSRK> lsrk;
+  if (engine=="dg")
+    {
+      // the same method without mass matrix assembly and linear solver
+      dgrk = std::make_shared<DGRK>(*method,go0,lop,go1,tc);
+      dgrk->setVerbosityLevel(2);
+      std::cout << "explicit DG engine, inverse mass "
+                << (dgrk->scalarMass() ? "scaled identity" : "element blocks") << std::endl;
+    }
+  if (lowstorage)
+    {
+      lsrk = std::make_shared<LSRK>(*lsmethod,go0,lop,go1,tc);
+      lsrk->setVerbosityLevel(2);
+    }
+
+  // local time stepping with the multirate Adams-Bashforth method: the
+  // given time step is used for the smallest elements, larger elements
+  // take up to 16 times larger steps; ab3 is the same method with a
+  // single level, i.e. with the global time step
+  if (engine=="lts" || engine=="ab3")
+    {
+      const std::vector<int> level = lts_levels(gv,engine=="lts" ? 4 : 0);
+      int maxlevel = 0;
+      for (std::size_t i=0; i<level.size(); i++)
+        maxlevel = std::max(maxlevel,level[i]);
+      maxlevel = gv.comm().max(maxlevel);
+      typedef LevelMaskedLocalOperator<GV,LOP> MLOP;
+      MLOP mlop(gv,lop,level);
+      typedef Dune::PDELab::GridOperator
+        <GFS,GFS,MLOP,MBE,Real,Real,Real,C,C> MGO0;
+      MGO0 mgo0(gfs,cg,gfs,cg,mlop,mbe);
+      typedef MultirateAdamsBashforth<Real,MGO0,MLOP,V> MRAB;
+      MRAB mrab(mgo0,mlop,go1,level,maxlevel);
+      mrab.setVerbosityLevel(2);
+      for (int k=0; k<=maxlevel; k++)
+        std::cout << "level " << k << ": " << mrab.levelCells()[k]
+                  << " elements, dt=" << timestep*(1<<k) << std::endl;
+      const int vectors = mrab.storage()+2;
+      std::cout << "estimated time stepping storage: " << vectors << " vectors, "
+                << vectors*dofs*sizeof(Real)/1048576.0 << " MB" << std::endl;
+
+      Dune::PDELab::FilenameHelper fn(name);
+      typedef MaxwellVTKOutput<GFS,V> OUT;
+      OUT vtkoutput(gfs,degree,name);
+      AsyncOutput<V,OUT> output(vtkoutput,xold);
+      output.write(xold,0.0,fn.getName());
+      fn.increment();
+      long macrosteps = 0;
+      Real time = 0.0;
+      const Real dt = timestep*(1<<maxlevel);
+      V x(gfs,0.0);
+      Dune::Timer watch;
+      while (time < Tend)
+        {
+          mrab.apply(time,dt,xold,x);
+          macrosteps++;
+          if (modulo>0 && macrosteps%modulo==0)
+            {
+              output.write(x,time+dt,fn.getName());
+              fn.increment();
+            }
+          xold = x;
+          time += dt;
+        }
+      std::cout << engine << " engine: " << macrosteps << " macro steps in "
+                << watch.elapsed() << " s, " << mrab.elementEvaluations()
+                << " element evaluations, " << mrab.globalEvaluations(macrosteps)
+                << " with the global time step" << std::endl;
+      print_output_statistics(output);
+      return;
+    }
+
+  // estimated memory of the time stepping scheme in state sized vectors
+  // on all ranks, xold and x included, counted from the vectors each
+  // engine allocates; ExplicitOneStepMethod keeps the s+1 stage vectors
+  // from xold to x, two residuals and the mass matrix
+  const int vectors = lowstorage ? lsrk->storage()+2
+    : (engine=="dg" ? dgrk->storage()+2 : method->s()+3);
+  std::cout << "estimated time stepping storage: " << vectors << " vectors, "
+            << vectors*dofs*sizeof(Real)/1048576.0 << " MB"
+            << (engine=="pdelab" ? " plus solver vectors and mass matrix" : "") << std::endl;
+
+  // time convergence study: errors at Tend for dt, dt/2, dt/4, dt/8
+  // against a solution with dt/64, without graphics
+  if (modulo<=0)
+    {
+      typedef Dune::PDELab::SimpleTimeController<Real> STC;
+      STC stc;
+      typedef LowStorageDGRungeKutta<Real,GO0,LOP,STC,V> SLSRK;
+      typedef ExplicitDGRungeKutta<Real,GO0,LOP,STC,V> SDGRK;
+      std::shared_ptr<SLSRK> slsrk;
+      std::shared_ptr<SDGRK> sdgrk;
+      if (lowstorage)
+        {
+          slsrk = std::make_shared<SLSRK>(*lsmethod,go0,lop,go1,stc);
+          slsrk->setVerbosityLevel(0);
+        }
+      else
+        {
+          sdgrk = std::make_shared<SDGRK>(*method,go0,lop,go1,stc);
+          sdgrk->setVerbosityLevel(0);
+        }
+      V reference(gfs,0.0), x(gfs,0.0);
+      if (lowstorage) dg_integrate(*slsrk,0.0,Tend,timestep/64.0,xold,reference);
+      else dg_integrate(*sdgrk,0.0,Tend,timestep/64.0,xold,reference);
+      double olderror = 0.0;
+      for (int k=0; k<4; k++)
+        {
+          const double h = timestep/(1<<k);
+          if (lowstorage) dg_integrate(*slsrk,0.0,Tend,h,xold,x);
+          else dg_integrate(*sdgrk,0.0,Tend,h,xold,x);
+          x -= reference;
+          const double error = gv.comm().max(x.infinity_norm());
+          std::cout << "dt=" << std::scientific << std::setprecision(3) << h
+                    << " error=" << error;
+          if (k>0)
+            std::cout << " order=" << std::fixed << std::setprecision(2)
+                      << std::log(olderror/error)/std::log(2.0);
+          std::cout << std::endl;
+          olderror = error;
+        }
+      return;
+    }
+
+  // <<<7>>> graphics for initial guess; the files are written by a
+  // background thread while the time loop continues
   Dune::PDELab::FilenameHelper fn(name);
-  do_output(fn, gfs, xold, degree);
+  typedef MaxwellVTKOutput<GFS,V> OUT;
+  OUT vtkoutput(gfs,degree,name);
+  AsyncOutput<V,OUT> output(vtkoutput,xold);
+  output.write(xold,0.0,fn.getName());
+  fn.increment();
 
   // <<<8>>> time loop
   int counter=0;
   Real time = 0.0;
   Real dt = timestep;
   V x(gfs,0.0);
+  int stages = 0;
+  double step_time = 0.0;
   while (time < Tend)
     {
       // do time step
-      osm.apply(time,dt,xold,x);
+      Dune::Timer watch;
+      if (lowstorage)
+        dt = lsrk->apply(time,dt,xold,x);
+      else if (engine=="dg")
+        dt = dgrk->apply(time,dt,xold,x);
+      else
+        dt = osm.apply(time,dt,xold,x);
+      step_time += watch.elapsed();
+      stages += s;
 
       // graphics
       counter++;
       if (counter%modulo==0)
-        do_output(fn, gfs, x, degree);
+        {
+          output.write(x,time+dt,fn.getName());
+          fn.increment();
+        }
 
       xold = x;
       time += dt;
     }
+
+  // stage throughput
+  std::cout << engine << " engine: "
+            << stages << " stages in " << step_time << " s, "
+            << stages/step_time << " stages/s, "
+            << dofs*(stages/step_time) << " dof updates/s" << std::endl;
+  print_output_statistics(output);
 }
 
 //===============================================================
@@ -324,26 +581,47 @@ int main(int argc, char** argv)
 		  std::cout << "parallel run on " << helper.size() << " process(es)" << std::endl;
 	  }
 
-    if (argc!=7)
+    if (argc<7 || argc>9)
       {
         if(helper.rank()==0)
           {
-            std::cout << "usage: " << argv[0] << " <end time> <time step> <grid file> <refinement> <degree> <modulo>" << std::endl;
+            std::cout << "usage: " << argv[0] << " <end time> <time step> <grid file> <refinement> <degree> <modulo> [<engine> [<local refinements>]]" << std::endl;
+            std::cout << "         <time step> = fixed time step || 'cfl' || 'cfl:<safety factor>'" << std::endl;
             std::cout << "         <grid file> = 'yaspgrid' || <a gmsh file>"  << std::endl;
             std::cout << "         <refinement> = #cell per dir in yaspgrid, #refinements in UG" << std::endl;
             std::cout << "         <modulo> = write vtk file every modulo'th time step" << std::endl;
+            std::cout << "         <modulo> = 0: time convergence study instead of output" << std::endl;
+            std::cout << "         <engine> = dg (default) || pdelab = ExplicitOneStepMethod ||" << std::endl;
+            std::cout << "                    w3 || ck4 || rk46 = low storage Runge-Kutta ||" << std::endl;
+            std::cout << "                    lts = local time stepping || ab3 = same with global step" << std::endl;
+            std::cout << "         <local refinements> = additional refinements around the initial pulse in UG" << std::endl;
           }
         return 1;
       }
 
     double Tend;
     sscanf(argv[1],"%lg",&Tend);
-    double timestep;
-    sscanf(argv[2],"%lg",&timestep);
+    double timestep = 0.0, cfl = 0.0;
+    if (std::string(argv[2]).compare(0,3,"cfl")==0)
+      {
+        cfl = 0.9;
+        sscanf(argv[2],"cfl:%lg",&cfl);
+      }
+    else
+      sscanf(argv[2],"%lg",&timestep);
     std::string grid_file(argv[3]);
     int max_level; sscanf(argv[4],"%d",&max_level);
     int p; sscanf(argv[5],"%d",&p);
     int modulo; sscanf(argv[6],"%d",&modulo);
+    std::string engine("dg");
+    if (argc>=8)
+      engine = argv[7];
+    if (engine!="dg" && engine!="pdelab" && engine!="w3" && engine!="ck4" && engine!="rk46"
+        && engine!="lts" && engine!="ab3")
+      DUNE_THROW(Dune::Exception,"unknown time stepping engine " << engine);
+    int local_refinements = 0;
+    if (argc==9)
+      sscanf(argv[8],"%d",&local_refinements);
 
     // parallel overlapping yaspgrid version
     if (grid_file=="yaspgrid")
@@ -364,7 +642,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_n" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         if (p==1)
           {
@@ -373,7 +651,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_n" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         if (p==2)
           {
@@ -382,7 +660,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_n" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         // if (p==3)
         //   {
@@ -391,7 +669,7 @@ int main(int argc, char** argv)
         //     FEM fem;
         //     std::stringstream fullname;
         //     fullname << grid_file << "_l" << max_level << "_k" << p;
-        //     explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+        //     explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
         //   }
         return 0;
       }
@@ -412,6 +690,25 @@ int main(int argc, char** argv)
         for (int i=0; i<max_level; i++) gridp->globalRefine(1);
         typedef GridType::LeafGridView GV;
         const GV& gv=gridp->leafGridView();
+
+        // graded mesh: refine the elements in the box [0.4,0.6]^3 that
+        // holds the initial pulse
+        for (int i=0; i<local_refinements; i++)
+          {
+            typedef GV::Codim<0>::Iterator Iterator;
+            for (Iterator it=gv.begin<0>(); it!=gv.end<0>(); ++it)
+              {
+                const Dune::FieldVector<double,dim> c = it->geometry().center();
+                bool inside = true;
+                for (int d=0; d<dim; d++)
+                  if (c[d]<0.4 || c[d]>0.6) inside = false;
+                if (inside)
+                  gridp->mark(1,*it);
+              }
+            gridp->preAdapt();
+            gridp->adapt();
+            gridp->postAdapt();
+          }
         if (p==0)
           {
             const int degree=0;
@@ -419,7 +716,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         if (p==1)
           {
@@ -428,7 +725,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         if (p==2)
           {
@@ -437,7 +734,7 @@ int main(int argc, char** argv)
             FEM fem;
             std::stringstream fullname;
             fullname << grid_file << "_l" << max_level << "_k" << p;
-            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+            explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
           }
         // if (p==3)
         //   {
@@ -446,7 +743,7 @@ int main(int argc, char** argv)
         //     FEM fem;
         //     std::stringstream fullname;
         //     fullname << grid_file << "_l" << max_level << "_k" << p;
-        //     explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,fullname.str(),modulo);
+        //     explicit_scheme<GV,FEM,degree>(gv,fem,Tend,timestep,cfl,fullname.str(),modulo,engine);
         //   }
       }
 #endif
@@ -26,7 +26,7 @@
 #include<dune/grid/uggrid.hh>
 #endif
 #include<dune/grid/yaspgrid.hh>
-#include<dune/grid/io/file/vtk/vtksequencewriter.hh>
+#include<dune/grid/io/file/vtk/subsamplingvtkwriter.hh>
 #include<dune/grid/io/file/gmshreader.hh>
 #include<dune/istl/bvector.hh>
 #include<dune/istl/operators.hh>
@@ -58,9 +58,49 @@
 #include<dune/pdelab/gridoperator/onestep.hh>
 #include<dune/pdelab/instationary/onestep.hh>
 #include<dune/pdelab/gridoperator/gridoperator.hh>
+#include<dune/pdelab/common/instationaryfilenamehelper.hh>
 
+#include "../utility/asyncoutput.hh"
 #include "navierstokes_initial.hh"
 
+//===============================================================
+// VTK output of velocity and pressure, called on the writer thread
+//===============================================================
+
+template<typename GFS, typename V>
+class StokesVTKOutput
+{
+  typedef typename GFS::Traits::GridViewType GV;
+  typedef Dune::PDELab::GridFunctionSubSpace
+    <GFS,Dune::TypeTree::TreePath<0> > VelocitySubGFS;
+  typedef Dune::PDELab::GridFunctionSubSpace
+    <GFS,Dune::TypeTree::TreePath<1> > PressureSubGFS;
+
+public:
+  StokesVTKOutput (const GFS& gfs_, std::string filename)
+    : gfs(gfs_), velocitySubGfs(gfs_), pressureSubGfs(gfs_),
+      collection(gfs_.gridView(),filename)
+  {}
+
+  void write (const V& x, double time, const std::string& name)
+  {
+    typedef Dune::PDELab::VectorDiscreteGridFunction<VelocitySubGFS,V> VDGF;
+    VDGF vdgf(velocitySubGfs,x);
+    typedef Dune::PDELab::DiscreteGridFunction<PressureSubGFS,V> PDGF;
+    PDGF pdgf(pressureSubGfs,x);
+    VTKPieceWriter<GV,Dune::SubsamplingVTKWriter<GV> > vtkwriter(gfs.gridView(),2);
+    vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<VDGF> >(vdgf,"v"));
+    vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<PDGF> >(pdgf,"p"));
+    collection.write(vtkwriter,time,name,Dune::VTK::appendedraw);
+  }
+
+private:
+  const GFS& gfs;
+  VelocitySubGFS velocitySubGfs;
+  PressureSubGFS pressureSubGfs;
+  VTKCollection collection;
+};
+
 //===============================================================
 // The driver for all examples
 //===============================================================
@@ -173,20 +213,11 @@ void navierstokes
   std::cout << "=== Finished interpolation:" << timer.elapsed() << std::endl;
   timer.reset();
 
-  typedef typename Dune::PDELab::GridFunctionSubSpace
-    <GFS,Dune::TypeTree::TreePath<0> > VelocitySubGFS;
-  VelocitySubGFS velocitySubGfs(gfs);
   typedef typename Dune::PDELab::GridFunctionSubSpace
     <GFS,Dune::TypeTree::TreePath<1> > PressureSubGFS;
   PressureSubGFS pressureSubGfs(gfs);
-  typedef Dune::PDELab::VectorDiscreteGridFunction<VelocitySubGFS,V> VDGF;
-  VDGF vdgf(velocitySubGfs,xold);
   typedef Dune::PDELab::DiscreteGridFunction<PressureSubGFS,V> PDGF;
   PDGF pdgf(pressureSubGfs,xold);
-  auto stationaryvtkwriter = std::make_shared<Dune::SubsamplingVTKWriter<GV> >(gv,2);
-  Dune::VTKSequenceWriter<GV> vtkwriter(stationaryvtkwriter,filename.c_str(),filename.c_str(),"");
-  vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<VDGF> >(vdgf,"v"));
-  vtkwriter.addVertexData(std::make_shared<Dune::PDELab::VTKGridFunctionAdapter<PDGF> >(pdgf,"p"));
 
   timer.reset();
 
@@ -194,8 +225,14 @@ void navierstokes
   Real final_time = parser.get("temporal.time",double(1.0));
   Real dt = parser.get("temporal.tau",double(0.1));
   Real dt_min = 1e-6;
-  // graphics for initial guess
-  vtkwriter.write(time,Dune::VTK::appendedraw);
+  // graphics for initial guess; the files are written by a background
+  // thread while the time loop continues
+  Dune::PDELab::FilenameHelper fn(filename);
+  typedef StokesVTKOutput<GFS,V> OUT;
+  OUT vtkoutput(gfs,filename);
+  AsyncOutput<V,OUT> output(vtkoutput,xold);
+  output.write(xold,time,fn.getName());
+  fn.increment();
   V x(gfs,0.0);
   Dune::PDELab::set_nonconstrained_dofs(cg,0.0,x);
   while (time < final_time - dt_min*0.5)
@@ -206,10 +243,15 @@ void navierstokes
       xold = x;
       time += dt;
 
-      vtkwriter.write(time,Dune::VTK::appendedraw);
+      output.write(xold,time,fn.getName());
+      fn.increment();
     }
+  output.finish();
 
   std::cout << "=== Total time:" << timer.elapsed() << std::endl;
+  std::cout << "=== Output: " << output.snapshotCount() << " snapshots written in "
+            << output.writeTime() << " s in the background, time loop waited "
+            << output.waitTime() << " s" << std::endl;
 
   // Compute norm of final solution
   typename PDGF::Traits::RangeType l1norm(0);
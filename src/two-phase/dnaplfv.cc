@@ -5,7 +5,12 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include<algorithm>
+#include<array>
+#include<cmath>
 #include<iostream>
+#include<memory>
+#include<string>
 #include<vector>
 #include<map>
 #include<dune/common/parallel/mpihelper.hh>
@@ -13,6 +18,10 @@
 #include<dune/common/fvector.hh>
 #include<dune/common/timer.hh>
 #include<dune/grid/yaspgrid.hh>
+#if HAVE_UG
+#include<dune/grid/uggrid.hh>
+#include<dune/grid/utility/structuredgridfactory.hh>
+#endif
 #include<dune/istl/bvector.hh>
 #include<dune/istl/operators.hh>
 #include<dune/istl/solvers.hh>
@@ -36,6 +45,13 @@
 #include<dune/pdelab/gridoperator/gridoperator.hh>
 #include<dune/pdelab/gridoperator/onestep.hh>
 #include<dune/pdelab/common/instationaryfilenamehelper.hh>
+#include<dune/pdelab/adaptivity/adaptivity.hh>
+#include<dune/pdelab/gridfunctionspace/localfunctionspace.hh>
+#include<dune/pdelab/gridfunctionspace/lfsindexcache.hh>
+
+#include"../utility/activeset.hh"
+#include"../utility/asyncoutput.hh"
+#include"../utility/xdmfwriter.hh"
 
 //==============================================================================
 // Problem definition
@@ -436,8 +452,116 @@ public:
 //==============================================================================
 int rank;
 
+// Flux contributions of cells whose pressures changed by less than
+// activeset_tol (relative) are reused; every full_reassembly time steps
+// everything is recomputed. With "plain" on the command line the wrapper
+// passes everything on to the flux operator, for comparing the assembly
+// times; activeset_verbosity>0 prints the statistics of every step.
+const double activeset_tol = 1e-10;
+const int full_reassembly = 10;
+const int activeset_verbosity = 0;
+bool activeset = true;
+
+// totals of the active set statistics and of the Jacobian assembly time
+struct ActiveSetSummary
+{
+  ActiveSetSummary () : computed(0), reused(0), assembly_time(0.0) {}
+
+  //! add the counts of the last time step
+  template<typename GV, typename LOP>
+  void collect (const GV& gv, LOP& lop)
+  {
+    std::size_t c, r;
+    lop.statistics(c,r);
+    c = gv.comm().sum(c);
+    r = gv.comm().sum(r);
+    computed += c;
+    reused += r;
+    if (activeset_verbosity>0 && gv.comm().rank()==0)
+      std::cout << "=== active set: " << c << " flux contributions computed, "
+                << r << " reused" << std::endl;
+  }
+
+  template<typename GV>
+  void print (const GV& gv) const
+  {
+    const double t = gv.comm().max(assembly_time);
+    if (gv.comm().rank()!=0) return;
+    if (activeset)
+      std::cout << "=== active set: " << computed << " flux contributions computed, "
+                << reused << " reused, Jacobian assembly " << t << " s" << std::endl;
+    else
+      std::cout << "=== plain flux operator: Jacobian assembly " << t << " s" << std::endl;
+  }
+
+  std::size_t computed, reused;
+  double assembly_time;
+};
+
+// output of pressures and saturations, called on the writer thread; with
+// xdmf the mesh is written once and only the cell data in every step
+template<typename GV, typename P_lSUB, typename P_gSUB, typename TP, typename V>
+class DNAPLOutput
+{
+public:
+  //! collective, as the XDMF writer exchanges the sizes of the pieces
+  DNAPLOutput (const GV& gv_, const P_lSUB& p_lsub_, const P_gSUB& p_gsub_, const TP& tp_,
+               std::string basename, bool xdmf)
+    : gv(gv_), p_lsub(p_lsub_), p_gsub(p_gsub_), tp(tp_), collection(gv_,basename)
+  {
+    if (xdmf)
+      xdmfwriter = std::make_shared<XDMFWriter<GV> >(gv,basename);
+  }
+
+  void write (const V& p, double time, const std::string& name)
+  {
+    typedef Dune::PDELab::DiscreteGridFunction<P_lSUB,V> P_lDGF;
+    P_lDGF p_ldgf(p_lsub,p);
+    typedef Dune::PDELab::DiscreteGridFunction<P_gSUB,V> P_gDGF;
+    P_gDGF p_gdgf(p_gsub,p);
+    typedef S_l<TP,P_lDGF,P_gDGF> S_lDGF;
+    S_lDGF s_ldgf(tp,p_ldgf,p_gdgf);
+    typedef S_g<TP,P_lDGF,P_gDGF> S_gDGF;
+    S_gDGF s_gdgf(tp,p_ldgf,p_gdgf);
+    if (xdmfwriter)
+      {
+        addData(*xdmfwriter,p_ldgf,p_gdgf,s_ldgf,s_gdgf);
+        xdmfwriter->write(time);
+        xdmfwriter->clear();
+      }
+    else
+      {
+        VTKPieceWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
+        addData(vtkwriter,p_ldgf,p_gdgf,s_ldgf,s_gdgf);
+        collection.write(vtkwriter,time,name,Dune::VTK::appendedraw);
+      }
+  }
+
+  //! bytes of the mesh and of the data written on this rank, XDMF only
+  long meshBytes () const { return xdmfwriter ? xdmfwriter->meshBytes() : 0; }
+  long dataBytes () const { return xdmfwriter ? xdmfwriter->dataBytes() : 0; }
+
+private:
+  template<typename W, typename P_lDGF, typename P_gDGF, typename S_lDGF, typename S_gDGF>
+  static void addData (W& writer, const P_lDGF& p_ldgf, const P_gDGF& p_gdgf,
+                       const S_lDGF& s_ldgf, const S_gDGF& s_gdgf)
+  {
+    writer.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_lDGF>(p_ldgf,"p_l"));
+    writer.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_gDGF>(p_gdgf,"p_g"));
+    writer.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_lDGF>(s_ldgf,"s_l"));
+    writer.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_gDGF>(s_gdgf,"s_g"));
+  }
+
+  const GV& gv;
+  const P_lSUB& p_lsub;
+  const P_gSUB& p_gsub;
+  const TP& tp;
+  VTKCollection collection;
+  std::shared_ptr<XDMFWriter<GV> > xdmfwriter;
+};
+
 template<class GV>
-void test (const GV& gv, int timesteps, double timestep)
+void test (const GV& gv, int timesteps, double timestep, bool xdmf)
 {
   // <<<1>>> choose some types
   typedef typename GV::Grid::ctype DF;
@@ -480,8 +604,11 @@ void test (const GV& gv, int timesteps, double timestep)
   Dune::PDELab::constraints(tpgfs,cg,false);
 
   // <<<5>>> make grid operator space
-  typedef Dune::PDELab::TwoPhaseTwoPointFluxOperator<TP> LOP;
-  LOP lop(tp);
+  typedef Dune::PDELab::TwoPhaseTwoPointFluxOperator<TP> FluxLOP;
+  FluxLOP fluxlop(tp);
+  typedef ActiveSetLocalOperator<GV,FluxLOP> LOP;
+  LOP lop(gv,fluxlop,activeset_tol);
+  lop.setActive(activeset);
   typedef Dune::PDELab::TwoPhaseOnePointTemporalOperator<TP> MLOP;
   MLOP mlop(tp);
   typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
@@ -513,15 +640,13 @@ void test (const GV& gv, int timesteps, double timestep)
   V pnew(tpgfs);
   pnew = pold;
 
-  // <<<9>>> make discrete function objects for pnew and saturations
-  typedef Dune::PDELab::DiscreteGridFunction<P_lSUB,V> P_lDGF;
-  P_lDGF p_ldgf(p_lsub,pnew);
-  typedef Dune::PDELab::DiscreteGridFunction<P_gSUB,V> P_gDGF;
-  P_gDGF p_gdgf(p_gsub,pnew);
-  typedef S_l<TP,P_lDGF,P_gDGF> S_lDGF;
-  S_lDGF s_ldgf(tp,p_ldgf,p_gdgf);
-  typedef S_g<TP,P_lDGF,P_gDGF> S_gDGF;
-  S_gDGF s_gdgf(tp,p_ldgf,p_gdgf);
+  // <<<9>>> output of pressures and saturations; the files are written by
+  // a background thread while the time loop continues
+  char basename[255];
+  sprintf(basename,"dnapl-alex2-%01dd",dim);
+  typedef DNAPLOutput<GV,P_lSUB,P_gSUB,TP,V> OUT;
+  OUT dnaploutput(gv,p_lsub,p_gsub,tp,basename,xdmf);
+  AsyncOutput<V,OUT> output(dnaploutput,pnew);
 
   // <<<10>>> Make a linear solver
   // Comment out below and uncomment to use different solver
@@ -532,7 +657,7 @@ void test (const GV& gv, int timesteps, double timestep)
   LS ls (tpgfs, 2000, 1);
 
   // <<<11>>> make Newton for time-dependent problem
-  typedef Dune::PDELab::Newton<IGO,LS,V> PDESOLVER;
+  typedef AssemblyTimedNewton<Dune::PDELab::Newton<IGO,LS,V> > PDESOLVER;
   PDESOLVER tnewton(igo,ls);
   tnewton.setReassembleThreshold(0.0);
   tnewton.setVerbosityLevel(2);
@@ -545,36 +670,29 @@ void test (const GV& gv, int timesteps, double timestep)
 
   // <<<13>>> graphics for initial value
   bool graphics = true;
-  char basename[255];
-  sprintf(basename,"dnapl-alex2-%01dd",dim);
   Dune::PDELab::FilenameHelper fn(basename);
   if (graphics)
   {
-    Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
-    vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_lDGF>(p_ldgf,"p_l"));
-    vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_gDGF>(p_gdgf,"p_g"));
-    vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_lDGF>(s_ldgf,"s_l"));
-    vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_gDGF>(s_gdgf,"s_g"));
-    vtkwriter.pwrite(fn.getName(),"","",Dune::VTK::appendedraw);
+    output.write(pnew,0.0,fn.getName());
     fn.increment();
   }
 
   // <<<14>>> time loop
   RF time = 0.0;
+  ActiveSetSummary summary;
+  watch.reset();
   for (int k=1; k<=timesteps; k++)
     {
       // do time step
+      if (k%full_reassembly==0)
+        lop.invalidate();
       osm.apply(time,timestep,pold,pnew);
+      summary.collect(gv,lop);
 
       // graphical output
       if (graphics)
         {
-          Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::conforming);
-          vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_lDGF>(p_ldgf,"p_l"));
-          vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_gDGF>(p_gdgf,"p_g"));
-          vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_lDGF>(s_ldgf,"s_l"));
-          vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_gDGF>(s_gdgf,"s_g"));
-          vtkwriter.pwrite(fn.getName(),"","",Dune::VTK::appendedraw);
+          output.write(pnew,time+timestep,fn.getName());
           fn.increment();
         }
 
@@ -582,7 +700,321 @@ void test (const GV& gv, int timesteps, double timestep)
       pold = pnew;
       time += timestep;
     }
+
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    InteriorIterator;
+  int cells = 0;
+  for (InteriorIterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    cells++;
+  cells = gv.comm().sum(cells);
+  output.finish();
+  const double elapsed = gv.comm().max(watch.elapsed());
+  const double waited = gv.comm().max(output.waitTime());
+  summary.assembly_time = tnewton.assemblyTime();
+  summary.print(gv);
+  const long meshbytes = gv.comm().sum(dnaploutput.meshBytes());
+  const long databytes = gv.comm().sum(dnaploutput.dataBytes());
+  if (gv.comm().rank()==0 && xdmf)
+    std::cout << "=== xdmf: mesh " << meshbytes << " bytes written once, data "
+              << databytes << " bytes" << std::endl;
+  if (gv.comm().rank()==0)
+    std::cout << "=== output: " << output.snapshotCount() << " snapshots written in the background,"
+              << " time loop waited " << waited << " s" << std::endl
+              << "=== uniform: cells " << cells
+              << " wall time " << elapsed << " s"
+              << " per simulated day " << elapsed*86400.0/time << " s" << std::endl;
+}
+
+#if HAVE_UG
+//==============================================================================
+// adaptive driver
+//==============================================================================
+
+// The unknowns are the phase pressures, but a conservative transfer has to
+// average the phase contents. Before the grid changes the gas pressure is
+// replaced by the liquid saturation s_l = s_l(p_g-p_l), which is averaged
+// on coarsening and copied on refinement by the P0 transfer of
+// adapt_grid, and afterwards p_g = p_l + p_c(s_l) is restored. Since the
+// densities and the porosity are constant, this conserves the mass of
+// both phases. The lens is aligned with the macro grid, so coarse cells
+// never mix lens and background material.
+template<typename TPGFS, typename V, typename TP>
+void convert_unknowns (const TPGFS& tpgfs, V& p, const TP& tp, bool to_saturation)
+{
+  typedef typename TPGFS::Traits::GridViewType GV;
+  typedef typename GV::Grid::ctype DF;
+  const int dim = GV::dimension;
+  typedef Dune::PDELab::LocalFunctionSpace<TPGFS> LFS;
+  typedef Dune::PDELab::LFSIndexCache<LFS> LFSCache;
+  LFS lfs(tpgfs);
+  LFSCache cache(lfs);
+  typename V::template LocalView<LFSCache> view(p);
+  std::vector<double> local(2);
+  const GV& gv = tpgfs.gridView();
+  for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+       it!=gv.template end<0>(); ++it)
+    {
+      const Dune::FieldVector<DF,dim> center =
+        Dune::ReferenceElements<DF,dim>::general(it->type()).position(0,0);
+      lfs.bind(*it);
+      cache.update();
+      view.bind(cache);
+      view.read(local);
+      if (to_saturation)
+        local[1] = tp.s_l(*it,center,local[1]-local[0]);
+      else
+        local[1] = local[0]+tp.pc(*it,center,local[1]);
+      view.write(local);
+      view.unbind();
+    }
+}
+
+// liquid saturation of every cell, indexed by the leaf index set
+template<typename TPGFS, typename V, typename TP>
+std::vector<double> cell_saturation (const TPGFS& tpgfs, const V& p, const TP& tp)
+{
+  typedef typename TPGFS::Traits::GridViewType GV;
+  typedef typename GV::Grid::ctype DF;
+  const int dim = GV::dimension;
+  typedef Dune::PDELab::LocalFunctionSpace<TPGFS> LFS;
+  typedef Dune::PDELab::LFSIndexCache<LFS> LFSCache;
+  LFS lfs(tpgfs);
+  LFSCache cache(lfs);
+  typename V::template ConstLocalView<LFSCache> view(p);
+  std::vector<double> local(2);
+  const GV& gv = tpgfs.gridView();
+  std::vector<double> s(gv.size(0));
+  for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+       it!=gv.template end<0>(); ++it)
+    {
+      const Dune::FieldVector<DF,dim> center =
+        Dune::ReferenceElements<DF,dim>::general(it->type()).position(0,0);
+      lfs.bind(*it);
+      cache.update();
+      view.bind(cache);
+      view.read(local);
+      view.unbind();
+      s[gv.indexSet().index(*it)] = tp.s_l(*it,center,local[1]-local[0]);
+    }
+  return s;
+}
+
+// Refine cells where the saturation jumps across a face by more than
+// refine_tol, together with their neighbours so that the front stays inside
+// the refined zone for the next time step; coarsen cells where all jumps
+// are below coarsen_tol (the grid coarsens only if all siblings agree).
+template<typename Grid>
+void mark_front (Grid& grid, const std::vector<double>& s,
+                 double refine_tol, double coarsen_tol, int minlevel, int maxlevel,
+                 int& refined, int& coarsened)
+{
+  typedef typename Grid::LeafGridView GV;
+  typedef typename GV::template Codim<0>::Iterator Iterator;
+  typedef typename GV::IntersectionIterator IntersectionIterator;
+  GV gv = grid.leafGridView();
+
+  std::vector<double> jump(gv.size(0),0.0);
+  for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+    {
+      const int i = gv.indexSet().index(*it);
+      for (IntersectionIterator iit=gv.ibegin(*it); iit!=gv.iend(*it); ++iit)
+        if (iit->neighbor())
+          jump[i] = std::max(jump[i],std::abs(s[i]-s[gv.indexSet().index(*iit->outside())]));
+    }
+
+  std::vector<bool> refine(gv.size(0),false);
+  for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+    {
+      const int i = gv.indexSet().index(*it);
+      if (jump[i]<=refine_tol) continue;
+      refine[i] = true;
+      for (IntersectionIterator iit=gv.ibegin(*it); iit!=gv.iend(*it); ++iit)
+        if (iit->neighbor())
+          refine[gv.indexSet().index(*iit->outside())] = true;
+    }
+
+  refined = coarsened = 0;
+  for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+    {
+      const int i = gv.indexSet().index(*it);
+      if (refine[i] && it->level()<maxlevel)
+        {
+          grid.mark(1,*it);
+          refined++;
+        }
+      else if (!refine[i] && jump[i]<coarsen_tol && it->level()>minlevel)
+        {
+          grid.mark(-1,*it);
+          coarsened++;
+        }
+    }
+}
+
+template<class Grid>
+void test_adaptive (Grid& grid, int minlevel, int maxlevel, int timesteps, double timestep)
+{
+  // <<<1>>> choose some types
+  typedef typename Grid::LeafGridView GV;
+  typedef typename GV::Grid::ctype DF;
+  typedef double RF;
+  const int dim = GV::dimension;
+  GV gv = grid.leafGridView();
+  Dune::Timer watch;
+
+  // <<<1b>>> refine towards the infiltration zone on the top boundary
+  for (int l=minlevel; l<maxlevel; l++)
+    {
+      for (typename GV::template Codim<0>::Iterator it=gv.template begin<0>();
+           it!=gv.template end<0>(); ++it)
+        {
+          const Dune::FieldVector<DF,dim> x = it->geometry().center();
+          const DF h = std::sqrt(it->geometry().volume());
+          if (x[dim-1]+h>height && x[0]>0.4-h && x[0]<0.6+h)
+            grid.mark(1,*it);
+        }
+      grid.preAdapt();
+      grid.adapt();
+      grid.postAdapt();
+    }
+
+  // <<<2>>> Make grid function space
+  typedef Dune::PDELab::P0LocalFiniteElementMap<DF,RF,dim> FEM;
+  FEM fem(Dune::GeometryType(Dune::GeometryType::cube,dim));
+  typedef Dune::PDELab::P0ParallelConstraints CON;
+  typedef Dune::PDELab::ISTLVectorBackend<> VBE0;
+  typedef Dune::PDELab::GridFunctionSpace<GV,FEM,CON,VBE0> GFS;
+  typedef Dune::PDELab::ISTLVectorBackend
+    <Dune::PDELab::ISTLParameters::static_blocking,2> VBE;
+  typedef Dune::PDELab::PowerGridFunctionSpace<GFS,2,VBE,
+    Dune::PDELab::EntityBlockedOrderingTag> TPGFS;
+  CON con;
+  GFS gfs(gv,fem,con);
+  TPGFS tpgfs(gfs);
+
+  typedef Dune::PDELab::GridFunctionSubSpace
+    <TPGFS,Dune::TypeTree::TreePath<0> > P_lSUB;
+  P_lSUB p_lsub(tpgfs);
+  typedef Dune::PDELab::GridFunctionSubSpace
+    <TPGFS,Dune::TypeTree::TreePath<1> > P_gSUB;
+  P_gSUB p_gsub(tpgfs);
+
+  // <<<3>>> make parameter object
+  typedef TwoPhaseParameter<GV,RF> TP;
+  TP tp;
+
+  // <<<4>>> make constraints map and initialize it
+  typedef typename TPGFS::template ConstraintsContainer<RF>::Type C;
+  C cg; cg.clear();
+  Dune::PDELab::constraints(tpgfs,cg,false);
+
+  // <<<5>>> make grid operator space; it follows the changes of the space
+  typedef Dune::PDELab::TwoPhaseTwoPointFluxOperator<TP> FluxLOP;
+  FluxLOP fluxlop(tp);
+  typedef ActiveSetLocalOperator<GV,FluxLOP> LOP;
+  LOP lop(gv,fluxlop,activeset_tol);
+  lop.setActive(activeset);
+  typedef Dune::PDELab::TwoPhaseOnePointTemporalOperator<TP> MLOP;
+  MLOP mlop(tp);
+  typedef Dune::PDELab::istl::BCRSMatrixBackend<> MBE;
+  MBE mbe(9); // hanging nodes: up to two neighbours per face
+  Dune::PDELab::Alexander2Parameter<RF> method;
+  typedef Dune::PDELab::GridOperator<TPGFS,TPGFS,LOP,MBE,RF,RF,RF,C,C> GO0;
+  GO0 go0(tpgfs,cg,tpgfs,cg,lop,mbe);
+  typedef Dune::PDELab::GridOperator<TPGFS,TPGFS,MLOP,MBE,RF,RF,RF,C,C> GO1;
+  GO1 go1(tpgfs,cg,tpgfs,cg,mlop,mbe);
+  typedef Dune::PDELab::OneStepGridOperator<GO0,GO1> IGO;
+  IGO igo(go0,go1);
+
+  // <<<6>>> initial values
+  typedef P_l<GV,RF> P_lType;
+  P_lType p_l_initial(gv,tp);
+  typedef P_g<GV,RF> P_gType;
+  P_gType p_g_initial(gv,tp);
+  typedef Dune::PDELab::CompositeGridFunction<P_lType,P_gType> PType;
+  PType p_initial(p_l_initial,p_g_initial);
+  typedef typename IGO::Traits::Domain V;
+  V pold(tpgfs);
+  Dune::PDELab::interpolate(p_initial,tpgfs,pold);
+  V pnew(tpgfs);
+  pnew = pold;
+
+  typedef Dune::PDELab::DiscreteGridFunction<P_lSUB,V> P_lDGF;
+  P_lDGF p_ldgf(p_lsub,pnew);
+  typedef Dune::PDELab::DiscreteGridFunction<P_gSUB,V> P_gDGF;
+  P_gDGF p_gdgf(p_gsub,pnew);
+  typedef S_l<TP,P_lDGF,P_gDGF> S_lDGF;
+  S_lDGF s_ldgf(tp,p_ldgf,p_gdgf);
+
+  // <<<7>>> linear solver; the backend is built in the time loop, as its
+  // parallel helper depends on the current space
+  typedef Dune::PDELab::ISTLBackend_BCGS_AMG_SSOR<IGO> LS;
+
+  char basename[255];
+  sprintf(basename,"dnapl-adaptive-%01dd",dim);
+  Dune::PDELab::FilenameHelper fn(basename);
+
+  // <<<8>>> time loop: adapt to the front, then do the time step
+  const double refine_tol = 0.05;
+  const double coarsen_tol = 0.01;
+  RF time = 0.0;
+  double cellsum = 0.0;
+  ActiveSetSummary summary;
+  watch.reset();
+  for (int k=1; k<=timesteps; k++)
+    {
+      if (k>1)
+        {
+          int refined, coarsened;
+          mark_front(grid,cell_saturation(tpgfs,pold,tp),refine_tol,coarsen_tol,
+                     minlevel,maxlevel,refined,coarsened);
+          convert_unknowns(tpgfs,pold,tp,true);
+          Dune::PDELab::adapt_grid(grid,tpgfs,pold,1);
+          convert_unknowns(tpgfs,pold,tp,false);
+          lop.invalidate();
+          Dune::PDELab::constraints(tpgfs,cg,false);
+          pnew = pold;
+          std::cout << "=== adapt: refined " << refined << " coarsened " << coarsened
+                    << " cells " << gv.size(0) << std::endl;
+        }
+      cellsum += gv.size(0);
+
+      // the solver backend and Newton keep data of the space between calls,
+      // so they are set up for the current space
+      LS ls(tpgfs,2000,1);
+      typedef AssemblyTimedNewton<Dune::PDELab::Newton<IGO,LS,V> > PDESOLVER;
+      PDESOLVER tnewton(igo,ls);
+      tnewton.setReassembleThreshold(0.0);
+      tnewton.setVerbosityLevel(1);
+      tnewton.setReduction(1e-8);
+      tnewton.setMinLinearReduction(1e-3);
+      Dune::PDELab::OneStepMethod<RF,IGO,PDESOLVER,V,V> osm(method,igo,tnewton);
+      osm.setVerbosityLevel(1);
+      if (k%full_reassembly==0)
+        lop.invalidate();
+      osm.apply(time,timestep,pold,pnew);
+      summary.collect(gv,lop);
+      summary.assembly_time += tnewton.assemblyTime();
+
+      Dune::VTKWriter<GV> vtkwriter(gv,Dune::VTK::nonconforming);
+      vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_lDGF>(p_ldgf,"p_l"));
+      vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<P_gDGF>(p_gdgf,"p_g"));
+      vtkwriter.addCellData(new Dune::PDELab::VTKGridFunctionAdapter<S_lDGF>(s_ldgf,"s_l"));
+      vtkwriter.pwrite(fn.getName(),"","",Dune::VTK::appendedraw);
+      fn.increment();
+
+      pold = pnew;
+      time += timestep;
+    }
+
+  const double elapsed = watch.elapsed();
+  summary.print(gv);
+  std::cout << "=== adaptive: mean cells " << cellsum/timesteps
+            << " final cells " << gv.size(0)
+            << " wall time " << elapsed << " s"
+            << " per simulated day " << elapsed*86400.0/time << " s" << std::endl;
 }
+#endif
 
 //==============================================================================
 // grid setup
@@ -602,11 +1034,15 @@ int main(int argc, char** argv)
 	  }
     rank = helper.rank();
 
-	if (argc!=4 && argc!=5)
+	if (argc<4 || argc>8)
 	  {
         if(helper.rank()==0){
-          std::cout << "usage: ./dnapl <level> <timesteps> <timestep> [<dimension>]" << std::endl;
+          std::cout << "usage: ./dnapl <level> <timesteps> <timestep> [<dimension>] [uniform|adaptive] [vtk|xdmf] [activeset|plain]" << std::endl;
+          std::cout << "xdmf is only available with the uniform driver" << std::endl;
           std::cout << "coarse example: ./dnapl 1 200 20" << std::endl;
+          std::cout << "adaptive example with the same finest cells as level 3: ./dnapl 3 200 20 2 adaptive" << std::endl;
+          std::cout << "xdmf output with the mesh written once: ./dnapl 1 200 20 2 uniform xdmf" << std::endl;
+          std::cout << "assembly time without reuse of flux contributions: ./dnapl 1 200 20 2 uniform vtk plain" << std::endl;
         }
 		return 1;
 	  }
@@ -624,8 +1060,54 @@ int main(int argc, char** argv)
     if(argc>4)
       sscanf(argv[4], "%d", &dimension);
 
+    bool adaptive = false;
+    if(argc>5)
+      adaptive = (std::string(argv[5])=="adaptive");
+
+    // output format of the uniform driver; xdmf writes the mesh only once
+    bool xdmf = false;
+    if(argc>6)
+      {
+        xdmf = (std::string(argv[6])=="xdmf");
+        if (!xdmf && std::string(argv[6])!="vtk")
+          DUNE_THROW(Dune::Exception,"unknown output format " << argv[6]);
+        if (xdmf && adaptive)
+          DUNE_THROW(Dune::Exception,"xdmf output needs a fixed mesh, use it with the uniform driver");
+      }
+
+    // reuse of unchanged flux contributions, or the plain flux operator
+    if(argc>7)
+      {
+        activeset = (std::string(argv[7])=="activeset");
+        if (!activeset && std::string(argv[7])!="plain")
+          DUNE_THROW(Dune::Exception,"unknown assembly mode " << argv[7]);
+      }
+
+    // 2D, locally refined UG grid: level 0 is the 10x6 macro grid and
+    // <level> the finest level, so the finest cells match the uniform run
+    if (dimension==2 && adaptive)
+    {
+#if HAVE_UG
+      if (helper.size()>1)
+        DUNE_THROW(Dune::NotImplemented,"the adaptive variant is sequential");
+      const int dim=2;
+      typedef Dune::UGGrid<dim> Grid;
+      Dune::FieldVector<Grid::ctype,dim> lower(0.0);
+      Dune::FieldVector<Grid::ctype,dim> upper(width);
+      upper[1] = height;
+      std::array<unsigned int,dim> elements;
+      elements[0] = 10;
+      elements[1] = 6;
+      std::shared_ptr<Grid> grid = Dune::StructuredGridFactory<Grid>::createCubeGrid(lower,upper,elements);
+      grid->setClosureType(Grid::NONE);
+      test_adaptive(*grid,0,maxlevel,timesteps,timestep);
+#else
+      std::cout << "The adaptive variant requires UG!" << std::endl;
+#endif
+    }
+
     // 2D
-    if (dimension==2)
+    if (dimension==2 && !adaptive)
     {
       const int dim=2;
       // make grid
@@ -641,7 +1123,7 @@ int main(int argc, char** argv)
       Dune::YaspGrid<dim> grid(helper.getCommunicator(),L,N,B,overlap);
 
       // solve problem :)
-      test(grid.leafGridView(),timesteps,timestep);
+      test(grid.leafGridView(),timesteps,timestep,xdmf);
     }
 
     // 3D
@@ -659,7 +1141,7 @@ int main(int argc, char** argv)
       Dune::YaspGrid<dim> grid(helper.getCommunicator(),L,N,B,overlap);
 
       // solve problem :)
-      test(grid.leafGridView(),timesteps,timestep);
+      test(grid.leafGridView(),timesteps,timestep,xdmf);
     }
 
 	// test passed
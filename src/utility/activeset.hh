@@ -0,0 +1,393 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_ACTIVESET_HH
+#define DUNE_PDELAB_HOWTO_ACTIVESET_HH
+
+#include<algorithm>
+#include<cmath>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+
+/** \brief Local operator wrapper that evaluates residual and Jacobian
+ *  contributions only where the solution has changed
+ *
+ * Transport fronts are localized: over a time step most cells keep their
+ * state, far ahead of the front or behind it. The wrapper stores every
+ * volume, skeleton and boundary contribution together with the local
+ * coefficients it was computed from. On the next evaluation the stored
+ * contribution is reused if no coefficient has changed by more than
+ * tol relative to its size, and recomputed otherwise. A face term
+ * depends on both adjacent cells, so the active set automatically
+ * consists of the changed cells and the faces to their neighbours.
+ *
+ * The contributions are stored unweighted, so they can be shared by the
+ * stages of a one step method. The spatial operator must not depend on
+ * time explicitly unless time_dependent is set, in which case every
+ * change of time clears the stored values. invalidate() forces a full
+ * reassembly and has to be called after the grid changed; calling it
+ * every few time steps bounds the drift introduced by tol > 0.
+ *
+ * The stored values live in flat arrays indexed by the cell index and
+ * the number of the intersection within the cell, so a lookup costs a
+ * compare of the local coefficients only. This requires local function
+ * spaces of the same size on all cells, as for finite volumes. With
+ * setActive(false) every call is passed on to LOP, which gives the
+ * reference for timing the assembly with and without the wrapper.
+ *
+ * Only the alpha and jacobian methods are wrapped; pattern, lambda and
+ * time stepping methods are inherited from LOP.
+ *
+ * \tparam GV  grid view the operator is assembled on
+ * \tparam LOP spatial local operator
+ */
+template<typename GV, typename LOP>
+class ActiveSetLocalOperator : public LOP
+{
+  // stored contributions of one kind, slot i at i*nstate and i*nvalues
+  struct Cache
+  {
+    Cache () : nstate(0), nvalues(0) {}
+    std::size_t nstate, nvalues;   // per slot, fixed on first use
+    std::vector<double> state;     // local coefficients the values belong to
+    std::vector<double> values;    // residual or row major Jacobian blocks
+    std::vector<char> valid;
+  };
+
+public:
+  ActiveSetLocalOperator (const GV& gv_, const LOP& lop, double tol_=0.0, bool time_dependent_=false)
+    : LOP(lop), gv(gv_), tol(tol_), time_dependent(time_dependent_), active(true),
+      time(-1e100), computed(0), reused(0)
+  {
+    invalidate();
+  }
+
+  //! forget all stored contributions and renumber the intersections
+  void invalidate ()
+  {
+    typedef typename GV::template Codim<0>::Iterator Iterator;
+    typedef typename GV::IntersectionIterator IntersectionIterator;
+    offset.assign(gv.size(0)+1,0);
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      for (IntersectionIterator iit=gv.ibegin(*it); iit!=gv.iend(*it); ++iit)
+        offset[gv.indexSet().index(*it)+1]++;
+    for (std::size_t i=1; i<offset.size(); i++)
+      offset[i] += offset[i-1];
+    Cache* caches[6] = {&volume_r,&skeleton_r,&boundary_r,&volume_j,&skeleton_j,&boundary_j};
+    for (int k=0; k<6; k++)
+      *caches[k] = Cache();
+  }
+
+  //! pass all calls on to LOP without storing anything
+  void setActive (bool active_)
+  {
+    active = active_;
+  }
+
+  //! number of recomputed and reused contributions since the last call
+  void statistics (std::size_t& computed_, std::size_t& reused_)
+  {
+    computed_ = computed; reused_ = reused;
+    computed = reused = 0;
+  }
+
+  template<typename RF>
+  void setTime (RF t)
+  {
+    if (time_dependent && t!=time) clear();
+    time = t;
+    LOP::setTime(t);
+  }
+
+  // residual
+
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv, R& r) const
+  {
+    if (!active)
+      return LOP::alpha_volume(eg,lfsu,x,lfsv,r);
+    const std::size_t i = cellSlot(eg.entity());
+    prepare(volume_r,gv.size(0),lfsu.size(),lfsv.size());
+    if (!current(volume_r,i,lfsu,x))
+      {
+        typename R::Container rl(lfsv.size(),0.0);
+        typename R::Container::WeightedAccumulationView view(rl.weightedAccumulationView(1.0));
+        LOP::alpha_volume(eg,lfsu,x,lfsv,view);
+        double* values = &volume_r.values[i*volume_r.nvalues];
+        store(values,lfsv,rl);
+        volume_r.valid[i] = 1;
+      }
+    accumulate(r,lfsv,&volume_r.values[i*volume_r.nvalues]);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_skeleton (const IG& ig,
+                       const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                       const LFSU& lfsu_n, const X& x_n, const LFSV& lfsv_n,
+                       R& r_s, R& r_n) const
+  {
+    if (!active)
+      return LOP::alpha_skeleton(ig,lfsu_s,x_s,lfsv_s,lfsu_n,x_n,lfsv_n,r_s,r_n);
+    const std::size_t i = faceSlot(ig);
+    prepare(skeleton_r,offset.back(),lfsu_s.size()+lfsu_n.size(),lfsv_s.size()+lfsv_n.size());
+    if (!current(skeleton_r,i,lfsu_s,x_s,lfsu_n,x_n))
+      {
+        typename R::Container rl_s(lfsv_s.size(),0.0), rl_n(lfsv_n.size(),0.0);
+        typename R::Container::WeightedAccumulationView view_s(rl_s.weightedAccumulationView(1.0));
+        typename R::Container::WeightedAccumulationView view_n(rl_n.weightedAccumulationView(1.0));
+        LOP::alpha_skeleton(ig,lfsu_s,x_s,lfsv_s,lfsu_n,x_n,lfsv_n,view_s,view_n);
+        double* values = &skeleton_r.values[i*skeleton_r.nvalues];
+        values = store(values,lfsv_s,rl_s);
+        store(values,lfsv_n,rl_n);
+        skeleton_r.valid[i] = 1;
+      }
+    const double* values = &skeleton_r.values[i*skeleton_r.nvalues];
+    values = accumulate(r_s,lfsv_s,values);
+    accumulate(r_n,lfsv_n,values);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_boundary (const IG& ig, const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                       R& r_s) const
+  {
+    if (!active)
+      return LOP::alpha_boundary(ig,lfsu_s,x_s,lfsv_s,r_s);
+    const std::size_t i = faceSlot(ig);
+    prepare(boundary_r,offset.back(),lfsu_s.size(),lfsv_s.size());
+    if (!current(boundary_r,i,lfsu_s,x_s))
+      {
+        typename R::Container rl(lfsv_s.size(),0.0);
+        typename R::Container::WeightedAccumulationView view(rl.weightedAccumulationView(1.0));
+        LOP::alpha_boundary(ig,lfsu_s,x_s,lfsv_s,view);
+        store(&boundary_r.values[i*boundary_r.nvalues],lfsv_s,rl);
+        boundary_r.valid[i] = 1;
+      }
+    accumulate(r_s,lfsv_s,&boundary_r.values[i*boundary_r.nvalues]);
+  }
+
+  // Jacobian
+
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename M>
+  void jacobian_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv, M& mat) const
+  {
+    if (!active)
+      return LOP::jacobian_volume(eg,lfsu,x,lfsv,mat);
+    const std::size_t i = cellSlot(eg.entity());
+    prepare(volume_j,gv.size(0),lfsu.size(),lfsv.size()*lfsu.size());
+    if (!current(volume_j,i,lfsu,x))
+      {
+        typename M::Container ml(lfsv.size(),lfsu.size(),0.0);
+        typename M::Container::WeightedAccumulationView view(ml.weightedAccumulationView(1.0));
+        LOP::jacobian_volume(eg,lfsu,x,lfsv,view);
+        store(&volume_j.values[i*volume_j.nvalues],lfsv,lfsu,ml);
+        volume_j.valid[i] = 1;
+      }
+    accumulate(mat,lfsv,lfsu,&volume_j.values[i*volume_j.nvalues]);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename M>
+  void jacobian_skeleton (const IG& ig,
+                          const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                          const LFSU& lfsu_n, const X& x_n, const LFSV& lfsv_n,
+                          M& mat_ss, M& mat_sn, M& mat_ns, M& mat_nn) const
+  {
+    if (!active)
+      return LOP::jacobian_skeleton(ig,lfsu_s,x_s,lfsv_s,lfsu_n,x_n,lfsv_n,
+                                    mat_ss,mat_sn,mat_ns,mat_nn);
+    const std::size_t i = faceSlot(ig);
+    prepare(skeleton_j,offset.back(),lfsu_s.size()+lfsu_n.size(),
+            (lfsv_s.size()+lfsv_n.size())*(lfsu_s.size()+lfsu_n.size()));
+    if (!current(skeleton_j,i,lfsu_s,x_s,lfsu_n,x_n))
+      {
+        typename M::Container ml_ss(lfsv_s.size(),lfsu_s.size(),0.0);
+        typename M::Container ml_sn(lfsv_s.size(),lfsu_n.size(),0.0);
+        typename M::Container ml_ns(lfsv_n.size(),lfsu_s.size(),0.0);
+        typename M::Container ml_nn(lfsv_n.size(),lfsu_n.size(),0.0);
+        typename M::Container::WeightedAccumulationView view_ss(ml_ss.weightedAccumulationView(1.0));
+        typename M::Container::WeightedAccumulationView view_sn(ml_sn.weightedAccumulationView(1.0));
+        typename M::Container::WeightedAccumulationView view_ns(ml_ns.weightedAccumulationView(1.0));
+        typename M::Container::WeightedAccumulationView view_nn(ml_nn.weightedAccumulationView(1.0));
+        LOP::jacobian_skeleton(ig,lfsu_s,x_s,lfsv_s,lfsu_n,x_n,lfsv_n,
+                               view_ss,view_sn,view_ns,view_nn);
+        double* values = &skeleton_j.values[i*skeleton_j.nvalues];
+        values = store(values,lfsv_s,lfsu_s,ml_ss);
+        values = store(values,lfsv_s,lfsu_n,ml_sn);
+        values = store(values,lfsv_n,lfsu_s,ml_ns);
+        store(values,lfsv_n,lfsu_n,ml_nn);
+        skeleton_j.valid[i] = 1;
+      }
+    const double* values = &skeleton_j.values[i*skeleton_j.nvalues];
+    values = accumulate(mat_ss,lfsv_s,lfsu_s,values);
+    values = accumulate(mat_sn,lfsv_s,lfsu_n,values);
+    values = accumulate(mat_ns,lfsv_n,lfsu_s,values);
+    accumulate(mat_nn,lfsv_n,lfsu_n,values);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename M>
+  void jacobian_boundary (const IG& ig, const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                          M& mat_ss) const
+  {
+    if (!active)
+      return LOP::jacobian_boundary(ig,lfsu_s,x_s,lfsv_s,mat_ss);
+    const std::size_t i = faceSlot(ig);
+    prepare(boundary_j,offset.back(),lfsu_s.size(),lfsv_s.size()*lfsu_s.size());
+    if (!current(boundary_j,i,lfsu_s,x_s))
+      {
+        typename M::Container ml(lfsv_s.size(),lfsu_s.size(),0.0);
+        typename M::Container::WeightedAccumulationView view(ml.weightedAccumulationView(1.0));
+        LOP::jacobian_boundary(ig,lfsu_s,x_s,lfsv_s,view);
+        store(&boundary_j.values[i*boundary_j.nvalues],lfsv_s,lfsu_s,ml);
+        boundary_j.valid[i] = 1;
+      }
+    accumulate(mat_ss,lfsv_s,lfsu_s,&boundary_j.values[i*boundary_j.nvalues]);
+  }
+
+private:
+  template<typename E>
+  std::size_t cellSlot (const E& e) const
+  {
+    return gv.indexSet().index(e);
+  }
+
+  template<typename IG>
+  std::size_t faceSlot (const IG& ig) const
+  {
+    return offset[gv.indexSet().index(*ig.inside())]+ig.intersectionIndex();
+  }
+
+  // allocate the cache on first use; the sizes must not change afterwards
+  static void prepare (Cache& cache, std::size_t slots, std::size_t nstate, std::size_t nvalues)
+  {
+    if (cache.nstate==nstate && cache.nvalues==nvalues)
+      return;
+    if (cache.nstate!=0 || cache.nvalues!=0)
+      DUNE_THROW(Dune::Exception,"ActiveSetLocalOperator needs local spaces of equal size on all cells");
+    cache.nstate = nstate;
+    cache.nvalues = nvalues;
+    cache.state.assign(slots*nstate,0.0);
+    cache.values.assign(slots*nvalues,0.0);
+    cache.valid.assign(slots,0);
+  }
+
+  //! mark all stored contributions as outdated, keeping the memory
+  void clear ()
+  {
+    Cache* caches[6] = {&volume_r,&skeleton_r,&boundary_r,&volume_j,&skeleton_j,&boundary_j};
+    for (int k=0; k<6; k++)
+      std::fill(caches[k]->valid.begin(),caches[k]->valid.end(),0);
+  }
+
+  bool same (double a, double b) const
+  {
+    return std::abs(a-b)<=tol*std::max(std::abs(a),std::abs(b));
+  }
+
+  // compare the local coefficients with the stored state and update it
+  template<typename LFSU, typename X>
+  bool current (Cache& cache, std::size_t i, const LFSU& lfsu, const X& x) const
+  {
+    double* state = &cache.state[i*cache.nstate];
+    bool hit = cache.valid[i];
+    for (std::size_t k=0; hit && k<lfsu.size(); k++)
+      hit = same(state[k],x(lfsu,k));
+    if (hit) { reused++; return true; }
+    for (std::size_t k=0; k<lfsu.size(); k++)
+      state[k] = x(lfsu,k);
+    computed++;
+    return false;
+  }
+
+  template<typename LFSU, typename X>
+  bool current (Cache& cache, std::size_t i, const LFSU& lfsu_s, const X& x_s,
+                const LFSU& lfsu_n, const X& x_n) const
+  {
+    double* state = &cache.state[i*cache.nstate];
+    double* state_n = state+lfsu_s.size();
+    bool hit = cache.valid[i];
+    for (std::size_t k=0; hit && k<lfsu_s.size(); k++)
+      hit = same(state[k],x_s(lfsu_s,k));
+    for (std::size_t k=0; hit && k<lfsu_n.size(); k++)
+      hit = same(state_n[k],x_n(lfsu_n,k));
+    if (hit) { reused++; return true; }
+    for (std::size_t k=0; k<lfsu_s.size(); k++)
+      state[k] = x_s(lfsu_s,k);
+    for (std::size_t k=0; k<lfsu_n.size(); k++)
+      state_n[k] = x_n(lfsu_n,k);
+    computed++;
+    return false;
+  }
+
+  // copy a local residual or Jacobian block, return the end of the copy
+  template<typename LFSV, typename RL>
+  static double* store (double* values, const LFSV& lfsv, const RL& rl)
+  {
+    for (std::size_t i=0; i<lfsv.size(); i++)
+      *values++ = rl(lfsv,i);
+    return values;
+  }
+
+  template<typename LFSV, typename LFSU, typename ML>
+  static double* store (double* values, const LFSV& lfsv, const LFSU& lfsu, const ML& ml)
+  {
+    for (std::size_t i=0; i<lfsv.size(); i++)
+      for (std::size_t j=0; j<lfsu.size(); j++)
+        *values++ = ml(lfsv,i,lfsu,j);
+    return values;
+  }
+
+  template<typename R, typename LFSV>
+  static const double* accumulate (R& r, const LFSV& lfsv, const double* values)
+  {
+    for (std::size_t i=0; i<lfsv.size(); i++)
+      r.accumulate(lfsv,i,*values++);
+    return values;
+  }
+
+  template<typename M, typename LFSV, typename LFSU>
+  static const double* accumulate (M& mat, const LFSV& lfsv, const LFSU& lfsu, const double* values)
+  {
+    for (std::size_t i=0; i<lfsv.size(); i++)
+      for (std::size_t j=0; j<lfsu.size(); j++)
+        mat.accumulate(lfsv,i,lfsu,j,*values++);
+    return values;
+  }
+
+  GV gv;
+  double tol;
+  bool time_dependent;
+  bool active;
+  double time;
+  std::vector<std::size_t> offset;   // first intersection slot of every cell
+  mutable Cache volume_r, skeleton_r, boundary_r;
+  mutable Cache volume_j, skeleton_j, boundary_j;
+  mutable std::size_t computed, reused;
+};
+
+/** \brief Newton solver that sums up the Jacobian assembly time over all calls
+ *
+ * The one step methods call the solver once per stage, and the result
+ * of the solver only covers the last call; used to compare the assembly
+ * with and without ActiveSetLocalOperator.
+ */
+template<typename NEWTON>
+class AssemblyTimedNewton : public NEWTON
+{
+public:
+  template<typename... Args>
+  AssemblyTimedNewton (Args&... args)
+    : NEWTON(args...), assembly_time(0.0)
+  {}
+
+  template<typename V>
+  void apply (V& u)
+  {
+    NEWTON::apply(u);
+    assembly_time += this->result().assembler_time;
+  }
+
+  double assemblyTime () const { return assembly_time; }
+
+private:
+  double assembly_time;
+};
+
+#endif // DUNE_PDELAB_HOWTO_ACTIVESET_HH
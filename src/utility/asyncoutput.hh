@@ -0,0 +1,276 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_ASYNCOUTPUT_HH
+#define DUNE_PDELAB_HOWTO_ASYNCOUTPUT_HH
+
+#include<condition_variable>
+#include<deque>
+#include<exception>
+#include<fstream>
+#include<iomanip>
+#include<memory>
+#include<mutex>
+#include<sstream>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/grid/io/file/vtk/vtkwriter.hh>
+
+/** \brief write output of a time dependent simulation in a background thread
+ *
+ * write() copies the solution into one of a fixed number of buffers that
+ * are allocated in the constructor, queues it and returns, so the time
+ * loop continues while a writer thread hands the snapshot to the output
+ * functor. If all buffers are queued, write() blocks until the oldest one
+ * is written. This bounds the memory to the given number of vectors and
+ * keeps the time loop at most that many snapshots ahead of the disk.
+ *
+ * OUT provides write(const V& x, double time, const std::string& name).
+ * It is only called from the writer thread, one snapshot after the other
+ * in the order of the calls to write(). It must not use MPI, which is
+ * initialized without thread support; VTKPieceWriter and VTKCollection
+ * below write parallel VTK output without communication. The grid and
+ * the function spaces are read concurrently by the time loop and the
+ * writer thread; call finish() before they are changed, e.g. by
+ * adaptation. An exception thrown by OUT is rethrown by the next call
+ * to write() or finish().
+ *
+ * \tparam V   vector type
+ * \tparam OUT output functor
+ */
+template<typename V, typename OUT>
+class AsyncOutput
+{
+  struct Snapshot
+  {
+    Snapshot (const V& x_) : x(x_), time(0.0) {}
+    V x;
+    double time;
+    std::string name;
+  };
+
+public:
+  AsyncOutput (OUT& out_, const V& x, int buffers=2)
+    : out(out_), stop(false), snapshots(0), wait_time(0.0), write_time(0.0)
+  {
+    if (buffers<1)
+      DUNE_THROW(Dune::Exception,"AsyncOutput needs at least one buffer");
+    for (int i=0; i<buffers; i++)
+      {
+        snapshot.push_back(std::make_shared<Snapshot>(x));
+        available.push_back(i);
+      }
+    thread = std::thread(&AsyncOutput::run,this);
+  }
+
+  ~AsyncOutput ()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!queued.empty())
+        changed.wait(lock);
+      stop = true;
+    }
+    changed.notify_all();
+    thread.join();
+  }
+
+  //! copy x into a free buffer and queue it for output as name at the given time
+  void write (const V& x, double time, const std::string& name)
+  {
+    int i;
+    {
+      Dune::Timer watch;
+      std::unique_lock<std::mutex> lock(mutex);
+      while (available.empty() && !error)
+        changed.wait(lock);
+      wait_time += watch.elapsed();
+      rethrow();
+      i = available.front();
+      available.pop_front();
+    }
+    // the buffer is owned by this thread until it is queued
+    snapshot[i]->x = x;
+    snapshot[i]->time = time;
+    snapshot[i]->name = name;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queued.push_back(i);
+      snapshots++;
+    }
+    changed.notify_all();
+  }
+
+  //! wait until all queued snapshots are written
+  void finish ()
+  {
+    Dune::Timer watch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!queued.empty())
+      changed.wait(lock);
+    wait_time += watch.elapsed();
+    rethrow();
+  }
+
+  //! statistics
+  int snapshotCount () const { return snapshots; }
+  int bufferCount () const { return snapshot.size(); }
+  //! time the calling thread was blocked in write() and finish()
+  double waitTime () const { return wait_time; }
+  //! time spent in the output functor on the writer thread
+  double writeTime () const
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    return write_time;
+  }
+
+private:
+  AsyncOutput (const AsyncOutput&);
+  AsyncOutput& operator= (const AsyncOutput&);
+
+  void run ()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+      {
+        while (queued.empty() && !stop)
+          changed.wait(lock);
+        if (queued.empty())
+          return;
+
+        // the front buffer stays queued while it is written, so that
+        // finish() waits for it
+        const int i = queued.front();
+        lock.unlock();
+        Dune::Timer watch;
+        std::exception_ptr e;
+        try {
+          out.write(snapshot[i]->x,snapshot[i]->time,snapshot[i]->name);
+        }
+        catch (...) {
+          e = std::current_exception();
+        }
+        const double elapsed = watch.elapsed();
+        lock.lock();
+        write_time += elapsed;
+        if (e && !error)
+          error = e;
+        queued.pop_front();
+        available.push_back(i);
+        changed.notify_all();
+      }
+  }
+
+  //! called with the lock held
+  void rethrow ()
+  {
+    if (error)
+      {
+        std::exception_ptr e = error;
+        error = std::exception_ptr();
+        std::rethrow_exception(e);
+      }
+  }
+
+  OUT& out;
+  std::vector<std::shared_ptr<Snapshot> > snapshot;
+  std::deque<int> available, queued;
+  mutable std::mutex mutex;
+  std::condition_variable changed;
+  std::exception_ptr error;
+  bool stop;
+  int snapshots;
+  double wait_time, write_time;
+  std::thread thread;
+};
+
+/** \brief VTK writer that writes the part of the grid of one rank without communication
+ *
+ * VTKWriter::pwrite synchronizes the ranks, which is not possible on a
+ * writer thread. writePiece() writes the interior elements of the calling
+ * rank as a standalone file with the serial code path of VTKWriter;
+ * VTKCollection lists the pieces of all ranks.
+ *
+ * \tparam GV grid view
+ * \tparam W  VTK writer, e.g. Dune::SubsamplingVTKWriter<GV>
+ */
+template<typename GV, typename W=Dune::VTKWriter<GV> >
+class VTKPieceWriter : public W
+{
+public:
+  //! the arguments are passed on to the constructor of W
+  template<typename... Args>
+  VTKPieceWriter (const GV& gv, Args... args)
+    : W(gv,args...)
+  {}
+
+  //! write name.vtu (or .vtp), name may contain a relative path; returns the file name
+  std::string writePiece (const std::string& name, Dune::VTK::OutputType type)
+  {
+    return this->Dune::VTKWriter<GV>::write(name,type,0,1);
+  }
+};
+
+/** \brief ParaView collection file of a time series of VTK pieces
+ *
+ * Rank r writes the file name-pRRRR.vtu for every snapshot, or name.vtu
+ * in a sequential run. Rank 0 rewrites basename.pvd after every step,
+ * listing the pieces of all ranks as parts of one data set per time.
+ */
+class VTKCollection
+{
+public:
+  //! rank and size are taken from the grid view on the calling thread
+  template<typename GV>
+  VTKCollection (const GV& gv, const std::string& basename_, const std::string& path_="")
+    : rank(gv.comm().rank()), size(gv.comm().size()), basename(basename_), path(path_)
+  {}
+
+  //! write the piece of this rank for the given time
+  template<typename PW>
+  void write (PW& vtkwriter, double time, const std::string& name, Dune::VTK::OutputType type)
+  {
+    std::string file = vtkwriter.writePiece(pieceName(name,rank),type);
+    times.push_back(time);
+    names.push_back(name);
+    extension = file.substr(file.rfind('.'));
+    if (rank==0)
+      writeCollection();
+  }
+
+private:
+  std::string pieceName (const std::string& name, int r) const
+  {
+    std::stringstream s;
+    if (!path.empty())
+      s << path << "/";
+    s << name;
+    if (size>1)
+      s << "-p" << std::setw(4) << std::setfill('0') << r;
+    return s.str();
+  }
+
+  void writeCollection () const
+  {
+    std::ofstream file((basename+".pvd").c_str());
+    file << "<?xml version=\"1.0\"?>" << std::endl
+         << "<VTKFile type=\"Collection\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl
+         << "<Collection>" << std::endl;
+    file << std::setprecision(16);
+    for (std::size_t i=0; i<times.size(); i++)
+      for (int r=0; r<size; r++)
+        file << "<DataSet timestep=\"" << times[i] << "\" group=\"\" part=\"" << r << "\""
+             << " file=\"" << pieceName(names[i],r) << extension << "\"/>" << std::endl;
+    file << "</Collection>" << std::endl
+         << "</VTKFile>" << std::endl;
+  }
+
+  int rank, size;
+  std::string basename, path, extension;
+  std::vector<double> times;
+  std::vector<std::string> names;
+};
+
+#endif // DUNE_PDELAB_HOWTO_ASYNCOUTPUT_HH
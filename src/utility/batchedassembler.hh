@@ -0,0 +1,317 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_BATCHEDASSEMBLER_HH
+#define DUNE_PDELAB_HOWTO_BATCHEDASSEMBLER_HH
+
+#include<algorithm>
+#include<cstddef>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/fvector.hh>
+#include<dune/geometry/type.hh>
+#include<dune/geometry/quadraturerules.hh>
+#include<dune/geometry/referenceelements.hh>
+#include<dune/pdelab/backend/istl.hh>
+#include<dune/pdelab/gridfunctionspace/localfunctionspace.hh>
+#include<dune/pdelab/gridfunctionspace/lfsindexcache.hh>
+
+// number of elements processed together, chosen to fill one SIMD register
+#ifndef BATCHED_ASSEMBLY_WIDTH
+#if defined(__AVX512F__)
+#define BATCHED_ASSEMBLY_WIDTH 8
+#elif defined(__AVX__)
+#define BATCHED_ASSEMBLY_WIDTH 4
+#else
+#define BATCHED_ASSEMBLY_WIDTH 2
+#endif
+#endif
+
+/** \brief Local operator wrapper that switches off all volume terms
+ *
+ * Used together with BatchedAssembler: the wrapped operator still
+ * provides the sparsity pattern, the boundary (and skeleton) terms and
+ * the treatment of constraints through an ordinary GridOperator, while
+ * the volume terms are assembled in batches.
+ */
+template<typename LOP>
+class BoundaryOnlyLocalOperator
+  : public LOP
+{
+public:
+  // residual assembly flags
+  enum { doAlphaVolume = false };
+  enum { doLambdaVolume = false };
+
+  using LOP::LOP;
+};
+
+/** \brief Assemble volume terms of low order conforming elements in batches
+ *
+ * Assembles the volume part of
+ *
+ *   - \nabla \cdot (A \nabla u) + c u = f
+ *
+ * for P1/Q1-type spaces on affine elements (YaspGrid, simplicial ALUGrid
+ * and UGGrid). Instead of calling a local operator once per element, W
+ * elements are gathered into one batch and the element kernel works on
+ * W lanes at once, i.e. all arithmetic in the kernel is done in innermost
+ * loops over the lanes which the compiler turns into SIMD instructions.
+ *
+ * Everything that goes through the grid interface (geometry, index
+ * mapping, parameter evaluation) is done once in the constructor and
+ * stored lane-wise; assembly afterwards only touches flat arrays. On
+ * affine elements the element stiffness matrix is
+ *
+ *   A_ij = \sum_{kl} G_kl S^{kl}_ij + \sum_q cw_q \phi_i(q) \phi_j(q)
+ *
+ * with G = |det J| J^{-1} A J^{-T} (A evaluated at the cell center, as
+ * ConvectionDiffusionFEM does) and reference tensors S^{kl} that are the
+ * same for all elements.
+ *
+ * Contributions to constrained rows and columns are dropped; they are
+ * expected to be handled by a GridOperator with BoundaryOnlyLocalOperator
+ * on the same space.
+ *
+ * \tparam GFS   scalar grid function space with flat ISTL vector backend
+ * \tparam CC    constraints container
+ * \tparam PARAM parameter class with the ConvectionDiffusion interface
+ * \tparam W     number of lanes
+ */
+template<typename GFS, typename CC, typename PARAM, int W=BATCHED_ASSEMBLY_WIDTH>
+class BatchedAssembler
+{
+  typedef typename GFS::Traits::GridViewType GV;
+  enum { dim = GV::dimension };
+  typedef typename GV::Traits::template Codim<0>::Iterator ElementIterator;
+  typedef typename GV::template Codim<0>::Geometry Geometry;
+  typedef typename GFS::Traits::FiniteElementType::
+    Traits::LocalBasisType::Traits BasisTraits;
+  typedef typename BasisTraits::DomainFieldType DF;
+  typedef typename BasisTraits::RangeFieldType RF;
+  typedef typename BasisTraits::RangeType RangeType;
+  typedef typename BasisTraits::JacobianType JacobianType;
+  typedef Dune::PDELab::LocalFunctionSpace<GFS> LFS;
+  typedef Dune::PDELab::LFSIndexCache<LFS,CC> LFSCache;
+
+  // data of one batch, stored lane-wise
+  struct Batch
+  {
+    std::vector<RF> G;              // dim*dim*W
+    std::vector<RF> cw, fw;         // nq*W
+    std::vector<std::size_t> index; // n*W
+    std::vector<RF> mask;           // n*W, 0 for constrained dofs and empty lanes
+  };
+
+public:
+  BatchedAssembler (const GFS& gfs, const CC& cc, const PARAM& param, unsigned int intorder=2)
+    : n(0), nq(0), nelements(0)
+  {
+    LFS lfs(gfs);
+    LFSCache cache(lfs,cc,false);
+    Dune::GeometryType gt;
+
+    for (ElementIterator it = gfs.gridView().template begin<0>();
+         it!=gfs.gridView().template end<0>(); ++it)
+      {
+        lfs.bind(*it);
+        cache.update();
+        const Geometry geo = it->geometry();
+
+        if (!geo.affine())
+          DUNE_THROW(Dune::NotImplemented,"BatchedAssembler needs affine elements");
+        if (nelements==0)
+          {
+            gt = geo.type();
+            n = lfs.size();
+            setupReference(lfs.finiteElement().localBasis(),gt,intorder);
+          }
+        else if (geo.type()!=gt || lfs.size()!=n)
+          DUNE_THROW(Dune::NotImplemented,"BatchedAssembler needs a grid with one element type");
+
+        // evaluate parameters and geometry at the cell center
+        const Dune::FieldVector<DF,dim>
+          center = Dune::ReferenceElements<DF,dim>::general(gt).position(0,0);
+        if (param.b(*it,center).two_norm()>0.0)
+          DUNE_THROW(Dune::NotImplemented,"BatchedAssembler does not treat convection");
+        const typename PARAM::Traits::PermTensorType A = param.A(*it,center);
+        const typename Geometry::JacobianInverseTransposed
+          jit = geo.jacobianInverseTransposed(center);
+        const RF det = geo.integrationElement(center);
+
+        // open a new batch if necessary
+        const int lane = nelements%W;
+        if (lane==0)
+          {
+            batches.push_back(Batch());
+            Batch& b = batches.back();
+            b.G.assign(dim*dim*W,0.0);
+            b.cw.assign(nq*W,0.0);
+            b.fw.assign(nq*W,0.0);
+            b.index.assign(n*W,0);
+            b.mask.assign(n*W,0.0);
+          }
+        Batch& b = batches.back();
+
+        // G = |det J| J^{-1} A J^{-T}
+        for (int k=0; k<dim; k++)
+          for (int l=0; l<dim; l++)
+            {
+              RF sum = 0.0;
+              for (int m=0; m<dim; m++)
+                for (int p=0; p<dim; p++)
+                  sum += jit[m][k]*A[m][p]*jit[p][l];
+              b.G[(k*dim+l)*W+lane] = det*sum;
+            }
+
+        // reaction and source at the quadrature points
+        for (int q=0; q<nq; q++)
+          {
+            b.cw[q*W+lane] = det*weights[q]*param.c(*it,points[q]);
+            b.fw[q*W+lane] = det*weights[q]*param.f(*it,points[q]);
+          }
+
+        // global indices
+        for (std::size_t i=0; i<n; i++)
+          {
+            b.index[i*W+lane] = cache.containerIndex(i)[0];
+            b.mask[i*W+lane] = cache.isConstrained(i) ? 0.0 : 1.0;
+          }
+
+        nelements++;
+      }
+  }
+
+  //! number of elements handled
+  std::size_t elements () const
+  {
+    return nelements;
+  }
+
+  //! add volume contributions to the residual
+  template<typename X, typename R>
+  void residual (const X& x, R& r) const
+  {
+    std::vector<RF> Aloc(n*n*W), xloc(n*W), rloc(n*W);
+    for (std::size_t bi=0; bi<batches.size(); bi++)
+      {
+        const Batch& b = batches[bi];
+        localMatrix(b,Aloc);
+
+        // gather
+        for (std::size_t j=0; j<n; j++)
+          for (int l=0; l<W; l++)
+            xloc[j*W+l] = Dune::PDELab::Backend::native(x)[b.index[j*W+l]][0];
+
+        // r = A x - f
+        for (std::size_t i=0; i<n; i++)
+          {
+            RF* ri = &rloc[i*W];
+            for (int l=0; l<W; l++) ri[l] = 0.0;
+            for (std::size_t j=0; j<n; j++)
+              {
+                const RF* aij = &Aloc[(i*n+j)*W];
+                const RF* xj = &xloc[j*W];
+                for (int l=0; l<W; l++) ri[l] += aij[l]*xj[l];
+              }
+            for (int q=0; q<nq; q++)
+              {
+                const RF p = phi[q*n+i];
+                const RF* fq = &b.fw[q*W];
+                for (int l=0; l<W; l++) ri[l] -= p*fq[l];
+              }
+          }
+
+        // scatter
+        for (std::size_t i=0; i<n; i++)
+          for (int l=0; l<W; l++)
+            if (b.mask[i*W+l]!=0.0)
+              Dune::PDELab::Backend::native(r)[b.index[i*W+l]][0] += rloc[i*W+l];
+      }
+  }
+
+  //! add volume contributions to the matrix (the problem is linear)
+  template<typename M>
+  void jacobian (M& mat) const
+  {
+    std::vector<RF> Aloc(n*n*W);
+    for (std::size_t bi=0; bi<batches.size(); bi++)
+      {
+        const Batch& b = batches[bi];
+        localMatrix(b,Aloc);
+        for (std::size_t i=0; i<n; i++)
+          for (std::size_t j=0; j<n; j++)
+            for (int l=0; l<W; l++)
+              if (b.mask[i*W+l]!=0.0 && b.mask[j*W+l]!=0.0)
+                Dune::PDELab::Backend::native(mat)[b.index[i*W+l]][b.index[j*W+l]][0][0]
+                  += Aloc[(i*n+j)*W+l];
+      }
+  }
+
+private:
+  // element matrices of all lanes of a batch
+  void localMatrix (const Batch& b, std::vector<RF>& Aloc) const
+  {
+    std::fill(Aloc.begin(),Aloc.end(),0.0);
+    for (int kl=0; kl<dim*dim; kl++)
+      {
+        const RF* g = &b.G[kl*W];
+        for (std::size_t ij=0; ij<n*n; ij++)
+          {
+            const RF s = S[kl*n*n+ij];
+            if (s==0.0) continue;
+            RF* a = &Aloc[ij*W];
+            for (int l=0; l<W; l++) a[l] += s*g[l];
+          }
+      }
+    for (int q=0; q<nq; q++)
+      {
+        const RF* c = &b.cw[q*W];
+        for (std::size_t i=0; i<n; i++)
+          for (std::size_t j=0; j<n; j++)
+            {
+              const RF p = phi[q*n+i]*phi[q*n+j];
+              RF* a = &Aloc[(i*n+j)*W];
+              for (int l=0; l<W; l++) a[l] += p*c[l];
+            }
+      }
+  }
+
+  // quadrature rule, basis values and reference stiffness tensors
+  template<typename LocalBasis>
+  void setupReference (const LocalBasis& basis, Dune::GeometryType gt, unsigned int intorder)
+  {
+    const Dune::QuadratureRule<DF,dim>& rule = Dune::QuadratureRules<DF,dim>::rule(gt,intorder);
+    nq = rule.size();
+    points.resize(nq);
+    weights.resize(nq);
+    phi.assign(nq*n,0.0);
+    S.assign(dim*dim*n*n,0.0);
+    std::vector<RangeType> values(n);
+    std::vector<JacobianType> js(n);
+    for (int q=0; q<nq; q++)
+      {
+        points[q] = rule[q].position();
+        weights[q] = rule[q].weight();
+        basis.evaluateFunction(points[q],values);
+        basis.evaluateJacobian(points[q],js);
+        for (std::size_t i=0; i<n; i++)
+          phi[q*n+i] = values[i];
+        for (int k=0; k<dim; k++)
+          for (int l=0; l<dim; l++)
+            for (std::size_t i=0; i<n; i++)
+              for (std::size_t j=0; j<n; j++)
+                S[(k*dim+l)*n*n+i*n+j] += weights[q]*js[i][0][k]*js[j][0][l];
+      }
+  }
+
+  std::size_t n;
+  int nq;
+  std::size_t nelements;
+  std::vector<Dune::FieldVector<DF,dim> > points;
+  std::vector<DF> weights;
+  std::vector<RF> phi;  // nq x n
+  std::vector<RF> S;    // dim*dim x n x n
+  std::vector<Batch> batches;
+};
+
+#endif // DUNE_PDELAB_HOWTO_BATCHEDASSEMBLER_HH
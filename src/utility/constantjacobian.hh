@@ -0,0 +1,93 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_CONSTANTJACOBIAN_HH
+#define DUNE_PDELAB_HOWTO_CONSTANTJACOBIAN_HH
+
+#include<memory>
+
+#include<dune/common/timer.hh>
+
+/** \brief Linear problem solver for one step methods that keeps the
+ *  Jacobian and the AMG hierarchy
+ *
+ * For a linear problem with time independent coefficients the Jacobian
+ * of a stage of a one step method is M + dt b_rr A. It does not change
+ * from step to step as long as dt is fixed and the diagonal coefficient
+ * b_rr is the same in all stages, i.e. for implicit Euler, theta schemes
+ * and singly diagonally implicit Runge-Kutta methods like Alexander2/3
+ * (but not for the fractional step theta scheme). In that case the
+ * solver assembles the Jacobian once and tells the AMG backend to reuse
+ * its hierarchy; afterwards a stage costs one residual assembly and one
+ * preconditioned Krylov solve.
+ *
+ * Dirichlet values may depend on time since they only enter the
+ * residual, but the set of constrained dofs must stay fixed. Call
+ * invalidate() whenever dt or the method changes. With constant=false
+ * the solver behaves like StationaryLinearProblemSolver.
+ *
+ * \tparam GO grid operator, e.g. a OneStepGridOperator
+ * \tparam LS linear solver backend providing setReuse(bool), i.e. one of
+ *            the ISTL AMG backends
+ * \tparam V  vector type
+ */
+template<typename GO, typename LS, typename V>
+class ConstantJacobianLinearSolver
+{
+  typedef typename GO::Traits::Jacobian M;
+  typedef typename GO::Traits::Range W;
+
+public:
+  ConstantJacobianLinearSolver (const GO& go_, LS& ls_, double reduction_, bool constant_=true)
+    : go(go_), ls(ls_), reduction(reduction_), constant(constant_), valid(false),
+      assemblies(0), solves(0), assembly_time(0.0), solve_time(0.0)
+  {}
+
+  //! the next call to apply assembles the Jacobian and rebuilds the preconditioner
+  void invalidate ()
+  {
+    valid = false;
+  }
+
+  //! solve the linear stage problem, x contains the Dirichlet values on entry
+  void apply (V& x)
+  {
+    Dune::Timer watch;
+    W r(go.testGridFunctionSpace(),0.0);
+    go.residual(x,r);
+    const bool reuse = constant && valid && jacobian;
+    if (!reuse)
+      {
+        if (!jacobian)
+          jacobian = std::make_shared<M>(go);
+        *jacobian = 0.0;
+        go.jacobian(x,*jacobian);
+        valid = true;
+        assemblies++;
+      }
+    assembly_time += watch.elapsed();
+
+    watch.reset();
+    ls.setReuse(reuse);
+    V z(go.trialGridFunctionSpace(),0.0);
+    ls.apply(*jacobian,z,r,reduction);
+    x -= z;
+    solves++;
+    solve_time += watch.elapsed();
+  }
+
+  //! Jacobian assemblies (including AMG setups) and solves so far
+  int jacobianAssemblies () const { return assemblies; }
+  int linearSolves () const { return solves; }
+  double assemblyTime () const { return assembly_time; }
+  double solveTime () const { return solve_time; }
+
+private:
+  const GO& go;
+  LS& ls;
+  double reduction;
+  bool constant, valid;
+  std::shared_ptr<M> jacobian;
+  int assemblies, solves;
+  double assembly_time, solve_time;
+};
+
+#endif // DUNE_PDELAB_HOWTO_CONSTANTJACOBIAN_HH
@@ -0,0 +1,504 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_EXPLICITDG_HH
+#define DUNE_PDELAB_HOWTO_EXPLICITDG_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+#include<memory>
+#include<string>
+#include<type_traits>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/grid/common/gridenums.hh>
+#include<dune/pdelab/backend/interface.hh>
+#include<dune/pdelab/gridfunctionspace/genericdatahandle.hh>
+#include<dune/pdelab/instationary/onestepparameter.hh>
+
+//! d|E|/|dE|, the length scale in the CFL condition of DG methods
+template<typename GV, typename E>
+double dg_element_size (const GV& gv, const E& e)
+{
+  typedef typename GV::IntersectionIterator IntersectionIterator;
+  double surface = 0.0;
+  for (IntersectionIterator iit=gv.ibegin(e); iit!=gv.iend(e); ++iit)
+    surface += iit->geometry().volume();
+  return GV::dimension*e.geometry().volume()/surface;
+}
+
+/** \brief stability interval on the negative real axis of the explicit
+ *  Runge-Kutta methods with s = p stages
+ *
+ * All of them have the stability polynomial of the truncated exponential
+ * series. These are ExplicitEulerParameter, HeunParameter, Shu3Parameter
+ * and RK4Parameter, for which the CFL bounds of the DG examples are set.
+ */
+inline double rk_stability_interval (int order)
+{
+  if (order<1 || order>4)
+    DUNE_THROW(Dune::Exception,"no Runge-Kutta method with s = p = " << order);
+  const double beta[4] = {2.0, 2.0, 2.5127, 2.7853};
+  return beta[order-1];
+}
+
+/** \brief Inverse of a block diagonal DG mass matrix
+ *
+ * The mass matrix is assembled once with the given grid operator and its
+ * diagonal blocks are inverted. If every block is a multiple of the
+ * identity, as for orthonormal bases on affine elements, only the scale
+ * factors are kept. Throws if the matrix has off-diagonal blocks.
+ *
+ * \tparam M matrix container type of the mass grid operator
+ */
+template<typename M>
+class DGInverseMass
+{
+  typedef typename std::decay<decltype(Dune::PDELab::Backend::native(
+    std::declval<M&>()))>::type::block_type Block;
+
+public:
+  template<typename MGO, typename V>
+  DGInverseMass (const MGO& mgo, const V& u)
+    : scalar(true)
+  {
+    using Dune::PDELab::Backend::native;
+    M mass(mgo);
+    mass = 0.0;
+    mgo.jacobian(u,mass);
+    const auto& A = native(mass);
+    minv.resize(A.N());
+    scale.resize(A.N());
+    for (auto row=A.begin(); row!=A.end(); ++row)
+      {
+        const std::size_t i = row.index();
+        for (auto col=row->begin(); col!=row->end(); ++col)
+          if (col.index()!=i && col->infinity_norm()>0.0)
+            DUNE_THROW(Dune::Exception,"mass matrix is not block diagonal");
+        minv[i] = A[i][i];
+        minv[i].invert();
+        scale[i] = scalar_factor(minv[i]);
+        if (std::isnan(scale[i])) scalar = false;
+      }
+    if (!scalar) scale.clear();
+    else minv.clear();
+  }
+
+  //! true if the inverse is a scaling per block
+  bool isScalar () const { return scalar; }
+
+  //! out = M^{-1} in
+  template<typename X, typename Y>
+  void mv (const X& in, Y& out) const
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& nin = native(in);
+    auto& nout = native(out);
+    if (scalar)
+      for (std::size_t i=0; i<scale.size(); i++)
+        {
+          nout[i] = nin[i];
+          nout[i] *= scale[i];
+        }
+    else
+      for (std::size_t i=0; i<minv.size(); i++)
+        minv[i].mv(nin[i],nout[i]);
+  }
+
+  //! out += alpha M^{-1} in
+  template<typename X, typename Y>
+  void usmv (double alpha, const X& in, Y& out) const
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& nin = native(in);
+    auto& nout = native(out);
+    if (scalar)
+      for (std::size_t i=0; i<scale.size(); i++)
+        nout[i].axpy(alpha*scale[i],nin[i]);
+    else
+      for (std::size_t i=0; i<minv.size(); i++)
+        minv[i].usmv(alpha,nin[i],nout[i]);
+  }
+
+private:
+  // s if block = s*I, NaN otherwise
+  static double scalar_factor (const Block& b)
+  {
+    const double s = b[0][0];
+    for (std::size_t i=0; i<b.N(); i++)
+      for (std::size_t j=0; j<b.M(); j++)
+        {
+          const double e = (i==j) ? b[i][j]-s : b[i][j];
+          if (std::abs(e)>1e-12*std::abs(s))
+            return std::nan("");
+        }
+    return s;
+  }
+
+  bool scalar;
+  std::vector<Block> minv;
+  std::vector<double> scale;
+};
+
+//! copy overlap values of a DG vector from their owners
+template<typename GFS, typename V>
+void dg_copy_overlap (const GFS& gfs, V& v)
+{
+  if (gfs.gridView().comm().size()>1)
+    {
+      Dune::PDELab::CopyDataHandle<GFS,V> dh(gfs,v);
+      gfs.gridView().communicate(dh,Dune::InteriorBorder_All_Interface,Dune::ForwardCommunication);
+    }
+}
+
+/** \brief Explicit Runge-Kutta method for DG discretizations with a
+ *  precomputed inverse mass matrix
+ *
+ * ExplicitOneStepMethod assembles the temporal operator in every stage
+ * and calls a linear solver, even if that is only the inverse of the
+ * block diagonal DG mass matrix. Furthermore the explicit one step grid
+ * operator recomputes the spatial residual of all previous stages in
+ * every stage. This class instead
+ *
+ *  - assembles the mass matrix once in the constructor and stores the
+ *    inverse of its diagonal blocks; if every block is a multiple of the
+ *    identity, as for orthonormal bases on affine elements, only the
+ *    scale factor is kept,
+ *  - evaluates the spatial residual once per stage and keeps it for the
+ *    following stages,
+ *  - updates the stage vectors with axpy operations; no matrix is
+ *    assembled after construction.
+ *
+ * The stage values follow the PDELab convention for a method with
+ * coefficients a, b and d:
+ *
+ *   a_rr x_r = - sum_{j<r} a_rj x_j - dt M^{-1} sum_{j<r} b_rj r(x_j, t+d_j dt)
+ *
+ * where r is the spatial residual. The mass matrix must be block
+ * diagonal and independent of time and solution. On overlapping grids
+ * the stage vectors are copied from the owner after every stage.
+ *
+ * \tparam R   time type
+ * \tparam GO  grid operator of the spatial part
+ * \tparam LOP spatial local operator, receives time and stage information
+ * \tparam TC  time controller, e.g. SimpleTimeController or CFLTimeController
+ * \tparam V   vector type
+ */
+template<typename R, typename GO, typename LOP, typename TC, typename V>
+class ExplicitDGRungeKutta
+{
+  typedef typename GO::Traits::Range W;
+  typedef typename GO::Traits::TrialGridFunctionSpace GFS;
+
+public:
+  template<typename MGO>
+  ExplicitDGRungeKutta (const Dune::PDELab::TimeSteppingParameterInterface<R>& method_,
+                        const GO& go_, LOP& lop_, const MGO& mgo, TC& tc_)
+    : method(&method_), go(go_), lop(lop_), tc(tc_), verbosity(1),
+      minv(mgo,V(go_.trialGridFunctionSpace(),0.0)), stages(0), residual_time(0.0), update_time(0.0)
+  {
+    if (method->implicit())
+      DUNE_THROW(Dune::Exception,"explicit Runge-Kutta engine needs an explicit method");
+    allocate();
+  }
+
+  //! change the method, takes effect with the next step
+  void setMethod (const Dune::PDELab::TimeSteppingParameterInterface<R>& method_)
+  {
+    if (method_.implicit())
+      DUNE_THROW(Dune::Exception,"explicit Runge-Kutta engine needs an explicit method");
+    method = &method_;
+    allocate();
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! true if the inverse mass matrix is a scaling per block
+  bool scalarMass () const { return minv.isScalar(); }
+
+  //! do one step from time to time+dt; returns the step size actually taken
+  R apply (R time, R dt, const V& xold, V& xnew)
+  {
+    const int s = method->s();
+
+    if (verbosity>=1 && go.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [" << method->name() << "] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+
+    lop.preStep(time,dt,s);
+    Dune::Timer watch;
+    for (int r=1; r<=s; r++)
+      {
+        // spatial residual of the previous stage, computed only once
+        watch.reset();
+        const V& xprev = (r==1) ? xold : *x[r-2];
+        lop.setTime(time+method->d(r-1)*dt);
+        lop.preStage(time+method->d(r)*dt,r);
+        *res[r-1] = 0.0;
+        go.residual(xprev,*res[r-1]);
+        residual_time += watch.elapsed();
+        if (r==1)
+          dt = tc.suggestTimestep(time,dt);
+
+        // combine stages and apply the inverse mass
+        watch.reset();
+        V& xr = (r==s) ? xnew : *x[r-1];
+        *sum = 0.0;
+        for (int j=0; j<r; j++)
+          if (method->b(r,j)!=0.0)
+            sum->axpy(method->b(r,j),*res[j]);
+        minv.mv(*sum,xr);
+        xr *= -dt;
+        for (int j=0; j<r; j++)
+          if (method->a(r,j)!=0.0)
+            xr.axpy(-method->a(r,j), (j==0) ? xold : *x[j-1]);
+        xr *= 1.0/method->a(r,r);
+        dg_copy_overlap(go.trialGridFunctionSpace(),xr);
+        update_time += watch.elapsed();
+        lop.postStage();
+        stages++;
+      }
+    lop.postStep();
+    return dt;
+  }
+
+  //! statistics for throughput measurements
+  int stageCount () const { return stages; }
+  double residualTime () const { return residual_time; }
+  double updateTime () const { return update_time; }
+
+  //! number of state sized vectors kept besides xold and xnew
+  int storage () const { return x.size()+res.size()+1; }
+
+private:
+  //! s-1 intermediate stages, s residuals and their sum
+  void allocate ()
+  {
+    const int s = method->s();
+    for (int r=x.size(); r<s-1; r++)
+      x.push_back(std::make_shared<V>(go.trialGridFunctionSpace(),0.0));
+    for (int r=res.size(); r<s; r++)
+      res.push_back(std::make_shared<W>(go.testGridFunctionSpace(),0.0));
+    if (!sum)
+      sum = std::make_shared<W>(go.testGridFunctionSpace(),0.0);
+  }
+
+  const Dune::PDELab::TimeSteppingParameterInterface<R>* method;
+  const GO& go;
+  LOP& lop;
+  TC& tc;
+  int verbosity;
+  DGInverseMass<typename GO::Traits::Jacobian> minv;
+  std::vector<std::shared_ptr<V> > x;
+  std::vector<std::shared_ptr<W> > res;
+  std::shared_ptr<W> sum;
+  int stages;
+  double residual_time, update_time;
+};
+
+/** \brief Coefficients of a 2N-storage Runge-Kutta method
+ *
+ * Williamson's form of a low storage method with s stages is
+ *
+ *   du  = A_i du + dt L(u, t + c_i dt)
+ *   u   = u + B_i du,        i = 0,...,s-1, A_0 = 0,
+ *
+ * so besides the solution only the increment du has to be stored,
+ * independent of the number of stages.
+ */
+template<typename R>
+class LowStorageRKParameter
+{
+public:
+  int s () const { return A_.size(); }
+  int order () const { return order_; }
+  R A (int i) const { return A_[i]; }
+  R B (int i) const { return B_[i]; }
+  R c (int i) const { return c_[i]; }
+  std::string name () const { return name_; }
+
+protected:
+  std::vector<R> A_, B_, c_;
+  int order_;
+  std::string name_;
+};
+
+//! Williamson's three stage third order method (J. Comput. Phys. 35, 1980)
+template<typename R>
+class Williamson3Parameter : public LowStorageRKParameter<R>
+{
+public:
+  Williamson3Parameter ()
+  {
+    this->A_ = {0.0, -5.0/9.0, -153.0/128.0};
+    this->B_ = {1.0/3.0, 15.0/16.0, 8.0/15.0};
+    this->c_ = {0.0, 1.0/3.0, 3.0/4.0};
+    this->order_ = 3;
+    this->name_ = "low storage Williamson 3";
+  }
+};
+
+//! five stage fourth order method of Carpenter and Kennedy (NASA TM-109112, 1994)
+template<typename R>
+class CarpenterKennedy4Parameter : public LowStorageRKParameter<R>
+{
+public:
+  CarpenterKennedy4Parameter ()
+  {
+    this->A_ = {0.0,
+                -567301805773.0/1357537059087.0,
+                -2404267990393.0/2016746695238.0,
+                -3550918686646.0/2091501179385.0,
+                -1275806237668.0/842570457699.0};
+    this->B_ = {1432997174477.0/9575080441755.0,
+                5161836677717.0/13612068292357.0,
+                1720146321549.0/2090206949498.0,
+                3134564353537.0/4481467310338.0,
+                2277821191437.0/14882151754819.0};
+    this->c_ = {0.0,
+                1432997174477.0/9575080441755.0,
+                2526269341429.0/6820363962896.0,
+                2006345519317.0/3224310063776.0,
+                2802321613138.0/2924317926251.0};
+    this->order_ = 4;
+    this->name_ = "low storage Carpenter-Kennedy 4";
+  }
+};
+
+/** \brief six stage fourth order method with optimized dispersion and
+ *  dissipation, RK46-NL of Berland, Bogey and Bailly (Computers & Fluids 35, 2006)
+ *
+ * The additional stage enlarges the stability region along the
+ * imaginary axis, which matters for the purely hyperbolic wave problems.
+ */
+template<typename R>
+class BerlandRK46Parameter : public LowStorageRKParameter<R>
+{
+public:
+  BerlandRK46Parameter ()
+  {
+    this->A_ = {0.0, -0.737101392796, -1.634740794341,
+                -0.744739003780, -1.469897351522, -2.813971388035};
+    this->B_ = {0.032918605146, 0.823256998200, 0.381530948900,
+                0.200092213184, 1.718581042715, 0.27};
+    this->c_ = {0.0, 0.032918605146, 0.249351723343,
+                0.466911705055, 0.582030414044, 0.847252983783};
+    this->order_ = 4;
+    this->name_ = "low storage RK46-NL";
+  }
+};
+
+/** \brief 2N-storage explicit Runge-Kutta method for DG discretizations
+ *
+ * Uses the same precomputed inverse mass matrix as ExplicitDGRungeKutta.
+ * The solution is advanced in place in xnew; apart from it only the
+ * increment du and the residual of the current stage are stored, for
+ * any number of stages.
+ *
+ * \tparam R   time type
+ * \tparam GO  grid operator of the spatial part
+ * \tparam LOP spatial local operator, receives time and stage information
+ * \tparam TC  time controller
+ * \tparam V   vector type
+ */
+template<typename R, typename GO, typename LOP, typename TC, typename V>
+class LowStorageDGRungeKutta
+{
+  typedef typename GO::Traits::Range W;
+
+public:
+  template<typename MGO>
+  LowStorageDGRungeKutta (const LowStorageRKParameter<R>& method_,
+                          const GO& go_, LOP& lop_, const MGO& mgo, TC& tc_)
+    : method(&method_), go(go_), lop(lop_), tc(tc_), verbosity(1),
+      minv(mgo,V(go_.trialGridFunctionSpace(),0.0)),
+      du(go_.trialGridFunctionSpace(),0.0), res(go_.testGridFunctionSpace(),0.0),
+      stages(0)
+  {}
+
+  //! change the method, takes effect with the next step
+  void setMethod (const LowStorageRKParameter<R>& method_)
+  {
+    method = &method_;
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! do one step from time to time+dt; returns the step size actually taken
+  R apply (R time, R dt, const V& xold, V& xnew)
+  {
+    const int s = method->s();
+    if (verbosity>=1 && go.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [" << method->name() << "] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+
+    xnew = xold;
+    du = 0.0;
+    lop.preStep(time,dt,s);
+    for (int i=0; i<s; i++)
+      {
+        const R t = time+method->c(i)*dt;
+        lop.setTime(t);
+        lop.preStage(t,i+1);
+        res = 0.0;
+        go.residual(xnew,res);
+        if (i==0)
+          dt = tc.suggestTimestep(time,dt);
+
+        // L(u) = -M^{-1} r(u)
+        du *= method->A(i);
+        minv.usmv(-dt,res,du);
+        xnew.axpy(method->B(i),du);
+        dg_copy_overlap(go.trialGridFunctionSpace(),xnew);
+        lop.postStage();
+        stages++;
+      }
+    lop.postStep();
+    return dt;
+  }
+
+  int stageCount () const { return stages; }
+
+  //! number of state sized vectors kept besides xold and xnew
+  int storage () const { return 2; }
+
+private:
+  const LowStorageRKParameter<R>* method;
+  const GO& go;
+  LOP& lop;
+  TC& tc;
+  int verbosity;
+  DGInverseMass<typename GO::Traits::Jacobian> minv;
+  V du;
+  W res;
+  int stages;
+};
+
+/** \brief integrate from t0 to t1 with step size dt (the last step is
+ *  shortened) using one of the explicit DG engines
+ */
+template<typename Engine, typename R, typename V>
+void dg_integrate (Engine& engine, R t0, R t1, R dt, const V& x0, V& x)
+{
+  V y(x0);
+  x = x0;
+  R t = t0;
+  while (t<t1-1e-10*dt)
+    {
+      const R h = engine.apply(t,std::min(dt,t1-t),x,y);
+      x = y;
+      t += h;
+    }
+}
+
+#endif // DUNE_PDELAB_HOWTO_EXPLICITDG_HH
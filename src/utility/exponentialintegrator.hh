@@ -0,0 +1,291 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_EXPONENTIALINTEGRATOR_HH
+#define DUNE_PDELAB_HOWTO_EXPONENTIALINTEGRATOR_HH
+
+#include<algorithm>
+#include<array>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+#include<memory>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/pdelab/backend/interface.hh>
+
+/** \brief exponential of a small dense matrix, stored row-wise
+ *
+ * Scaling and squaring with a Taylor polynomial of degree 16 on the
+ * matrix scaled to norm at most 1/2.
+ */
+inline std::vector<double> dense_expm (const std::vector<double>& A, int n)
+{
+  double norm = 0.0;
+  for (int j=0; j<n; j++)
+    {
+      double column = 0.0;
+      for (int i=0; i<n; i++)
+        column += std::abs(A[i*n+j]);
+      norm = std::max(norm,column);
+    }
+  int squarings = 0;
+  if (norm>0.5)
+    squarings = int(std::ceil(std::log2(norm/0.5)));
+  const double scale = std::ldexp(1.0,-squarings);
+
+  std::vector<double> E(n*n,0.0), T(n*n);
+  for (int i=0; i<n; i++) E[i*n+i] = 1.0;
+  for (int k=16; k>=1; k--)
+    {
+      // E = I + (scale A / k) E
+      for (int i=0; i<n; i++)
+        for (int j=0; j<n; j++)
+          {
+            double sum = 0.0;
+            for (int l=0; l<n; l++)
+              sum += A[i*n+l]*E[l*n+j];
+            T[i*n+j] = scale*sum/k + ((i==j) ? 1.0 : 0.0);
+          }
+      E.swap(T);
+    }
+  for (int s=0; s<squarings; s++)
+    {
+      for (int i=0; i<n; i++)
+        for (int j=0; j<n; j++)
+          {
+            double sum = 0.0;
+            for (int l=0; l<n; l++)
+              sum += E[i*n+l]*E[l*n+j];
+            T[i*n+j] = sum;
+          }
+      E.swap(T);
+    }
+  return E;
+}
+
+/** \brief Krylov exponential Rosenbrock-Euler method
+ *
+ * For M u' + r(u,t) = 0 with spatial residual r one step reads
+ *
+ *   u_{n+1} = u_n + h phi_1(h J) F(u_n,t_n) + h^2 phi_2(h J) F_t
+ *
+ * with F = -M^{-1} r, its Jacobian J = -M^{-1} dr/du at u_n and the
+ * secant F_t = (F(u_n,t_n+h) - F(u_n,t_n))/h of the explicit time
+ * dependence. For a linear operator and a source that is linear in time
+ * on the step this is exact; in general it is of second order. There is
+ * no stability restriction on h.
+ *
+ * Both phi functions are obtained from one Krylov space by applying
+ * exp(h A) to (0,0,1) with the augmented matrix
+ *
+ *   A = [ J  F_t  F ]
+ *       [ 0   0   1 ]
+ *       [ 0   0   0 ]
+ *
+ * (Al-Mohy and Higham, SIAM J. Sci. Comput. 33, 2011). The Arnoldi
+ * process stops when the usual a posteriori estimate is below the
+ * tolerance; if maxdim vectors do not suffice the step is split.
+ *
+ * The mass matrix is assembled once and inverted with the linear solver
+ * backend, e.g. CG with SSOR. The Jacobian is assembled once if the
+ * problem is linear and in every step otherwise. Dirichlet values must
+ * not depend on time; constrained dofs keep their values.
+ *
+ * \tparam GO  grid operator of the spatial part
+ * \tparam MGO grid operator of the mass matrix
+ * \tparam LOP spatial local operator, receives the time
+ * \tparam LS  linear solver backend for the mass matrix
+ * \tparam V   vector type
+ */
+template<typename GO, typename MGO, typename LOP, typename LS, typename V>
+class ExponentialRosenbrockEuler
+{
+  typedef typename GO::Traits::Jacobian M;
+  typedef typename GO::Traits::Range W;
+
+  // a vector of the augmented system
+  struct AugmentedVector
+  {
+    AugmentedVector (const V& v) : x(v) { eta[0] = eta[1] = 0.0; }
+    V x;
+    std::array<double,2> eta;
+  };
+
+public:
+  ExponentialRosenbrockEuler (const GO& go_, const MGO& mgo, LOP& lop_, LS& ls_, bool linear_=true)
+    : go(go_), lop(lop_), ls(ls_), linear(linear_), maxdim(40), tol(1e-8), verbosity(1),
+      mass(mgo), f(go_.trialGridFunctionSpace(),0.0), ft(go_.trialGridFunctionSpace(),0.0),
+      steps(0), dimensions(0), mass_solves(0), krylov_time(0.0), assembly_time(0.0)
+  {
+    V x(go.trialGridFunctionSpace(),0.0);
+    mass = 0.0;
+    mgo.jacobian(x,mass);
+  }
+
+  //! maximal Krylov dimension and relative tolerance of the Krylov approximation
+  void setKrylovParameters (int maxdim_, double tol_)
+  {
+    maxdim = maxdim_;
+    tol = tol_;
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! do one step from time to time+dt
+  void apply (double time, double dt, const V& xold, V& xnew)
+  {
+    if (verbosity>=1 && go.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [exponential Rosenbrock-Euler] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+    xnew = xold;
+    step(time,dt,xnew,0);
+  }
+
+  //! statistics
+  int stepCount () const { return steps; }
+  double averageKrylovDimension () const { return double(dimensions)/std::max(steps,1); }
+  int massSolves () const { return mass_solves; }
+  double krylovTime () const { return krylov_time; }
+  double assemblyTime () const { return assembly_time; }
+
+private:
+  //! advance x from t by h, split the step if the Krylov space is too small
+  void step (double t, double h, V& x, int depth)
+  {
+    if (depth>20)
+      DUNE_THROW(Dune::Exception,"Krylov approximation of the exponential does not converge");
+
+    // Jacobian, and F and its time secant at x
+    Dune::Timer watch;
+    if (!linear || !jacobian)
+      {
+        if (!jacobian)
+          jacobian = std::make_shared<M>(go);
+        *jacobian = 0.0;
+        go.jacobian(x,*jacobian);
+      }
+    W r0(go.testGridFunctionSpace(),0.0), r1(go.testGridFunctionSpace(),0.0);
+    lop.setTime(t);
+    go.residual(x,r0);
+    lop.setTime(t+h);
+    go.residual(x,r1);
+    r1 -= r0;
+    r1 *= 1.0/h;
+    assembly_time += watch.elapsed();
+    applyInverseMass(r0,f);
+    f *= -1.0;
+    applyInverseMass(r1,ft);
+    ft *= -1.0;
+
+    // Arnoldi process for the augmented matrix, starting with (0,0,1)
+    watch.reset();
+    std::vector<std::shared_ptr<AugmentedVector> > basis;
+    basis.push_back(std::make_shared<AugmentedVector>(V(go.trialGridFunctionSpace(),0.0)));
+    basis[0]->eta[1] = 1.0;
+    std::vector<double> H((maxdim+1)*(maxdim+1),0.0);
+    const double scale = std::max(x.two_norm(),h*f.two_norm());
+    int m = 0;
+    bool converged = false;
+    std::vector<double> E;
+    while (m<maxdim && !converged)
+      {
+        std::shared_ptr<AugmentedVector> w = std::make_shared<AugmentedVector>(x);
+        multiply(*basis[m],*w);
+        for (int i=0; i<=m; i++)
+          {
+            const double hij = dot(*basis[i],*w);
+            H[i*(maxdim+1)+m] = hij;
+            axpy(-hij,*basis[i],*w);
+          }
+        const double beta = std::sqrt(dot(*w,*w));
+        H[(m+1)*(maxdim+1)+m] = beta;
+        m++;
+
+        // exp of h times the (m+1)x(m+1) matrix with the subdiagonal entry
+        // h_{m+1,m}; its entry (m+1,1) estimates the error
+        std::vector<double> A((m+1)*(m+1),0.0);
+        for (int i=0; i<=m; i++)
+          for (int j=0; j<m; j++)
+            A[i*(m+1)+j] = h*H[i*(maxdim+1)+j];
+        E = dense_expm(A,m+1);
+        const double error = std::abs(E[m*(m+1)]);
+        converged = (error<=tol*std::max(scale,1e-300)) || (beta<=1e-12*std::max(scale,1e-300));
+        if (!converged && m<maxdim)
+          {
+            w->x *= 1.0/beta;
+            w->eta[0] /= beta;
+            w->eta[1] /= beta;
+            basis.push_back(w);
+          }
+      }
+    krylov_time += watch.elapsed();
+
+    if (!converged)
+      {
+        step(t,0.5*h,x,depth+1);
+        step(t+0.5*h,0.5*h,x,depth+1);
+        return;
+      }
+
+    // x += V_m exp(h H_m) e_1; the first m entries of the first column of
+    // the augmented exponential equal exp(h H_m) e_1
+    for (int i=0; i<m; i++)
+      x.axpy(E[i*(m+1)],basis[i]->x);
+    steps++;
+    dimensions += m;
+  }
+
+  //! w = A v for the augmented matrix
+  void multiply (const AugmentedVector& v, AugmentedVector& w)
+  {
+    W r(go.testGridFunctionSpace(),0.0);
+    Dune::PDELab::Backend::native(*jacobian).mv(Dune::PDELab::Backend::native(v.x),
+                                                Dune::PDELab::Backend::native(r));
+    applyInverseMass(r,w.x);
+    w.x *= -1.0;
+    w.x.axpy(v.eta[0],ft);
+    w.x.axpy(v.eta[1],f);
+    w.eta[0] = v.eta[1];
+    w.eta[1] = 0.0;
+  }
+
+  void applyInverseMass (W& r, V& z)
+  {
+    z = 0.0;
+    W rhs(r);
+    ls.apply(mass,z,rhs,1e-12);
+    mass_solves++;
+  }
+
+  static double dot (const AugmentedVector& a, const AugmentedVector& b)
+  {
+    return a.x.dot(b.x) + a.eta[0]*b.eta[0] + a.eta[1]*b.eta[1];
+  }
+
+  static void axpy (double alpha, const AugmentedVector& a, AugmentedVector& b)
+  {
+    b.x.axpy(alpha,a.x);
+    b.eta[0] += alpha*a.eta[0];
+    b.eta[1] += alpha*a.eta[1];
+  }
+
+  const GO& go;
+  LOP& lop;
+  LS& ls;
+  bool linear;
+  int maxdim;
+  double tol;
+  int verbosity;
+  typename MGO::Traits::Jacobian mass;
+  std::shared_ptr<M> jacobian;
+  V f, ft;
+  int steps, dimensions, mass_solves;
+  double krylov_time, assembly_time;
+};
+
+#endif // DUNE_PDELAB_HOWTO_EXPONENTIALINTEGRATOR_HH
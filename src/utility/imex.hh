@@ -0,0 +1,363 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_IMEX_HH
+#define DUNE_PDELAB_HOWTO_IMEX_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+#include<memory>
+#include<string>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/pdelab/backend/interface.hh>
+
+#include"explicitdg.hh"
+
+/** \brief Coefficients of an additive implicit-explicit Runge-Kutta method
+ *
+ * For M u' = f_E(u) + f_I(u) the stages are
+ *
+ *   M U_i = M u_n + dt sum_{j<i} ahat_ij f_E(U_j) + dt sum_{j<=i} a_ij f_I(U_j)
+ *
+ * with U_0 = u_n. Only methods with a_00 = 0, the same diagonal entry
+ * gamma in all other stages and u_{n+1} = U_{s-1} (globally stiffly
+ * accurate) are represented, so every stage solves a linear system with
+ * the same matrix M + dt gamma A if f_I = -A u is linear. beta is the
+ * stability interval of the explicit part on the negative real axis.
+ */
+template<typename R>
+class IMEXParameter
+{
+public:
+  int s () const { return c_.size(); }
+  R ahat (int i, int j) const { return ahat_[i][j]; }
+  R a (int i, int j) const { return a_[i][j]; }
+  R c (int i) const { return c_[i]; }
+  R gamma () const { return a_[1][1]; }
+  R beta () const { return beta_; }
+  int order () const { return order_; }
+  std::string name () const { return name_; }
+
+protected:
+  std::vector<std::vector<R> > ahat_, a_;
+  std::vector<R> c_;
+  R beta_;
+  int order_;
+  std::string name_;
+};
+
+//! forward-backward Euler, ARS(1,1,1)
+template<typename R>
+class ARS111Parameter : public IMEXParameter<R>
+{
+public:
+  ARS111Parameter ()
+  {
+    this->ahat_ = {{0.0,0.0},{1.0,0.0}};
+    this->a_    = {{0.0,0.0},{0.0,1.0}};
+    this->c_    = {0.0,1.0};
+    this->beta_ = 2.0;
+    this->order_ = 1;
+    this->name_ = "IMEX ARS(1,1,1)";
+  }
+};
+
+//! second order ARS(2,2,2) of Ascher, Ruuth and Spiteri (Appl. Numer. Math. 25, 1997)
+template<typename R>
+class ARS222Parameter : public IMEXParameter<R>
+{
+public:
+  ARS222Parameter ()
+  {
+    const R g = 1.0-1.0/std::sqrt(2.0);
+    const R d = 1.0-1.0/(2.0*g);
+    this->ahat_ = {{0.0,0.0,0.0},{g,0.0,0.0},{d,1.0-d,0.0}};
+    this->a_    = {{0.0,0.0,0.0},{0.0,g,0.0},{0.0,1.0-g,g}};
+    this->c_    = {0.0,g,1.0};
+    this->beta_ = 2.0;
+    this->order_ = 2;
+    this->name_ = "IMEX ARS(2,2,2)";
+  }
+};
+
+//! third order ARS(4,4,3) of Ascher, Ruuth and Spiteri
+template<typename R>
+class ARS443Parameter : public IMEXParameter<R>
+{
+public:
+  ARS443Parameter ()
+  {
+    this->ahat_ = {{0.0,0.0,0.0,0.0,0.0},
+                   {1.0/2.0,0.0,0.0,0.0,0.0},
+                   {11.0/18.0,1.0/18.0,0.0,0.0,0.0},
+                   {5.0/6.0,-5.0/6.0,1.0/2.0,0.0,0.0},
+                   {1.0/4.0,7.0/4.0,3.0/4.0,-7.0/4.0,0.0}};
+    this->a_    = {{0.0,0.0,0.0,0.0,0.0},
+                   {0.0,1.0/2.0,0.0,0.0,0.0},
+                   {0.0,1.0/6.0,1.0/2.0,0.0,0.0},
+                   {0.0,-1.0/2.0,1.0/2.0,1.0/2.0,0.0},
+                   {0.0,3.0/2.0,-3.0/2.0,1.0/2.0,1.0/2.0}};
+    this->c_    = {0.0,1.0/2.0,2.0/3.0,1.0/2.0,1.0};
+    this->beta_ = 2.1;
+    this->order_ = 3;
+    this->name_ = "IMEX ARS(4,4,3)";
+  }
+};
+
+/** \brief IMEX Runge-Kutta method with linear implicit part
+ *
+ * The implicit part is given by a grid operator with a linear residual
+ * r_I(u) = A u, e.g. diffusion, and the explicit part by a grid operator
+ * with residual r_E(u) = -f_E(u), e.g. the reaction terms. The mass
+ * matrix M and A are assembled once in the constructor; the stage matrix
+ * M + dt gamma A is formed by adding the two and the AMG hierarchy of
+ * the linear solver backend is reused as long as dt does not change.
+ * No Newton iteration is needed: each stage is one linear solve for
+ * the correction of the previous stage value.
+ *
+ * The explicit part limits the step size to dt rho <= beta, where rho is
+ * the spectral radius of M_L^{-1} dr_E/du with the lumped mass matrix
+ * M_L. It is estimated with a few warm started power iterations using
+ * residual differences.
+ *
+ * \tparam GOI grid operator of the linear implicit part
+ * \tparam GOE grid operator of the explicit part
+ * \tparam GOM grid operator of the mass matrix
+ * \tparam LS  linear solver backend providing setReuse(bool), i.e. an AMG backend
+ * \tparam V   vector type
+ */
+template<typename GOI, typename GOE, typename GOM, typename LS, typename V>
+class IMEXRungeKutta
+{
+  typedef typename GOI::Traits::Jacobian M;
+  typedef typename GOI::Traits::Range W;
+  typedef double R;
+
+public:
+  IMEXRungeKutta (const IMEXParameter<R>& method_, const GOI& goi_, const GOE& goe_,
+                  const GOM& gom_, LS& ls_, R reduction_=1e-8)
+    : method(&method_), goi(goi_), goe(goe_), gom(gom_), ls(ls_), reduction(reduction_),
+      verbosity(1), mass(goi_), stiffness(goi_), K(goi_), dtK(-1.0),
+      minv(goi_.trialGridFunctionSpace(),0.0), v(goi_.trialGridFunctionSpace(),0.0),
+      rho(0.0), setups(0), solves(0), solve_time(0.0), residual_time(0.0)
+  {
+    using Dune::PDELab::Backend::native;
+    check(*method);
+    V x(goi.trialGridFunctionSpace(),0.0);
+    mass = 0.0;
+    gom.jacobian(x,mass);
+    stiffness = 0.0;
+    goi.jacobian(x,stiffness);
+
+    // lumped mass from the residual of the mass operator at 1
+    V one(goi.trialGridFunctionSpace(),1.0);
+    W m(goi.testGridFunctionSpace(),0.0);
+    gom.residual(one,m);
+    auto& nm = native(minv);
+    const auto& nmass = native(m);
+    for (std::size_t i=0; i<nm.N(); i++)
+      for (std::size_t k=0; k<nm[i].N(); k++)
+        nm[i][k] = (nmass[i][k]!=0.0) ? 1.0/nmass[i][k] : 0.0;
+
+    // start vector of the power iteration
+    auto& nv = native(v);
+    std::size_t n = 0;
+    for (std::size_t i=0; i<nv.N(); i++)
+      for (std::size_t k=0; k<nv[i].N(); k++)
+        nv[i][k] = std::sin(1.0+(n++));
+  }
+
+  //! change the method, takes effect with the next step
+  void setMethod (const IMEXParameter<R>& method_)
+  {
+    check(method_);
+    if (method_.gamma()!=method->gamma())
+      dtK = -1.0;
+    method = &method_;
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! spectral radius of the explicit part at u, iterations warm start from the last call
+  R estimateSpectralRadius (const V& u, int iterations=5)
+  {
+    using Dune::PDELab::Backend::native;
+    Dune::Timer watch;
+    const auto& comm = goe.trialGridFunctionSpace().gridView().comm();
+    W r0(goe.testGridFunctionSpace(),0.0), r(goe.testGridFunctionSpace(),0.0);
+    goe.residual(u,r0);
+    const R eps = 1e-6*std::max(1.0,comm.max(u.infinity_norm()));
+    V x(u);
+    for (int k=0; k<iterations; k++)
+      {
+        const R norm = comm.max(v.infinity_norm());
+        if (norm==0.0)
+          break;
+        v *= eps/norm;
+        x = u;
+        x += v;
+        r = 0.0;
+        goe.residual(x,r);
+        r -= r0;
+        scale(r,v);
+        dg_copy_overlap(goe.trialGridFunctionSpace(),v);
+        rho = comm.max(v.infinity_norm())/eps;
+      }
+    residual_time += watch.elapsed();
+    return rho;
+  }
+
+  /** \brief next step size: grow by 1.1 up to dtmax within the stability limit
+   *
+   * If dt exceeds 0.9 beta/rho it is cut to 0.7 beta/rho; otherwise it is
+   * only increased if the increased step is still below 0.9 beta/rho, so
+   * that the stage matrix is not rebuilt in every step.
+   */
+  R suggestTimestep (const V& u, R dt, R dtmax)
+  {
+    const R r = estimateSpectralRadius(u);
+    const R limit = (r>0.0) ? method->beta()/r : dtmax;
+    if (dt>0.9*limit)
+      return 0.7*limit;
+    const R grown = std::min(1.1*dt,dtmax);
+    return (grown<=0.9*limit) ? grown : dt;
+  }
+
+  //! do one step from time to time+dt
+  void apply (R time, R dt, const V& xold, V& xnew)
+  {
+    const int s = method->s();
+    const R gamma = method->gamma();
+    if (verbosity>=1 && goi.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [" << method->name() << "] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+
+    // stage matrix M + dt gamma A
+    const bool reuse = (dt==dtK);
+    if (!reuse)
+      {
+        using Dune::PDELab::Backend::native;
+        K = mass;
+        auto& nK = native(K);
+        const auto& nA = native(stiffness);
+        for (auto row=nA.begin(); row!=nA.end(); ++row)
+          for (auto col=row->begin(); col!=row->end(); ++col)
+            nK[row.index()][col.index()].axpy(dt*gamma,*col);
+        dtK = dt;
+        setups++;
+      }
+
+    while (int(fE.size())<s)
+      {
+        fE.push_back(std::make_shared<W>(goi.testGridFunctionSpace(),0.0));
+        fI.push_back(std::make_shared<W>(goi.testGridFunctionSpace(),0.0));
+      }
+
+    Dune::Timer watch;
+    W mxold(goi.testGridFunctionSpace(),0.0);
+    gom.residual(xold,mxold);
+    evaluate(xold,0);
+    residual_time += watch.elapsed();
+
+    W rho_(goi.testGridFunctionSpace(),0.0), tmp(goi.testGridFunctionSpace(),0.0);
+    V z(goi.trialGridFunctionSpace(),0.0);
+    xnew = xold;
+    for (int i=1; i<s; i++)
+      {
+        // residual of stage i at the previous stage value
+        watch.reset();
+        rho_ = 0.0;
+        gom.residual(xnew,rho_);
+        rho_ -= mxold;
+        tmp = 0.0;
+        goi.residual(xnew,tmp);
+        rho_.axpy(dt*gamma,tmp);
+        for (int j=0; j<i; j++)
+          {
+            if (method->ahat(i,j)!=0.0)
+              rho_.axpy(-dt*method->ahat(i,j),*fE[j]);
+            if (method->a(i,j)!=0.0)
+              rho_.axpy(-dt*method->a(i,j),*fI[j]);
+          }
+        residual_time += watch.elapsed();
+
+        // one linear solve for the correction
+        watch.reset();
+        ls.setReuse(reuse || i>1);
+        z = 0.0;
+        ls.apply(K,z,rho_,reduction);
+        xnew -= z;
+        dg_copy_overlap(goi.trialGridFunctionSpace(),xnew);
+        solves++;
+        solve_time += watch.elapsed();
+
+        // right hand sides of the following stages
+        if (i<s-1)
+          {
+            watch.reset();
+            evaluate(xnew,i);
+            residual_time += watch.elapsed();
+          }
+      }
+  }
+
+  //! statistics
+  int matrixSetups () const { return setups; }
+  int linearSolves () const { return solves; }
+  double solveTime () const { return solve_time; }
+  double residualTime () const { return residual_time; }
+
+private:
+  static void check (const IMEXParameter<R>& method)
+  {
+    for (int i=1; i<method.s(); i++)
+      if (method.a(i,i)!=method.gamma())
+        DUNE_THROW(Dune::Exception,method.name() << " has different diagonal entries");
+  }
+
+  //! f_E(U_i) and f_I(U_i) as residual vectors
+  void evaluate (const V& u, int i)
+  {
+    *fE[i] = 0.0;
+    goe.residual(u,*fE[i]);
+    *fE[i] *= -1.0;
+    *fI[i] = 0.0;
+    goi.residual(u,*fI[i]);
+    *fI[i] *= -1.0;
+  }
+
+  void scale (const W& r, V& f) const
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& nr = native(r);
+    const auto& nm = native(minv);
+    auto& nf = native(f);
+    for (std::size_t i=0; i<nf.N(); i++)
+      for (std::size_t k=0; k<nf[i].N(); k++)
+        nf[i][k] = nm[i][k]*nr[i][k];
+  }
+
+  const IMEXParameter<R>* method;
+  const GOI& goi;
+  const GOE& goe;
+  const GOM& gom;
+  LS& ls;
+  R reduction;
+  int verbosity;
+  M mass, stiffness, K;
+  R dtK;
+  V minv, v;
+  R rho;
+  std::vector<std::shared_ptr<W> > fE, fI;
+  int setups, solves;
+  double solve_time, residual_time;
+};
+
+#endif // DUNE_PDELAB_HOWTO_IMEX_HH
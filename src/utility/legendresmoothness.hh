@@ -0,0 +1,149 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_LEGENDRESMOOTHNESS_HH
+#define DUNE_PDELAB_HOWTO_LEGENDRESMOOTHNESS_HH
+
+#include<algorithm>
+#include<cmath>
+#include<vector>
+
+#include<dune/common/fvector.hh>
+#include<dune/geometry/type.hh>
+#include<dune/geometry/quadraturerules.hh>
+
+/** \brief Estimate local smoothness of a grid function from the decay of
+ *  its Legendre coefficients
+ *
+ * On a cube element the function is expanded in tensor products of
+ * Legendre polynomials on the reference element,
+ *
+ *   u = \sum_\alpha a_\alpha L_{\alpha_1}(\hat x_1) ... L_{\alpha_d}(\hat x_d),
+ *
+ * and the coefficients are collected in shells m = max_i \alpha_i:
+ *
+ *   b_m^2 = \sum_{max \alpha = m} a_\alpha^2 \prod_i 1/(2\alpha_i+1).
+ *
+ * A least squares fit of log b_m = c - \sigma m for m = 1,...,p gives the
+ * decay rate \sigma. A large \sigma indicates a locally analytic function
+ * where increasing the polynomial degree pays off; a small \sigma means
+ * the function is not resolved (e.g. near a singularity) and the element
+ * should rather be refined.
+ *
+ * The norm b_p of the highest shell estimates the error of the degree p
+ * approximation on the element and serves as indicator for p-adaptivity.
+ *
+ * \tparam GF grid function on a grid with cube elements
+ */
+template<typename GF>
+class LegendreSmoothnessIndicator
+{
+  typedef typename GF::Traits::DomainFieldType DF;
+  typedef typename GF::Traits::RangeFieldType RF;
+  typedef typename GF::Traits::RangeType RangeType;
+  typedef typename GF::Traits::ElementType Element;
+  enum { dim = GF::Traits::dimDomain };
+
+public:
+  LegendreSmoothnessIndicator (const GF& gf_, int maxorder_)
+    : gf(gf_), maxorder(maxorder_)
+  {}
+
+  //! decay rate sigma of the Legendre coefficients of degree <= p on e
+  RF decay (const Element& e, int p) const
+  {
+    if (p>maxorder) p = maxorder;
+    if (p<1) return 0.0;
+    const std::vector<RF> b = shells(e,p);
+
+    // least squares fit over m=1..p, with m=0 included if there is only one point
+    const int first = (p>1) ? 1 : 0;
+    RF sm(0.0), sy(0.0), smm(0.0), smy(0.0);
+    const RF tiny = 1e-150;
+    const int np = p-first+1;
+    for (int m=first; m<=p; m++)
+      {
+        const RF y = 0.5*std::log(b[m]+tiny*tiny);
+        sm += m; sy += y; smm += m*m; smy += m*y;
+      }
+    const RF slope = (np*smy-sm*sy)/(np*smm-sm*sm);
+    return -slope;
+  }
+
+  //! L2 norm of the Legendre modes of degree p on e, scaled to the element volume
+  RF tail (const Element& e, int p) const
+  {
+    if (p>maxorder) p = maxorder;
+    if (p<0) return 0.0;
+    const std::vector<RF> b = shells(e,p);
+    return std::sqrt(b[p]*e.geometry().volume());
+  }
+
+private:
+  //! squared shell norms b_m^2, m=0,...,p, on the reference element
+  std::vector<RF> shells (const Element& e, int p) const
+  {
+
+    // a_\alpha for all multi indices with entries <= p, first index fastest
+    int n = 1;
+    for (int i=0; i<dim; i++) n *= p+1;
+    std::vector<RF> a(n,0.0);
+
+    Dune::GeometryType gt;
+    gt.makeCube(dim);
+    const Dune::QuadratureRule<DF,dim>& rule =
+      Dune::QuadratureRules<DF,dim>::rule(gt,p+maxorder);
+    std::vector<RF> L((p+1)*dim);
+    for (typename Dune::QuadratureRule<DF,dim>::const_iterator
+           it=rule.begin(); it!=rule.end(); ++it)
+      {
+        RangeType u;
+        gf.evaluate(e,it->position(),u);
+        for (int i=0; i<dim; i++)
+          legendre(it->position()[i],p,&L[i*(p+1)]);
+        for (int alpha=0; alpha<n; alpha++)
+          {
+            RF value = u[0]*it->weight();
+            int rest = alpha;
+            for (int i=0; i<dim; i++)
+              {
+                const int k = rest%(p+1);
+                rest /= p+1;
+                value *= (2*k+1)*L[i*(p+1)+k];
+              }
+            a[alpha] += value;
+          }
+      }
+
+    // shell norms
+    std::vector<RF> b(p+1,0.0);
+    for (int alpha=0; alpha<n; alpha++)
+      {
+        int m = 0;
+        RF scale = 1.0;
+        int rest = alpha;
+        for (int i=0; i<dim; i++)
+          {
+            const int k = rest%(p+1);
+            rest /= p+1;
+            m = std::max(m,k);
+            scale /= 2*k+1;
+          }
+        b[m] += a[alpha]*a[alpha]*scale;
+      }
+    return b;
+  }
+
+  // Legendre polynomials on [0,1] up to degree p
+  static void legendre (DF x, int p, RF* L)
+  {
+    const RF t = 2.0*x-1.0;
+    L[0] = 1.0;
+    if (p>0) L[1] = t;
+    for (int k=1; k<p; k++)
+      L[k+1] = ((2*k+1)*t*L[k]-k*L[k-1])/(k+1);
+  }
+
+  const GF& gf;
+  int maxorder;
+};
+
+#endif // DUNE_PDELAB_HOWTO_LEGENDRESMOOTHNESS_HH
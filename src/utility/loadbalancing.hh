@@ -0,0 +1,477 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_LOADBALANCING_HH
+#define DUNE_PDELAB_HOWTO_LOADBALANCING_HH
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<limits>
+#include<map>
+#include<set>
+#include<utility>
+#include<vector>
+
+#if HAVE_MPI
+#include<mpi.h>
+#endif
+
+#include<dune/common/fvector.hh>
+#include<dune/grid/common/gridenums.hh>
+#include<dune/pdelab/backend/istl.hh>
+#include<dune/pdelab/gridfunctionspace/localfunctionspace.hh>
+#include<dune/pdelab/gridfunctionspace/lfsindexcache.hh>
+
+/* Weighted dynamic load balancing for adaptive computations on grids that
+ * accept a target rank for every leaf element (UGGrid::loadBalance(target,level)).
+ *
+ * The element weights are stored in a vector indexed by the leaf index set.
+ * The weights model the work per element, e.g. the number of local degrees
+ * of freedom, or its square for discontinuous Galerkin spaces of variable
+ * degree where the local matrix blocks dominate assembly and solution.
+ * A partition is computed from the element centroids and the weights by
+ * recursive coordinate or inertial bisection and the grid is redistributed.
+ * The solution is carried over in the same way as the adaptivity module of
+ * PDELab does it: the local coefficients of every element are stored by
+ * global id before the change of the grid and written back into the new
+ * coefficient vector afterwards. Coefficients of elements that change
+ * their rank are sent to the new rank.
+ */
+
+namespace LoadBalancingImp {
+
+  //! number of histogram bins per selection round
+  const int bins = 64;
+
+  //! message tag of the coefficient migration
+  const int tag = 4712;
+
+  /** \brief smallest t with  sum_{x_i < t} w_i >= target  over all ranks */
+  template<typename Comm>
+  double weighted_quantile (const std::vector<double>& x, const std::vector<double>& w,
+                            double target, const Comm& comm)
+  {
+    double lo = std::numeric_limits<double>::max();
+    double hi = -std::numeric_limits<double>::max();
+    for (std::size_t i=0; i<x.size(); i++)
+      {
+        lo = std::min(lo,x[i]);
+        hi = std::max(hi,x[i]);
+      }
+    lo = comm.min(lo);
+    hi = comm.max(hi);
+    if (!(lo<hi)) return hi;
+
+    // the interval [lo,hi) and the bins are half open, so that every value
+    // is counted once; only the global maximum is included as upper edge
+    double below = 0.0;             // weight of all values < lo
+    bool closed = true;             // hi is the global maximum
+    std::vector<double> hist(bins);
+    for (int round=0; round<20; round++)
+      {
+        const double width = (hi-lo)/bins;
+        if (width<=std::numeric_limits<double>::epsilon()*std::max(std::abs(lo),std::abs(hi)))
+          break;
+
+        std::fill(hist.begin(),hist.end(),0.0);
+        for (std::size_t i=0; i<x.size(); i++)
+          if (x[i]>=lo && (x[i]<hi || (closed && x[i]==hi)))
+            {
+              // compare with the edges themselves, as the interval test does
+              int k = std::min(std::max(static_cast<int>((x[i]-lo)/width),0),bins-1);
+              while (k>0 && x[i]<lo+k*width) k--;
+              while (k<bins-1 && x[i]>=lo+(k+1)*width) k++;
+              hist[k] += w[i];
+            }
+        comm.sum(&hist[0],bins);
+
+        // first bin in which the accumulated weight reaches the target
+        double sum = below;
+        int k = 0;
+        for (; k<bins-1; k++)
+          {
+            if (sum+hist[k]>=target) break;
+            sum += hist[k];
+          }
+        below = sum;
+        if (k<bins-1)
+          {
+            hi = lo+(k+1)*width;
+            closed = false;
+          }
+        lo = lo+k*width;
+      }
+    return hi;
+  }
+
+  // append raw bytes of a trivially copyable value
+  template<typename T>
+  void pack (std::vector<char>& buffer, const T& value)
+  {
+    const std::size_t n = buffer.size();
+    buffer.resize(n+sizeof(T));
+    std::memcpy(&buffer[n],&value,sizeof(T));
+  }
+
+  template<typename T>
+  void unpack (const std::vector<char>& buffer, std::size_t& pos, T& value)
+  {
+    std::memcpy(&value,&buffer[pos],sizeof(T));
+    pos += sizeof(T);
+  }
+
+}
+
+/** \brief ratio of the largest to the mean sum of weights per rank
+ *
+ * Only interior elements count; 1 means perfect balance.
+ */
+template<typename GV>
+double imbalance (const GV& gv, const std::vector<double>& weights)
+{
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    Iterator;
+  double local = 0.0;
+  for (Iterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    local += weights[gv.indexSet().index(*it)];
+  const double total = gv.comm().sum(local);
+  if (total<=0.0) return 1.0;
+  return gv.comm().max(local)*gv.comm().size()/total;
+}
+
+/** \brief element weights n^exponent, n the number of local degrees of freedom
+ *
+ * n is the size of the local function space actually bound to the element,
+ * e.g. (p+1)(p+2)/2 for a monomial DG space of degree p in 2D. exponent=1
+ * balances the unknowns; exponent=2 balances the n^2 entries of the
+ * diagonal matrix blocks, which is the better model for DG spaces of
+ * variable degree. Zero on non-interior elements.
+ */
+template<typename GFS>
+std::vector<double> dof_weights (const GFS& gfs, double exponent=1.0)
+{
+  typedef typename GFS::Traits::GridViewType GV;
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    Iterator;
+  const GV& gv = gfs.gridView();
+  Dune::PDELab::LocalFunctionSpace<GFS> lfs(gfs);
+  std::vector<double> weights(gv.size(0),0.0);
+  for (Iterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    {
+      lfs.bind(*it);
+      weights[gv.indexSet().index(*it)] = std::pow(double(lfs.size()),exponent);
+    }
+  return weights;
+}
+
+/** \brief recursive coordinate or inertial bisection
+ *
+ * The interior elements are split recursively into two groups of weight
+ * proportional to the number of ranks each group gets. The cut is
+ * perpendicular to the longest edge of the bounding box of the group
+ * (RCB) or to the principal axis of the weighted inertia tensor of the
+ * element centroids (RIB, inertial=true), and its position is found by
+ * the distributed weighted quantile search. The result only depends on
+ * the geometry and the weights, not on the current distribution, and no
+ * external partitioning library is needed.
+ *
+ * Returns a target rank for every element, indexed by the leaf index set;
+ * entries of non-interior elements are set to the own rank.
+ */
+template<typename GV>
+std::vector<int> recursive_bisection (const GV& gv, const std::vector<double>& weights,
+                                      bool inertial=false)
+{
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    Iterator;
+  const int dim = GV::dimensionworld;
+  typedef Dune::FieldVector<double,dim> Point;
+  const int P = gv.comm().size();
+  std::vector<int> target(gv.size(0),gv.comm().rank());
+
+  std::vector<Point> centers;
+  std::vector<double> w;
+  std::vector<std::size_t> index;
+  for (Iterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    {
+      centers.push_back(it->geometry().center());
+      index.push_back(gv.indexSet().index(*it));
+      w.push_back(weights[index.back()]);
+    }
+
+  // range of ranks [first[i],last[i]) element i is assigned to
+  std::vector<int> first(centers.size(),0), last(centers.size(),P);
+
+  // the groups are the same on all ranks, so the collective operations match
+  std::vector<std::pair<int,int> > groups(1,std::make_pair(0,P));
+  while (!groups.empty())
+    {
+      std::vector<std::pair<int,int> > next;
+      for (std::size_t g=0; g<groups.size(); g++)
+        {
+          const int gfirst = groups[g].first, glast = groups[g].second;
+          if (glast-gfirst<2) continue;
+          const int mid = (gfirst+glast)/2;
+
+          std::vector<std::size_t> members;
+          for (std::size_t i=0; i<centers.size(); i++)
+            if (first[i]==gfirst && last[i]==glast) members.push_back(i);
+
+          // weighted center and bounding box of the group
+          double sums[dim+1];
+          for (int d=0; d<=dim; d++) sums[d] = 0.0;
+          Point lo(std::numeric_limits<double>::max());
+          Point hi(-std::numeric_limits<double>::max());
+          for (std::size_t j=0; j<members.size(); j++)
+            {
+              const Point& x = centers[members[j]];
+              for (int d=0; d<dim; d++)
+                {
+                  sums[d] += w[members[j]]*x[d];
+                  lo[d] = std::min(lo[d],x[d]);
+                  hi[d] = std::max(hi[d],x[d]);
+                }
+              sums[dim] += w[members[j]];
+            }
+          gv.comm().sum(sums,dim+1);
+          Point direction(0.0);
+          int axis = 0;
+          for (int d=0; d<dim; d++)
+            {
+              lo[d] = gv.comm().min(lo[d]);
+              hi[d] = gv.comm().max(hi[d]);
+              if (hi[d]-lo[d]>hi[axis]-lo[axis]) axis = d;
+            }
+          direction[axis] = 1.0;
+
+          if (inertial && sums[dim]>0.0)
+            {
+              // inertia tensor about the weighted center
+              Point c;
+              for (int d=0; d<dim; d++) c[d] = sums[d]/sums[dim];
+              double M[dim*dim];
+              for (int k=0; k<dim*dim; k++) M[k] = 0.0;
+              for (std::size_t j=0; j<members.size(); j++)
+                {
+                  Point x = centers[members[j]];
+                  x -= c;
+                  for (int k=0; k<dim; k++)
+                    for (int l=0; l<dim; l++)
+                      M[k*dim+l] += w[members[j]]*x[k]*x[l];
+                }
+              gv.comm().sum(M,dim*dim);
+
+              // principal axis by power iteration, started from the longest edge
+              for (int iter=0; iter<50; iter++)
+                {
+                  Point y(0.0);
+                  for (int k=0; k<dim; k++)
+                    for (int l=0; l<dim; l++)
+                      y[k] += M[k*dim+l]*direction[l];
+                  const double norm = y.two_norm();
+                  if (norm<=0.0) break;
+                  y /= norm;
+                  direction = y;
+                }
+            }
+
+          // cut at the weighted quantile of the projected centroids
+          std::vector<double> x(members.size()), wm(members.size());
+          for (std::size_t j=0; j<members.size(); j++)
+            {
+              x[j] = centers[members[j]]*direction;
+              wm[j] = w[members[j]];
+            }
+          const double fraction = double(mid-gfirst)/double(glast-gfirst);
+          const double cut = LoadBalancingImp::weighted_quantile(x,wm,fraction*sums[dim],gv.comm());
+          for (std::size_t j=0; j<members.size(); j++)
+            {
+              if (x[j]<cut) last[members[j]] = mid;
+              else first[members[j]] = mid;
+            }
+
+          next.push_back(std::make_pair(gfirst,mid));
+          next.push_back(std::make_pair(mid,glast));
+        }
+      groups.swap(next);
+    }
+
+  for (std::size_t i=0; i<centers.size(); i++)
+    target[index[i]] = first[i];
+  return target;
+}
+
+/** \brief Load balance handle passing a precomputed partition to ALUGrid
+ *
+ * ALUGrid distributes macro elements, so target has to be indexed by the
+ * level 0 index set, e.g. computed by recursive_bisection on
+ * grid.levelGridView(0). Use with grid.repartition(handle).
+ */
+template<typename Grid>
+class PartitionLoadBalanceHandle
+{
+  typedef typename Grid::LevelGridView GV0;
+  typedef typename Grid::template Codim<0>::Entity Element;
+
+public:
+  PartitionLoadBalanceHandle (const Grid& grid, const std::vector<int>& target_)
+    : gv0(grid.levelGridView(0)), target(target_)
+  {}
+
+  bool userDefinedPartitioning () const { return true; }
+  bool userDefinedLoadWeights () const { return false; }
+  bool repartition () const { return true; }
+  int loadWeight (const Element& e) const { return 1; }
+
+  int destination (const Element& e) const
+  {
+    return target[gv0.indexSet().index(e)];
+  }
+
+  //! the ranks we receive from are not known locally; returning false
+  //! lets ALUGrid determine them by communication
+  bool importRanks (std::set<int>& ranks) const { return false; }
+
+private:
+  GV0 gv0;
+  const std::vector<int>& target;
+};
+
+/** \brief Carry a coefficient vector over a redistribution of the grid
+ *
+ * backup() is called before the grid is changed, restore() afterwards,
+ * once the function space has been updated.
+ */
+template<typename Grid, typename GFS, typename X>
+class SolutionMigration
+{
+  typedef typename GFS::Traits::GridViewType GV;
+  typedef typename GV::template Codim<0>::Iterator Iterator;
+  typedef typename Grid::GlobalIdSet IdSet;
+  typedef typename IdSet::IdType IdType;
+  typedef typename X::ElementType RF;
+  typedef Dune::PDELab::LocalFunctionSpace<GFS> LFS;
+  typedef Dune::PDELab::LFSIndexCache<LFS> LFSCache;
+  typedef std::map<IdType,std::vector<RF> > Map;
+
+public:
+  SolutionMigration (const Grid& grid_, const GFS& gfs_)
+    : grid(grid_), gfs(gfs_)
+  {}
+
+  //! store the local coefficients of all interior elements and send those that move
+  void backup (const X& x, const std::vector<int>& target)
+  {
+    const GV& gv = gfs.gridView();
+    const int rank = gv.comm().rank();
+    LFS lfs(gfs);
+    LFSCache cache(lfs);
+    typename X::template ConstLocalView<LFSCache> xview(x);
+    const int P = gv.comm().size();
+    std::vector<std::vector<char> > sendbuffer(P);
+    data.clear();
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      {
+        if (it->partitionType()!=Dune::InteriorEntity) continue;
+        lfs.bind(*it);
+        cache.update();
+        std::vector<RF>& xl = data[grid.globalIdSet().id(*it)];
+        xl.resize(lfs.size());
+        xview.bind(cache);
+        xview.read(xl);
+        xview.unbind();
+        const int r = target[gv.indexSet().index(*it)];
+        if (r==rank) continue;
+        LoadBalancingImp::pack(sendbuffer[r],grid.globalIdSet().id(*it));
+        LoadBalancingImp::pack(sendbuffer[r],xl.size());
+        for (std::size_t i=0; i<xl.size(); i++)
+          LoadBalancingImp::pack(sendbuffer[r],xl[i]);
+      }
+
+#if HAVE_MPI
+    // the sizes are exchanged with all ranks, the coefficients are only
+    // sent to the rank an element moves to
+    MPI_Comm comm = gv.comm();
+    std::vector<int> sendsize(P), recvsize(P);
+    for (int r=0; r<P; r++) sendsize[r] = sendbuffer[r].size();
+    MPI_Alltoall(&sendsize[0],1,MPI_INT,&recvsize[0],1,MPI_INT,comm);
+    std::vector<std::vector<char> > recvbuffer(P);
+    std::vector<MPI_Request> requests(2*P);
+    int n = 0;
+    for (int r=0; r<P; r++)
+      if (recvsize[r]>0)
+        {
+          recvbuffer[r].resize(recvsize[r]);
+          MPI_Irecv(&recvbuffer[r][0],recvsize[r],MPI_CHAR,r,LoadBalancingImp::tag,comm,&requests[n++]);
+        }
+    for (int r=0; r<P; r++)
+      if (sendsize[r]>0)
+        MPI_Isend(&sendbuffer[r][0],sendsize[r],MPI_CHAR,r,LoadBalancingImp::tag,comm,&requests[n++]);
+    MPI_Waitall(n,&requests[0],MPI_STATUSES_IGNORE);
+
+    // keep the elements received for use after the migration
+    for (int r=0; r<P; r++)
+      {
+        std::size_t pos = 0;
+        while (pos<recvbuffer[r].size())
+          {
+            IdType id;
+            std::size_t m;
+            LoadBalancingImp::unpack(recvbuffer[r],pos,id);
+            LoadBalancingImp::unpack(recvbuffer[r],pos,m);
+            std::vector<RF>& xl = data[id];
+            xl.resize(m);
+            for (std::size_t i=0; i<m; i++)
+              LoadBalancingImp::unpack(recvbuffer[r],pos,xl[i]);
+          }
+      }
+#endif
+  }
+
+  //! write the stored coefficients into x on the new grid
+  void restore (X& x)
+  {
+    const GV& gv = gfs.gridView();
+    LFS lfs(gfs);
+    LFSCache cache(lfs);
+    typename X::template LocalView<LFSCache> xview(x);
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      {
+        if (it->partitionType()!=Dune::InteriorEntity) continue;
+        typename Map::const_iterator d = data.find(grid.globalIdSet().id(*it));
+        if (d==data.end()) continue;
+        lfs.bind(*it);
+        cache.update();
+        xview.bind(cache);
+        xview.write(d->second);
+        xview.unbind();
+      }
+    data.clear();
+  }
+
+private:
+  const Grid& grid;
+  const GFS& gfs;
+  Map data;
+};
+
+/** \brief redistribute the grid according to target and carry x along
+ *
+ * The function space is updated and x is resized. Only coefficients of
+ * interior elements are restored; communicate them afterwards if the
+ * space also has degrees of freedom on ghost elements.
+ */
+template<typename Grid, typename GFS, typename X>
+void rebalance (Grid& grid, GFS& gfs, X& x, const std::vector<int>& target)
+{
+  SolutionMigration<Grid,GFS,X> migration(grid,gfs);
+  migration.backup(x,target);
+  grid.loadBalance(target,0);
+  gfs.update(true); // the entity set has changed as well
+  x = X(gfs,0.0);
+  migration.restore(x);
+}
+
+#endif // DUNE_PDELAB_HOWTO_LOADBALANCING_HH
@@ -0,0 +1,420 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_LOCALTIMESTEPPING_HH
+#define DUNE_PDELAB_HOWTO_LOCALTIMESTEPPING_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/pdelab/backend/interface.hh>
+#include<dune/pdelab/gridfunctionspace/localfunctionspace.hh>
+#include<dune/pdelab/gridfunctionspace/lfsindexcache.hh>
+
+#include"explicitdg.hh"
+
+/* Local time stepping for explicit DG discretizations.
+ *
+ * On graded meshes the smallest element limits the step size of an
+ * explicit method everywhere. Here every element gets a level k and is
+ * advanced with step size h 2^k, where h is stable for the smallest
+ * element; a macro step of size h 2^K advances all levels 0,...,K to the
+ * same time. The method is the multirate Adams-Bashforth scheme of order
+ * three: between its updates the state of an element is the integral of
+ * the extrapolation polynomial through its last three right hand sides,
+ * so a fast element sees its slower neighbours at intermediate times with
+ * third order accuracy and both sides of a face use the same states.
+ */
+
+/** \brief levels for local time stepping from the element size
+ *
+ * The stable step of an element is taken proportional to d|E|/|dE|,
+ * i.e. a constant wave speed is assumed. Element level is
+ * floor(log2(h_E/h_min)) limited to maxlevel, afterwards neighbouring
+ * levels are made to differ by at most one. Returns the level per
+ * element index.
+ */
+template<typename GV>
+std::vector<int> lts_levels (const GV& gv, int maxlevel)
+{
+  typedef typename GV::template Codim<0>::Iterator Iterator;
+  typedef typename GV::IntersectionIterator IntersectionIterator;
+  std::vector<double> size(gv.size(0));
+  double hmin = 1e100;
+  for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+    {
+      const double h = dg_element_size(gv,*it);
+      size[gv.indexSet().index(*it)] = h;
+      hmin = std::min(hmin,h);
+    }
+  hmin = gv.comm().min(hmin);
+
+  std::vector<int> level(gv.size(0));
+  for (std::size_t i=0; i<size.size(); i++)
+    level[i] = std::min(maxlevel,int(std::floor(std::log(size[i]/hmin)/std::log(2.0)+1e-10)));
+
+  bool changed = true;
+  while (changed)
+    {
+      changed = false;
+      for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+        {
+          int& k = level[gv.indexSet().index(*it)];
+          for (IntersectionIterator iit=gv.ibegin(*it); iit!=gv.iend(*it); ++iit)
+            if (iit->neighbor())
+              {
+                const int kn = level[gv.indexSet().index(*iit->outside())];
+                if (k>kn+1)
+                  {
+                    k = kn+1;
+                    changed = true;
+                  }
+              }
+        }
+    }
+  return level;
+}
+
+/** \brief Local operator wrapper that evaluates only elements of the
+ *  active levels
+ *
+ * Cells with level at most kmax contribute volume and boundary terms,
+ * faces contribute if one of the adjacent cells is active. The residual
+ * of inactive cells is meaningless and must not be used.
+ */
+template<typename GV, typename LOP>
+class LevelMaskedLocalOperator : public LOP
+{
+public:
+  LevelMaskedLocalOperator (const GV& gv, const LOP& lop, const std::vector<int>& level_)
+    : LOP(lop), is(gv.indexSet()), level(level_), kmax(1<<30)
+  {}
+
+  //! evaluate cells with level <= kmax_
+  void setActive (int kmax_)
+  {
+    kmax = kmax_;
+  }
+
+  template<typename E>
+  bool active (const E& e) const
+  {
+    return level[is.index(e)]<=kmax;
+  }
+
+  template<typename EG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_volume (const EG& eg, const LFSU& lfsu, const X& x, const LFSV& lfsv, R& r) const
+  {
+    if (active(eg.entity()))
+      LOP::alpha_volume(eg,lfsu,x,lfsv,r);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_skeleton (const IG& ig,
+                       const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                       const LFSU& lfsu_n, const X& x_n, const LFSV& lfsv_n,
+                       R& r_s, R& r_n) const
+  {
+    if (active(*ig.inside()) || active(*ig.outside()))
+      LOP::alpha_skeleton(ig,lfsu_s,x_s,lfsv_s,lfsu_n,x_n,lfsv_n,r_s,r_n);
+  }
+
+  template<typename IG, typename LFSU, typename X, typename LFSV, typename R>
+  void alpha_boundary (const IG& ig, const LFSU& lfsu_s, const X& x_s, const LFSV& lfsv_s,
+                       R& r_s) const
+  {
+    if (active(*ig.inside()))
+      LOP::alpha_boundary(ig,lfsu_s,x_s,lfsv_s,r_s);
+  }
+
+  template<typename EG, typename LFSV, typename R>
+  void lambda_volume (const EG& eg, const LFSV& lfsv, R& r) const
+  {
+    if (active(eg.entity()))
+      LOP::lambda_volume(eg,lfsv,r);
+  }
+
+private:
+  const typename GV::IndexSet& is;
+  const std::vector<int>& level;
+  int kmax;
+};
+
+/** \brief stability interval of the Adams-Bashforth method of order
+ *  three on the negative real axis
+ *
+ * 6/11, against 2.51 for the three stage Runge-Kutta method, so a
+ * Runge-Kutta CFL bound has to be scaled down for MultirateAdamsBashforth.
+ */
+inline double ab3_stability_interval ()
+{
+  return 6.0/11.0;
+}
+
+/** \brief multirate Adams-Bashforth method of order three
+ *
+ * apply() does one macro step of size dt with 2^K micro steps of size
+ * h = dt/2^K. In micro step n the levels k with n mod 2^k = 0 are
+ * active: their interval ends, the new state is committed and a new
+ * right hand side is computed from the states of all elements at the
+ * current time. Inactive elements contribute their extrapolated state.
+ *
+ * Before the first step the right hand side history is generated by
+ * integrating backwards with the classical Runge-Kutta method using the
+ * smallest step, so the scheme is of order three from the start.
+ *
+ * \tparam R   time type
+ * \tparam GO  grid operator with a LevelMaskedLocalOperator
+ * \tparam MLOP the LevelMaskedLocalOperator
+ * \tparam V   vector type
+ */
+template<typename R, typename GO, typename MLOP, typename V>
+class MultirateAdamsBashforth
+{
+  typedef typename GO::Traits::Range W;
+  typedef typename GO::Traits::TrialGridFunctionSpace GFS;
+
+public:
+  template<typename MGO>
+  MultirateAdamsBashforth (const GO& go_, MLOP& mlop_, const MGO& mgo,
+                           const std::vector<int>& level, int maxlevel_)
+    : go(go_), mlop(mlop_), maxlevel(maxlevel_), verbosity(1),
+      minv(mgo,V(go_.trialGridFunctionSpace(),0.0)),
+      u(go_.trialGridFunctionSpace(),0.0), y(go_.trialGridFunctionSpace(),0.0),
+      f0(go_.trialGridFunctionSpace(),0.0), f1(go_.trialGridFunctionSpace(),0.0),
+      f2(go_.trialGridFunctionSpace(),0.0), g(go_.trialGridFunctionSpace(),0.0),
+      res(go_.testGridFunctionSpace(),0.0), started(false),
+      cells(maxlevel_+1,0), evaluations(0)
+  {
+    const GFS& gfs = go.trialGridFunctionSpace();
+    typedef typename GFS::Traits::GridViewType GV;
+    typedef typename GV::template Codim<0>::Iterator Iterator;
+    typedef Dune::PDELab::LocalFunctionSpace<GFS> LFS;
+    typedef Dune::PDELab::LFSIndexCache<LFS> LFSCache;
+    const GV& gv = gfs.gridView();
+
+    // level of every degree of freedom
+    V lv(gfs,0.0);
+    LFS lfs(gfs);
+    LFSCache cache(lfs);
+    typename V::template LocalView<LFSCache> view(lv);
+    std::vector<double> ll;
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      {
+        const int k = level[gv.indexSet().index(*it)];
+        if (k<0 || k>maxlevel)
+          DUNE_THROW(Dune::Exception,"time step level " << k << " out of range");
+        if (it->partitionType()==Dune::InteriorEntity)
+          cells[k]++;
+        lfs.bind(*it);
+        cache.update();
+        ll.assign(lfs.size(),k);
+        view.bind(cache);
+        view.write(ll);
+        view.unbind();
+      }
+    using Dune::PDELab::Backend::native;
+    for (std::size_t i=0; i<native(lv).N(); i++)
+      for (std::size_t j=0; j<native(lv)[i].N(); j++)
+        dof_level.push_back(static_cast<int>(native(lv)[i][j]+0.5));
+    for (int k=0; k<=maxlevel; k++)
+      cells[k] = gv.comm().sum(cells[k]);
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! do one macro step of size dt; returns dt
+  R apply (R time, R dt, const V& xold, V& xnew)
+  {
+    const int N = 1<<maxlevel;
+    const R h = dt/N;
+    if (!started)
+      startup(time,h,xold);
+    started = true;
+
+    if (verbosity>=1 && go.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [multirate Adams-Bashforth 3, " << maxlevel+1 << " levels] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+
+    u = xold;
+    for (int n=0; n<N; n++)
+      {
+        const int kmax = activeLevel(n);
+        if (n==0)
+          y = u;
+        else
+          {
+            extrapolate(n,h,y);
+            dg_copy_overlap(go.trialGridFunctionSpace(),y);
+            commit(kmax);
+          }
+        rhs(time+n*h,kmax,y);
+        for (int k=0; k<=kmax; k++)
+          evaluations += cells[k];
+      }
+
+    // all intervals end at the macro time step
+    extrapolate(N,h,xnew);
+    dg_copy_overlap(go.trialGridFunctionSpace(),xnew);
+    return dt;
+  }
+
+  //! element right hand side evaluations so far and with a global step
+  long elementEvaluations () const { return evaluations; }
+  long globalEvaluations (long macrosteps) const
+  {
+    long total = 0;
+    for (int k=0; k<=maxlevel; k++) total += cells[k];
+    return macrosteps*total*(1<<maxlevel);
+  }
+
+  //! number of elements per level
+  const std::vector<long>& levelCells () const { return cells; }
+
+  //! number of state sized vectors kept besides xold and xnew
+  int storage () const { return 7; }
+
+private:
+  // highest level whose interval ends at micro step n
+  int activeLevel (int n) const
+  {
+    if (n==0) return maxlevel;
+    int k = 0;
+    while (k<maxlevel && n%(2<<k)==0) k++;
+    return k;
+  }
+
+  // z = u + h_k int_0^tau p(s) ds with tau = (n mod 2^k)/2^k, tau=1 at
+  // the end of an interval, for every dof
+  void extrapolate (int n, R h, V& z) const
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& nu = native(u);
+    const auto& n0 = native(f0);
+    const auto& n1 = native(f1);
+    const auto& n2 = native(f2);
+    auto& nz = native(z);
+    std::size_t l = 0;
+    for (std::size_t i=0; i<nz.N(); i++)
+      for (std::size_t j=0; j<nz[i].N(); j++, l++)
+        {
+          const int m = 1<<dof_level[l];
+          const int r = n%m;
+          const double tau = (r==0) ? 1.0 : double(r)/m;
+          const double a = tau, b = 0.5*tau*tau, c = tau*tau*tau/6.0+0.25*tau*tau;
+          nz[i][j] = nu[i][j] + h*m*(a*n0[i][j] + b*(n0[i][j]-n1[i][j])
+                                     + c*(n0[i][j]-2.0*n1[i][j]+n2[i][j]));
+        }
+  }
+
+  // active elements start a new interval at the current state
+  void commit (int kmax)
+  {
+    using Dune::PDELab::Backend::native;
+    auto& nu = native(u);
+    const auto& ny = native(y);
+    std::size_t l = 0;
+    for (std::size_t i=0; i<nu.N(); i++)
+      for (std::size_t j=0; j<nu[i].N(); j++, l++)
+        if (dof_level[l]<=kmax)
+          nu[i][j] = ny[i][j];
+  }
+
+  // new right hand side L(z) = -M^{-1} r(z) of the active elements
+  void rhs (R t, int kmax, const V& z)
+  {
+    mlop.setActive(kmax);
+    mlop.setTime(t);
+    res = 0.0;
+    go.residual(z,res);
+    minv.mv(res,g);
+    using Dune::PDELab::Backend::native;
+    auto& n0 = native(f0);
+    auto& n1 = native(f1);
+    auto& n2 = native(f2);
+    const auto& ng = native(g);
+    std::size_t l = 0;
+    for (std::size_t i=0; i<n0.N(); i++)
+      for (std::size_t j=0; j<n0[i].N(); j++, l++)
+        if (dof_level[l]<=kmax)
+          {
+            n2[i][j] = n1[i][j];
+            n1[i][j] = n0[i][j];
+            n0[i][j] = -ng[i][j];
+          }
+  }
+
+  // full right hand side into g
+  void full_rhs (R t, const V& z)
+  {
+    mlop.setActive(maxlevel);
+    mlop.setTime(t);
+    res = 0.0;
+    go.residual(z,res);
+    minv.mv(res,g);
+    g *= -1.0;
+  }
+
+  // right hand sides at t-h_k and t-2h_k for every level by integrating
+  // backwards with the classical Runge-Kutta method and step h
+  void startup (R time, R h, const V& xold)
+  {
+    V z(xold), k1(xold), k2(xold), k3(xold), k4(xold), tmp(xold);
+    const int steps = 2<<maxlevel;
+    R t = time;
+    for (int step=1; step<=steps; step++)
+      {
+        const R dt = -h;
+        full_rhs(t,z); k1 = g;
+        tmp = z; tmp.axpy(0.5*dt,k1); dg_copy_overlap(go.trialGridFunctionSpace(),tmp);
+        full_rhs(t+0.5*dt,tmp); k2 = g;
+        tmp = z; tmp.axpy(0.5*dt,k2); dg_copy_overlap(go.trialGridFunctionSpace(),tmp);
+        full_rhs(t+0.5*dt,tmp); k3 = g;
+        tmp = z; tmp.axpy(dt,k3); dg_copy_overlap(go.trialGridFunctionSpace(),tmp);
+        full_rhs(t+dt,tmp); k4 = g;
+        z.axpy(dt/6.0,k1); z.axpy(dt/3.0,k2); z.axpy(dt/3.0,k3); z.axpy(dt/6.0,k4);
+        dg_copy_overlap(go.trialGridFunctionSpace(),z);
+        t += dt;
+
+        // store the history of the levels with a node at this time
+        bool needed = false;
+        for (int k=0; k<=maxlevel; k++)
+          if (step==(1<<k) || step==(2<<k)) needed = true;
+        if (!needed) continue;
+        full_rhs(t,z);
+        // f0 and f1 move to f1 and f2 with the first step
+        using Dune::PDELab::Backend::native;
+        auto& n0 = native(f0);
+        auto& n1 = native(f1);
+        const auto& ng = native(g);
+        std::size_t l = 0;
+        for (std::size_t i=0; i<n0.N(); i++)
+          for (std::size_t j=0; j<n0[i].N(); j++, l++)
+            {
+              const int m = 1<<dof_level[l];
+              if (step==m) n0[i][j] = ng[i][j];
+              if (step==2*m) n1[i][j] = ng[i][j];
+            }
+      }
+  }
+
+  const GO& go;
+  MLOP& mlop;
+  int maxlevel;
+  int verbosity;
+  DGInverseMass<typename GO::Traits::Jacobian> minv;
+  std::vector<int> dof_level;
+  V u, y, f0, f1, f2, g;
+  W res;
+  bool started;
+  std::vector<long> cells;
+  long evaluations;
+};
+
+#endif // DUNE_PDELAB_HOWTO_LOCALTIMESTEPPING_HH
@@ -0,0 +1,236 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_PARALLELMARKING_HH
+#define DUNE_PDELAB_HOWTO_PARALLELMARKING_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iostream>
+#include<limits>
+#include<vector>
+
+#include<dune/grid/common/gridenums.hh>
+#include<dune/pdelab/backend/istl.hh>
+
+/* Parallel counterparts of element_fraction, error_fraction and mark_grid
+ * from dune/pdelab/adaptivity/adaptivity.hh.
+ *
+ * The thresholds are the same on all ranks: only interior elements
+ * contribute and they are found by a distributed selection instead of
+ * sorting all indicators. The value range is cut into bins, a histogram
+ * of counts (or of indicator sums) is summed over all ranks, and the
+ * search continues in the bin that contains the threshold. Every round
+ * costs one pass over the local indicators and one reduction of a few
+ * numbers, and a handful of rounds resolve the threshold to machine
+ * precision.
+ */
+
+namespace ParallelMarkingImp {
+
+  //! number of histogram bins per selection round
+  const int bins = 64;
+
+  /** \brief bin of v in [lo,lo+bins*width), consistent with the computed bin edges
+   *
+   * The edge lo+k*width is compared directly, so that a value on an edge
+   * falls into the same bin as in the interval test of the next round.
+   */
+  template<typename RF>
+  int bin (RF v, RF lo, RF width)
+  {
+    int k = std::min(std::max(static_cast<int>((v-lo)/width),0),bins-1);
+    while (k>0 && v<lo+k*width) k--;
+    while (k<bins-1 && v>=lo+(k+1)*width) k++;
+    return k;
+  }
+
+  /** \brief largest t with  sum_{v_i >= t} w_i >= target  over all ranks
+   *
+   * w_i = 1 if weighted is false, w_i = v_i otherwise.
+   */
+  template<typename Comm, typename RF>
+  RF select_from_above (const std::vector<RF>& v, bool weighted, RF target, const Comm& comm)
+  {
+    RF lo = std::numeric_limits<RF>::max();
+    RF hi = -std::numeric_limits<RF>::max();
+    for (std::size_t i=0; i<v.size(); i++)
+      {
+        lo = std::min(lo,v[i]);
+        hi = std::max(hi,v[i]);
+      }
+    lo = comm.min(lo);
+    hi = comm.max(hi);
+    if (!(lo<hi)) return lo;
+
+    // the interval [lo,hi) and the bins are half open, so that every value
+    // is counted once; only the global maximum is included as upper edge
+    RF above = 0.0;                 // weight of all values >= hi
+    bool closed = true;             // hi is the global maximum
+    std::vector<RF> hist(bins);
+    for (int round=0; round<20; round++)
+      {
+        const RF width = (hi-lo)/bins;
+        if (width<=std::numeric_limits<RF>::epsilon()*std::max(std::abs(lo),std::abs(hi)))
+          break;
+
+        // local histogram of the values in [lo,hi)
+        std::fill(hist.begin(),hist.end(),0.0);
+        for (std::size_t i=0; i<v.size(); i++)
+          if (v[i]>=lo && (v[i]<hi || (closed && v[i]==hi)))
+            hist[bin(v[i],lo,width)] += weighted ? v[i] : 1.0;
+        comm.sum(&hist[0],bins);
+
+        // largest bin whose lower edge still satisfies the criterion
+        RF sum = above;
+        int k = bins-1;
+        for (; k>0; k--)
+          {
+            if (sum+hist[k]>=target) break;
+            sum += hist[k];
+          }
+        above = sum;
+        const RF newlo = lo+k*width;
+        if (k<bins-1)
+          {
+            hi = lo+(k+1)*width;
+            closed = false;
+          }
+        lo = newlo;
+      }
+
+    // snap to the smallest indicator in the final bin
+    RF t = std::numeric_limits<RF>::max();
+    for (std::size_t i=0; i<v.size(); i++)
+      if (v[i]>=lo) t = std::min(t,v[i]);
+    return comm.min(t);
+  }
+
+  /** \brief smallest t with  sum_{v_i <= t} w_i >= target  over all ranks */
+  template<typename Comm, typename RF>
+  RF select_from_below (const std::vector<RF>& v, bool weighted, RF target, const Comm& comm)
+  {
+    if (!weighted)
+      {
+        // count from above on the mirrored values
+        std::vector<RF> w(v.size());
+        for (std::size_t i=0; i<v.size(); i++) w[i] = -v[i];
+        return -select_from_above(w,false,target,comm);
+      }
+
+    // the weights are the values themselves, so use the complementary target
+    RF total = 0.0;
+    for (std::size_t i=0; i<v.size(); i++) total += v[i];
+    total = comm.sum(total);
+    return select_from_above(v,true,total-target,comm);
+  }
+
+  //! indicators of interior elements
+  template<typename GV, typename X>
+  std::vector<typename X::ElementType> interior_values (const GV& gv, const X& x)
+  {
+    typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+      Iterator;
+    std::vector<typename X::ElementType> v;
+    v.reserve(gv.size(0));
+    for (Iterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      v.push_back(Dune::PDELab::Backend::native(x)[gv.indexSet().index(*it)]);
+    return v;
+  }
+
+}
+
+/** \brief parallel version of element_fraction
+ *
+ * Marks the fraction alpha of all interior elements with the largest
+ * indicators for refinement and the fraction beta with the smallest
+ * for coarsening.
+ */
+template<typename GV, typename X>
+void parallel_element_fraction (const GV& gv, const X& x,
+                                typename X::ElementType alpha, typename X::ElementType beta,
+                                typename X::ElementType& eta_alpha, typename X::ElementType& eta_beta,
+                                int verbose=0)
+{
+  typedef typename X::ElementType RF;
+  const std::vector<RF> v = ParallelMarkingImp::interior_values(gv,x);
+  const RF N = gv.comm().sum(static_cast<RF>(v.size()));
+
+  eta_alpha = ParallelMarkingImp::select_from_above(v,false,alpha*N,gv.comm());
+  eta_beta = (beta>0.0) ? ParallelMarkingImp::select_from_below(v,false,beta*N,gv.comm())
+                        : -std::numeric_limits<RF>::max();
+
+  if (verbose>0 && gv.comm().rank()==0)
+    std::cout << "+++ element_fraction: elements=" << N
+              << " eta_alpha=" << eta_alpha << " eta_beta=" << eta_beta << std::endl;
+}
+
+/** \brief parallel version of error_fraction
+ *
+ * Selects eta_alpha such that the interior elements with indicators
+ * >= eta_alpha carry the fraction alpha of the total sum of indicators,
+ * and eta_beta such that those with indicators <= eta_beta carry the
+ * fraction beta.
+ */
+template<typename GV, typename X>
+void parallel_error_fraction (const GV& gv, const X& x,
+                              typename X::ElementType alpha, typename X::ElementType beta,
+                              typename X::ElementType& eta_alpha, typename X::ElementType& eta_beta,
+                              int verbose=0)
+{
+  typedef typename X::ElementType RF;
+  const std::vector<RF> v = ParallelMarkingImp::interior_values(gv,x);
+  RF total = 0.0;
+  for (std::size_t i=0; i<v.size(); i++) total += v[i];
+  total = gv.comm().sum(total);
+
+  eta_alpha = ParallelMarkingImp::select_from_above(v,true,alpha*total,gv.comm());
+  eta_beta = (beta>0.0) ? ParallelMarkingImp::select_from_below(v,true,beta*total,gv.comm())
+                        : -std::numeric_limits<RF>::max();
+
+  if (verbose>0 && gv.comm().rank()==0)
+    std::cout << "+++ error_fraction: total=" << total
+              << " eta_alpha=" << eta_alpha << " eta_beta=" << eta_beta << std::endl;
+}
+
+/** \brief parallel version of mark_grid
+ *
+ * Only interior elements are marked; the grid manager makes the marks
+ * consistent across ranks during adaptation.
+ */
+template<typename Grid, typename X>
+void parallel_mark_grid (Grid& grid, const X& x,
+                         typename X::ElementType refine_threshold,
+                         typename X::ElementType coarsen_threshold,
+                         int min_level = 0,
+                         int max_level = std::numeric_limits<int>::max(),
+                         int verbose = 0)
+{
+  typedef typename Grid::LeafGridView GV;
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    Iterator;
+  GV gv = grid.leafGridView();
+
+  int counts[2] = {0,0};
+  for (Iterator it=gv.template begin<0,Dune::Interior_Partition>();
+       it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+    {
+      const typename X::ElementType eta = Dune::PDELab::Backend::native(x)[gv.indexSet().index(*it)];
+      if (eta>=refine_threshold && it->level()<max_level)
+        {
+          grid.mark(1,*it);
+          counts[0]++;
+        }
+      else if (eta<=coarsen_threshold && it->level()>min_level)
+        {
+          grid.mark(-1,*it);
+          counts[1]++;
+        }
+    }
+  gv.comm().sum(counts,2);
+
+  if (verbose>0 && gv.comm().rank()==0)
+    std::cout << "+++ mark_grid: " << counts[0] << " marked for refinement, "
+              << counts[1] << " marked for coarsening" << std::endl;
+}
+
+#endif // DUNE_PDELAB_HOWTO_PARALLELMARKING_HH
@@ -0,0 +1,212 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_PARAREAL_HH
+#define DUNE_PDELAB_HOWTO_PARAREAL_HH
+
+#include<algorithm>
+#include<iomanip>
+#include<iostream>
+
+#if HAVE_MPI
+#include<mpi.h>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/common/parallel/collectivecommunication.hh>
+#include<dune/common/parallel/mpicollectivecommunication.hh>
+#include<dune/common/parallel/mpitraits.hh>
+#include<dune/pdelab/backend/interface.hh>
+
+#include"timestepcontrol.hh"
+
+/* Parareal time parallelism.
+ *
+ * The time interval is split into one slice per group of MPI ranks. Each
+ * group owns a complete copy of the spatial problem, distributed over
+ * the ranks of the group, and propagates the solution over its slice. A
+ * cheap coarse propagator G runs sequentially through the slices, an
+ * accurate fine propagator F runs in parallel on all slices, and the
+ * correction
+ *
+ *   U_{j+1}^{k+1} = G(U_j^{k+1}) + F(U_j^k) - G(U_j^k)
+ *
+ * converges to the sequential fine solution. After k iterations the first
+ * k slices are exact, so at most one iteration per slice is needed.
+ */
+
+/** \brief split MPI_COMM_WORLD into rank groups, one per time slice
+ *
+ * Rank r of group j is world rank j*P+r where P is the group size. The
+ * space communicator of a group is used to build its grid; since all
+ * groups are built alike, rank r of neighbouring groups holds the same
+ * part of the grid and vectors can be sent without renumbering.
+ */
+class PararealGroups
+{
+public:
+  typedef Dune::CollectiveCommunication<MPI_Comm> CollectiveCommunication;
+
+  PararealGroups (MPI_Comm world_, int groups)
+    : world(world_), worldcomm(world_), slices(groups)
+  {
+    const int size = worldcomm.size();
+    if (groups<1 || size%groups!=0)
+      DUNE_THROW(Dune::Exception,size << " ranks can not be split into " << groups << " groups");
+    groupsize = size/groups;
+    j = worldcomm.rank()/groupsize;
+    MPI_Comm_split(world,j,worldcomm.rank(),&space);
+  }
+
+  ~PararealGroups ()
+  {
+    MPI_Comm_free(&space);
+  }
+
+  //! communicator of the ranks sharing this time slice
+  MPI_Comm spaceComm () const { return space; }
+
+  //! collective communication over all ranks of all slices
+  const CollectiveCommunication& comm () const { return worldcomm; }
+
+  int slice () const { return j; }
+  int sliceCount () const { return slices; }
+  int groupSize () const { return groupsize; }
+
+  //! send x to the same rank of the next slice
+  template<typename V>
+  void sendNext (const V& x) const
+  {
+    using Dune::PDELab::Backend::native;
+    typedef typename V::ElementType E;
+    MPI_Send(const_cast<E*>(&native(x)[0][0]),native(x).dim(),
+             Dune::MPITraits<E>::getType(),worldcomm.rank()+groupsize,tag,world);
+  }
+
+  //! receive x from the same rank of the previous slice
+  template<typename V>
+  void receivePrevious (V& x) const
+  {
+    using Dune::PDELab::Backend::native;
+    typedef typename V::ElementType E;
+    MPI_Recv(&native(x)[0][0],native(x).dim(),
+             Dune::MPITraits<E>::getType(),worldcomm.rank()-groupsize,tag,world,
+             MPI_STATUS_IGNORE);
+  }
+
+private:
+  PararealGroups (const PararealGroups&);
+  PararealGroups& operator= (const PararealGroups&);
+
+  static const int tag = 4711;
+  MPI_Comm world, space;
+  CollectiveCommunication worldcomm;
+  int slices, groupsize, j;
+};
+
+/** \brief Parareal iteration
+ *
+ * The propagators provide apply(t0,t1,x0,x1), solving from x0 at t0 to
+ * x1 at t1 on the grid of the calling group. The iteration stops when the
+ * update of all slice end values, measured with scaled_error, is below
+ * tol or after maxit iterations.
+ *
+ * \tparam V vector type
+ * \tparam F fine propagator
+ * \tparam G coarse propagator
+ */
+template<typename V, typename F, typename G>
+class Parareal
+{
+public:
+  Parareal (const PararealGroups& groups_, F& fine_, G& coarse_, double tol_, int maxit_)
+    : groups(groups_), fine(fine_), coarse(coarse_), tol(tol_), maxit(maxit_),
+      verbosityLevel(1), iterations(0), fine_time(0.0), coarse_time(0.0), total_time(0.0)
+  {}
+
+  void setVerbosityLevel (int level)
+  {
+    verbosityLevel = level;
+  }
+
+  /** \brief solve from u0 at t0 to T
+   *
+   * On return u holds the solution at the end of the slice of the calling
+   * group; the last group has the solution at T.
+   */
+  void apply (double t0, double T, const V& u0, V& u)
+  {
+    Dune::Timer total;
+    const int j = groups.slice();
+    const int J = groups.sliceCount();
+    const double t = t0 + j*(T-t0)/J;
+    const double tnext = (j+1==J) ? T : t0 + (j+1)*(T-t0)/J;
+    fine_time = coarse_time = 0.0;
+
+    // initial guess from a sequential coarse sweep
+    V start(u0);
+    if (j>0) groups.receivePrevious(start);
+    V gold(u0);
+    Dune::Timer watch;
+    coarse.apply(t,tnext,start,gold);
+    coarse_time += watch.elapsed();
+    u = gold;
+    if (j+1<J) groups.sendNext(u);
+
+    V f(u0), gnew(u0), unew(u0);
+    for (iterations=1; iterations<=std::min(maxit,J); iterations++)
+      {
+        // fine propagation in parallel; the start value of slice j does
+        // not change any more after iteration j
+        if (iterations<=j+1)
+          {
+            watch.reset();
+            fine.apply(t,tnext,start,f);
+            fine_time += watch.elapsed();
+          }
+
+        // sequential coarse correction
+        if (j>0) groups.receivePrevious(start);
+        watch.reset();
+        coarse.apply(t,tnext,start,gnew);
+        coarse_time += watch.elapsed();
+        unew = gnew;
+        unew += f;
+        unew -= gold;
+        // pass the new end value on before the collective convergence
+        // test, which the next slice only reaches after receiving it
+        if (j+1<J) groups.sendNext(unew);
+        const double err = scaled_error(unew,u,tol,tol,groups.comm());
+        u = unew;
+        gold = gnew;
+
+        if (verbosityLevel>0 && groups.comm().rank()==0)
+          std::cout << "parareal iteration " << std::setw(3) << iterations
+                    << " relative update " << std::scientific << std::setprecision(4) << err*tol
+                    << std::endl;
+        if (err<=1.0)
+          break;
+      }
+    iterations = std::min(iterations,std::min(maxit,J));
+    total_time = total.elapsed();
+  }
+
+  int iterationCount () const { return iterations; }
+
+  //! time spent in the propagators on the calling rank
+  double fineTime () const { return fine_time; }
+  double coarseTime () const { return coarse_time; }
+  double totalTime () const { return total_time; }
+
+private:
+  const PararealGroups& groups;
+  F& fine;
+  G& coarse;
+  double tol;
+  int maxit;
+  int verbosityLevel;
+  int iterations;
+  double fine_time, coarse_time, total_time;
+};
+
+#endif // HAVE_MPI
+
+#endif // DUNE_PDELAB_HOWTO_PARAREAL_HH
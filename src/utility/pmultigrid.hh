@@ -0,0 +1,329 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_PMULTIGRID_HH
+#define DUNE_PDELAB_HOWTO_PMULTIGRID_HH
+
+#include<algorithm>
+#include<iostream>
+#include<memory>
+#include<vector>
+
+#include<dune/common/dynmatrix.hh>
+#include<dune/common/dynvector.hh>
+#include<dune/common/timer.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioner.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/pdelab/backend/istl.hh>
+#include<dune/pdelab/gridfunctionspace/localfunctionspace.hh>
+#include<dune/pdelab/gridfunctionspace/lfsindexcache.hh>
+
+/* p-multigrid for discontinuous Galerkin spaces with a hierarchical basis
+ * such as the monomials of VariableMonomLocalFiniteElementMap.
+ *
+ * The monomials of total degree <= q are a subset of those of degree p > q,
+ * so the space of degree q is spanned by a subset of the degrees of freedom
+ * and the Galerkin coarse grid matrix R A R^T is a submatrix of A. The
+ * levels are q = p_max, p_max-1, ..., coarse_degree; each of them is
+ * smoothed by block Gauss-Seidel with the element blocks inverted exactly,
+ * and the coarsest level (P0 or P1, a matrix of finite volume size) is
+ * handed to algebraic multigrid. No geometric information is needed, the
+ * preconditioner is built from the matrix, the degree of every degree of
+ * freedom and the element it belongs to.
+ */
+
+/** \brief V-cycle of the p-multigrid as ISTL preconditioner
+ *
+ * \tparam M BCRSMatrix with 1x1 blocks
+ * \tparam X BlockVector with blocks of size 1
+ */
+template<class M, class X>
+class PMultigridPreconditioner : public Dune::Preconditioner<X,X>
+{
+  typedef typename X::field_type field_type;
+  typedef typename M::ConstColIterator ColIterator;
+  typedef Dune::MatrixAdapter<M,X,X> Operator;
+  typedef Dune::SeqSSOR<M,X,X> Smoother;
+  typedef Dune::Amg::AMG<Operator,X,Smoother> AMG;
+
+public:
+  enum {category=Dune::SolverCategory::sequential};
+
+  /** \param A       system matrix
+   *  \param degree  total degree of the basis function of every dof
+   *  \param element element index of every dof
+   *  \param coarse_degree degree of the coarsest level, 1 if the method is
+   *         not stable for piecewise constants (e.g. OBB)
+   *  \param steps_  number of pre- and post-smoothing sweeps
+   */
+  PMultigridPreconditioner (const M& A, const std::vector<int>& degree,
+                            const std::vector<int>& element,
+                            int coarse_degree=0, int steps_=1)
+    : steps(steps_)
+  {
+    int pmax = coarse_degree;
+    for (std::size_t i=0; i<degree.size(); i++) pmax = std::max(pmax,degree[i]);
+
+    matrices.push_back(&A);
+    fine.push_back(std::vector<std::size_t>());
+    std::vector<int> deg(degree), elem(element);
+    setupBlocks(elem);
+
+    for (int q=pmax-1; q>=coarse_degree; q--)
+      {
+        // the dofs of degree <= q and their index on the finer level
+        const M& Af = *matrices.back();
+        std::vector<int> map(deg.size(),-1);
+        std::vector<std::size_t> f;
+        std::vector<int> cdeg, celem;
+        for (std::size_t i=0; i<deg.size(); i++)
+          if (deg[i]<=q)
+            {
+              map[i] = f.size();
+              f.push_back(i);
+              cdeg.push_back(deg[i]);
+              celem.push_back(elem[i]);
+            }
+
+        // Galerkin coarse matrix = submatrix
+        std::size_t nnz = 0;
+        for (std::size_t ic=0; ic<f.size(); ic++)
+          for (ColIterator j=Af[f[ic]].begin(); j!=Af[f[ic]].end(); ++j)
+            if (map[j.index()]>=0) nnz++;
+        std::shared_ptr<M> Ac(new M(f.size(),f.size(),nnz,M::row_wise));
+        for (typename M::CreateIterator row=Ac->createbegin(); row!=Ac->createend(); ++row)
+          {
+            const std::size_t i = f[row.index()];
+            for (ColIterator j=Af[i].begin(); j!=Af[i].end(); ++j)
+              if (map[j.index()]>=0) row.insert(map[j.index()]);
+          }
+        for (std::size_t ic=0; ic<f.size(); ic++)
+          for (ColIterator j=Af[f[ic]].begin(); j!=Af[f[ic]].end(); ++j)
+            if (map[j.index()]>=0)
+              (*Ac)[ic][map[j.index()]] = *j;
+
+        storage.push_back(Ac);
+        matrices.push_back(Ac.get());
+        fine.push_back(f);
+        deg.swap(cdeg);
+        elem.swap(celem);
+        setupBlocks(elem);
+      }
+
+    // algebraic multigrid on the coarsest level
+    typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<M,Dune::Amg::FirstDiagonal> >
+      Criterion;
+    typename Dune::Amg::SmootherTraits<Smoother>::Arguments smootherArgs;
+    smootherArgs.iterations = 2;
+    Criterion criterion(15,100);
+    coarseOperator.reset(new Operator(*matrices.back()));
+    coarseSolver.reset(new AMG(*coarseOperator,criterion,smootherArgs,1,1,1,false));
+  }
+
+  virtual void pre (X& x, X& b) {}
+
+  virtual void apply (X& v, const X& d)
+  {
+    v = 0.0;
+    cycle(0,v,d);
+  }
+
+  virtual void post (X& x) {}
+
+  //! number of levels including the algebraic coarse solver
+  std::size_t levels () const
+  {
+    return matrices.size();
+  }
+
+private:
+  // element blocks of the current coarsest level and their inverses
+  void setupBlocks (const std::vector<int>& elem)
+  {
+    const M& A = *matrices.back();
+    int nelements = 0;
+    for (std::size_t i=0; i<elem.size(); i++) nelements = std::max(nelements,elem[i]+1);
+    std::vector<std::vector<std::size_t> > b(nelements);
+    for (std::size_t i=0; i<elem.size(); i++) b[elem[i]].push_back(i);
+
+    std::vector<Dune::DynamicMatrix<field_type> > inv(nelements);
+    for (int e=0; e<nelements; e++)
+      {
+        const std::size_t n = b[e].size();
+        if (n==0) continue;
+        inv[e].resize(n,n);
+        for (std::size_t r=0; r<n; r++)
+          for (std::size_t c=0; c<n; c++)
+            inv[e][r][c] = A.exists(b[e][r],b[e][c]) ? A[b[e][r]][b[e][c]][0][0] : 0.0;
+        inv[e].invert();
+      }
+    blocks.push_back(b);
+    inverses.push_back(inv);
+  }
+
+  // one sweep of block Gauss-Seidel
+  void smooth (std::size_t l, X& x, const X& b, bool forward) const
+  {
+    const M& A = *matrices[l];
+    const std::size_t nb = blocks[l].size();
+    Dune::DynamicVector<field_type> r, dx;
+    for (std::size_t k=0; k<nb; k++)
+      {
+        const std::size_t e = forward ? k : nb-1-k;
+        const std::vector<std::size_t>& I = blocks[l][e];
+        if (I.empty()) continue;
+        r.resize(I.size());
+        dx.resize(I.size());
+        for (std::size_t a=0; a<I.size(); a++)
+          {
+            field_type s = b[I[a]][0];
+            for (ColIterator j=A[I[a]].begin(); j!=A[I[a]].end(); ++j)
+              s -= (*j)[0][0]*x[j.index()][0];
+            r[a] = s;
+          }
+        inverses[l][e].mv(r,dx);
+        for (std::size_t a=0; a<I.size(); a++)
+          x[I[a]][0] += dx[a];
+      }
+  }
+
+  void cycle (std::size_t l, X& x, const X& b)
+  {
+    if (l+1==matrices.size())
+      {
+        X d(b);
+        coarseSolver->pre(x,d);
+        coarseSolver->apply(x,d);
+        coarseSolver->post(x);
+        return;
+      }
+
+    for (int s=0; s<steps; s++) smooth(l,x,b,true);
+
+    X r(b);
+    matrices[l]->mmv(x,r);
+    const std::vector<std::size_t>& f = fine[l+1];
+    X bc(f.size()), xc(f.size());
+    for (std::size_t i=0; i<f.size(); i++) bc[i] = r[f[i]];
+    xc = 0.0;
+    cycle(l+1,xc,bc);
+    for (std::size_t i=0; i<f.size(); i++) x[f[i]] += xc[i];
+
+    for (int s=0; s<steps; s++) smooth(l,x,b,false);
+  }
+
+  int steps;
+  std::vector<const M*> matrices;                               // level 0 is the finest
+  std::vector<std::shared_ptr<M> > storage;
+  std::vector<std::vector<std::size_t> > fine;                  // index on the finer level
+  std::vector<std::vector<std::vector<std::size_t> > > blocks;  // dofs of each element
+  std::vector<std::vector<Dune::DynamicMatrix<field_type> > > inverses;
+  std::shared_ptr<Operator> coarseOperator;
+  std::shared_ptr<AMG> coarseSolver;
+};
+
+/** \brief sequential BiCGStab preconditioned by p-multigrid
+ *
+ * Solver backend for DG spaces with a hierarchical monomial basis of
+ * variable degree. The degree and element of every dof are taken from
+ * the grid function space each time a system is solved, so the backend
+ * may be reused after the polynomial degrees have changed.
+ */
+template<class GFS>
+class ISTLBackend_SEQ_BCGS_PMG
+  : public Dune::PDELab::SequentialNorm, public Dune::PDELab::LinearResultStorage
+{
+  typedef typename GFS::Traits::GridViewType GV;
+  typedef Dune::PDELab::LocalFunctionSpace<GFS> LFS;
+  typedef Dune::PDELab::LFSIndexCache<LFS> LFSCache;
+
+public:
+  ISTLBackend_SEQ_BCGS_PMG (const GFS& gfs_, int coarse_degree_=0,
+                            unsigned maxiter_=5000, int verbose_=1)
+    : gfs(gfs_), coarse_degree(coarse_degree_), maxiter(maxiter_), verbose(verbose_)
+  {}
+
+  template<class M, class V, class W>
+  void apply (M& A, V& z, W& r, typename V::ElementType reduction)
+  {
+    typedef Dune::PDELab::Backend::Native<M> NM;
+    typedef Dune::PDELab::Backend::Native<V> NV;
+    using Dune::PDELab::Backend::native;
+
+    Dune::Timer watch;
+    std::vector<int> degree, element;
+    dofInfo<V>(degree,element);
+    PMultigridPreconditioner<NM,NV> prec(native(A),degree,element,coarse_degree);
+    if (verbose>0)
+      std::cout << "=== p-multigrid setup " << watch.elapsed() << " s, "
+                << prec.levels() << " levels" << std::endl;
+
+    Dune::MatrixAdapter<NM,NV,NV> op(native(A));
+    Dune::BiCGSTABSolver<NV> solver(op,prec,reduction,maxiter,verbose);
+    Dune::InverseOperatorResult stat;
+    solver.apply(native(z),native(r),stat);
+    res.converged  = stat.converged;
+    res.iterations = stat.iterations;
+    res.elapsed    = stat.elapsed;
+    res.reduction  = stat.reduction;
+    res.conv_rate  = stat.conv_rate;
+  }
+
+private:
+  // total degree of each local monomial: C(q+d,d) monomials have degree <= q
+  static int monomialDegree (std::size_t k)
+  {
+    const int d = GV::dimension;
+    int q = 0;
+    for (;; q++)
+      {
+        std::size_t n = 1;
+        for (int i=1; i<=d; i++) n = n*(q+i)/i;
+        if (k<n) return q;
+      }
+  }
+
+  template<class V>
+  void dofInfo (std::vector<int>& degree, std::vector<int>& element) const
+  {
+    typedef typename GV::template Codim<0>::Iterator Iterator;
+    const GV& gv = gfs.gridView();
+    V dv(gfs,0.0), ev(gfs,0.0);
+    LFS lfs(gfs);
+    LFSCache cache(lfs);
+    typename V::template LocalView<LFSCache> dview(dv), eview(ev);
+    std::vector<double> ld, le;
+    for (Iterator it=gv.template begin<0>(); it!=gv.template end<0>(); ++it)
+      {
+        lfs.bind(*it);
+        cache.update();
+        ld.resize(lfs.size());
+        le.assign(lfs.size(),gv.indexSet().index(*it));
+        for (std::size_t k=0; k<lfs.size(); k++) ld[k] = monomialDegree(k);
+        dview.bind(cache);
+        dview.write(ld);
+        dview.unbind();
+        eview.bind(cache);
+        eview.write(le);
+        eview.unbind();
+      }
+
+    using Dune::PDELab::Backend::native;
+    degree.resize(native(dv).N());
+    element.resize(native(ev).N());
+    for (std::size_t i=0; i<degree.size(); i++)
+      {
+        degree[i] = static_cast<int>(native(dv)[i][0]+0.5);
+        element[i] = static_cast<int>(native(ev)[i][0]+0.5);
+      }
+  }
+
+  const GFS& gfs;
+  int coarse_degree;
+  unsigned maxiter;
+  int verbose;
+};
+
+#endif // DUNE_PDELAB_HOWTO_PMULTIGRID_HH
@@ -0,0 +1,427 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_SUPERTIMESTEPPING_HH
+#define DUNE_PDELAB_HOWTO_SUPERTIMESTEPPING_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+#include<string>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/timer.hh>
+#include<dune/pdelab/backend/interface.hh>
+#include<dune/pdelab/constraints/common/constraints.hh>
+#include<dune/pdelab/gridfunctionspace/interpolate.hh>
+
+#include"explicitdg.hh"
+
+/* Super time stepping for diffusion.
+ *
+ * Runge-Kutta-Chebyshev (RKC) and Runge-Kutta-Legendre (RKL) methods are
+ * explicit methods whose stability region along the negative real axis
+ * grows with the square of the number of stages s. The stages follow a
+ * three term recursion
+ *
+ *   Y_0 = u_n
+ *   Y_1 = Y_0 + mt_1 dt F(Y_0)
+ *   Y_j = mu_j Y_{j-1} + nu_j Y_{j-2} + (1-mu_j-nu_j) Y_0
+ *         + mt_j dt F(Y_{j-1}) + gt_j dt F(Y_0),   j = 2,...,s
+ *   u_{n+1} = Y_s
+ *
+ * so a step costs s residual evaluations and needs five vectors for any
+ * s. For a Jacobian with spectral radius rho the step is stable if
+ * dt rho <= beta(s), where forward Euler has beta = 2.
+ */
+
+/** \brief coefficients of a super time stepping method with s stages
+ *
+ * Derived classes fill the recursion coefficients for j = 0,...,s in
+ * setStages(); the stage times are computed here from the recursion.
+ */
+template<typename R>
+class SuperTimeSteppingParameter
+{
+public:
+  virtual ~SuperTimeSteppingParameter () {}
+
+  //! recompute the coefficients for s stages, s >= 2
+  virtual void setStages (int s) = 0;
+
+  //! stability bound: the step is stable if dt rho <= beta(s)
+  virtual R stabilityBound (int s) const = 0;
+
+  virtual std::string name () const = 0;
+
+  int s () const { return mu_.size()-1; }
+  R mu (int j) const { return mu_[j]; }
+  R nu (int j) const { return nu_[j]; }
+  R mutilde (int j) const { return mt_[j]; }
+  R gammatilde (int j) const { return gt_[j]; }
+
+  //! relative time of stage j
+  R c (int j) const { return c_[j]; }
+
+  //! smallest stage count that is stable for dt rho, scaled with safety > 1
+  int stagesFor (R dtrho, R safety=1.1) const
+  {
+    int s = 2;
+    while (stabilityBound(s)<safety*dtrho)
+      {
+        if (++s>10000)
+          DUNE_THROW(Dune::Exception,"super time step dt*rho=" << dtrho << " needs too many stages");
+      }
+    return s;
+  }
+
+protected:
+  //! allocate coefficient arrays for s stages
+  void resize (int s)
+  {
+    if (s<2)
+      DUNE_THROW(Dune::Exception,name() << " needs at least two stages");
+    mu_.assign(s+1,0.0);
+    nu_.assign(s+1,0.0);
+    mt_.assign(s+1,0.0);
+    gt_.assign(s+1,0.0);
+    c_.assign(s+1,0.0);
+  }
+
+  //! stage times from the recursion applied to u' = 1
+  void stageTimes ()
+  {
+    c_[0] = 0.0;
+    c_[1] = mt_[1];
+    for (int j=2; j<=s(); j++)
+      c_[j] = mu_[j]*c_[j-1] + nu_[j]*c_[j-2] + mt_[j] + gt_[j];
+  }
+
+  std::vector<R> mu_, nu_, mt_, gt_, c_;
+};
+
+/** \brief second order Runge-Kutta-Legendre method RKL2
+ *
+ * Meyer, Balsara and Aslam (J. Comput. Phys. 257, 2014); beta(s) = (s^2+s-2)/2.
+ */
+template<typename R>
+class RKL2Parameter : public SuperTimeSteppingParameter<R>
+{
+public:
+  RKL2Parameter (int s=2)
+  {
+    setStages(s);
+  }
+
+  virtual void setStages (int s)
+  {
+    this->resize(s);
+    std::vector<R> b(s+1);
+    for (int j=0; j<=s; j++)
+      b[j] = (j<=2) ? 1.0/3.0 : (j*j+j-2.0)/(2.0*j*(j+1.0));
+    const R w1 = 4.0/(s*s+s-2.0);
+    this->mt_[1] = b[1]*w1;
+    for (int j=2; j<=s; j++)
+      {
+        this->mu_[j] = (2.0*j-1.0)/j*b[j]/b[j-1];
+        this->nu_[j] = -(j-1.0)/j*b[j]/b[j-2];
+        this->mt_[j] = this->mu_[j]*w1;
+        this->gt_[j] = -(1.0-b[j-1])*this->mt_[j];
+      }
+    this->stageTimes();
+  }
+
+  virtual R stabilityBound (int s) const
+  {
+    return 0.5*(s*s+s-2.0);
+  }
+
+  virtual std::string name () const
+  {
+    return "RKL2";
+  }
+};
+
+/** \brief second order Runge-Kutta-Chebyshev method RKC2 with damping 2/13
+ *
+ * Verwer, Hundsdorfer and Sommeijer (Numer. Math. 57, 1990); beta(s) is
+ * about 0.65 s^2, so RKC2 needs fewer stages than RKL2 but is less damped.
+ */
+template<typename R>
+class RKCParameter : public SuperTimeSteppingParameter<R>
+{
+public:
+  RKCParameter (int s=2)
+  {
+    setStages(s);
+  }
+
+  virtual void setStages (int s)
+  {
+    this->resize(s);
+    const R w0 = 1.0 + damping/(s*s);
+    std::vector<R> T, dT, ddT;
+    chebyshev(s,w0,T,dT,ddT);
+    const R w1 = dT[s]/ddT[s];
+    std::vector<R> b(s+1);
+    for (int j=2; j<=s; j++)
+      b[j] = ddT[j]/(dT[j]*dT[j]);
+    b[0] = b[1] = b[2];
+    this->mt_[1] = b[1]*w1;
+    for (int j=2; j<=s; j++)
+      {
+        this->mu_[j] = 2.0*w0*b[j]/b[j-1];
+        this->nu_[j] = -b[j]/b[j-2];
+        this->mt_[j] = 2.0*w1*b[j]/b[j-1];
+        this->gt_[j] = -(1.0-b[j-1]*T[j-1])*this->mt_[j];
+      }
+    this->stageTimes();
+  }
+
+  virtual R stabilityBound (int s) const
+  {
+    const R w0 = 1.0 + damping/(s*s);
+    std::vector<R> T, dT, ddT;
+    chebyshev(s,w0,T,dT,ddT);
+    return (w0+1.0)*ddT[s]/dT[s];
+  }
+
+  virtual std::string name () const
+  {
+    return "RKC2";
+  }
+
+private:
+  //! Chebyshev polynomials T_j and their first two derivatives at x
+  static void chebyshev (int s, R x, std::vector<R>& T, std::vector<R>& dT, std::vector<R>& ddT)
+  {
+    T.assign(s+1,0.0); dT.assign(s+1,0.0); ddT.assign(s+1,0.0);
+    T[0] = 1.0; T[1] = x; dT[1] = 1.0;
+    for (int j=2; j<=s; j++)
+      {
+        T[j] = 2.0*x*T[j-1] - T[j-2];
+        dT[j] = 2.0*T[j-1] + 2.0*x*dT[j-1] - dT[j-2];
+        ddT[j] = 4.0*dT[j-1] + 2.0*x*ddT[j-1] - ddT[j-2];
+      }
+  }
+
+  static constexpr double damping = 2.0/13.0;
+};
+
+/** \brief super time stepping with a lumped mass matrix
+ *
+ * F(u) = -M_L^{-1} r(u,t) with the spatial residual r and the row sum
+ * lumped mass matrix M_L, which is obtained from one residual evaluation
+ * of the mass operator. No matrix is assembled and no linear system is
+ * solved. Constrained dofs have no mass; they are set from the Dirichlet
+ * extension g after every stage.
+ *
+ * The spectral radius of M_L^{-1} dr/du is estimated with a power
+ * iteration using residual differences. For time independent
+ * coefficients it is estimated once; selectStages then picks the
+ * smallest stable s for a given dt.
+ *
+ * \tparam R   time type
+ * \tparam GO  grid operator of the spatial part
+ * \tparam LOP spatial local operator, receives the stage times
+ * \tparam V   vector type
+ */
+template<typename R, typename GO, typename LOP, typename V>
+class SuperTimeStepping
+{
+  typedef typename GO::Traits::Range W;
+
+public:
+  template<typename MGO>
+  SuperTimeStepping (SuperTimeSteppingParameter<R>& method_, const GO& go_, LOP& lop_, const MGO& mgo)
+    : method(&method_), go(go_), lop(lop_), verbosity(1), rho(0.0),
+      minv(go_.trialGridFunctionSpace(),0.0), res(go_.testGridFunctionSpace(),0.0),
+      f0(go_.trialGridFunctionSpace(),0.0), y1(go_.trialGridFunctionSpace(),0.0),
+      y2(go_.trialGridFunctionSpace(),0.0), gvalues(go_.trialGridFunctionSpace(),0.0),
+      gtime(0.0), gvalid(false), stages(0), residual_time(0.0)
+  {
+    using Dune::PDELab::Backend::native;
+    V one(go.trialGridFunctionSpace(),1.0);
+    typename MGO::Traits::Range m(mgo.testGridFunctionSpace(),0.0);
+    mgo.residual(one,m);
+    auto& nm = native(minv);
+    const auto& nmass = native(m);
+    for (std::size_t i=0; i<nm.N(); i++)
+      for (std::size_t k=0; k<nm[i].N(); k++)
+        nm[i][k] = (nmass[i][k]!=0.0) ? 1.0/nmass[i][k] : 0.0;
+  }
+
+  void setMethod (SuperTimeSteppingParameter<R>& method_)
+  {
+    method = &method_;
+  }
+
+  void setVerbosityLevel (int level)
+  {
+    verbosity = level;
+  }
+
+  //! power iteration for the spectral radius of M_L^{-1} dr/du at x
+  R estimateSpectralRadius (R time, const V& x, int iterations=30)
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& comm = go.trialGridFunctionSpace().gridView().comm();
+    V v(go.trialGridFunctionSpace(),0.0), u(x), w(go.trialGridFunctionSpace(),0.0);
+    auto& nv = native(v);
+    std::size_t n = 0;
+    for (std::size_t i=0; i<nv.N(); i++)
+      for (std::size_t k=0; k<nv[i].N(); k++)
+        nv[i][k] = std::sin(1.0+(n++));
+    lop.setTime(time);
+    W r0(go.testGridFunctionSpace(),0.0);
+    go.residual(x,r0);
+    const R eps = 1e-6*std::max(1.0,comm.max(x.infinity_norm()));
+    R lambda = 0.0;
+    for (int k=0; k<iterations; k++)
+      {
+        v *= eps/comm.max(v.infinity_norm());
+        u = x;
+        u += v;
+        res = 0.0;
+        go.residual(u,res);
+        res -= r0;
+        scale(res,w);
+        dg_copy_overlap(go.trialGridFunctionSpace(),w);
+        lambda = comm.max(w.infinity_norm())/eps;
+        v = w;
+        if (lambda==0.0)
+          break;
+      }
+    rho = lambda;
+    if (verbosity>=1 && comm.rank()==0)
+      std::cout << "spectral radius estimate " << std::scientific << std::setprecision(4)
+                << rho << ", explicit Euler limit dt=" << 2.0/rho << std::endl;
+    return rho;
+  }
+
+  R spectralRadius () const { return rho; }
+
+  //! choose the smallest stable number of stages for dt; returns s
+  int selectStages (R dt, R safety=1.1)
+  {
+    if (rho<=0.0)
+      DUNE_THROW(Dune::Exception,"estimate the spectral radius before selecting stages");
+    const int s = method->stagesFor(dt*rho,safety);
+    if (s!=method->s())
+      method->setStages(s);
+    return s;
+  }
+
+  /** \brief do one step from time to time+dt
+   *
+   * g is the Dirichlet extension providing setTime, as for OneStepMethod.
+   */
+  template<typename G>
+  void apply (R time, R dt, const V& xold, G& g, V& xnew)
+  {
+    const int s = method->s();
+    if (verbosity>=1 && go.trialGridFunctionSpace().gridView().comm().rank()==0)
+      std::cout << "TIME STEP [" << method->name() << ", " << s << " stages] "
+                << std::setw(12) << std::setprecision(4) << std::scientific << time
+                << " " << dt << std::endl;
+
+    // Y_j is kept in buffer j%3, arranged such that Y_s ends up in xnew
+    V* buffer[3];
+    buffer[s%3] = &xnew;
+    buffer[(s+1)%3] = &y1;
+    buffer[(s+2)%3] = &y2;
+
+    // first stage
+    F(time,xold,f0);
+    V& first = *buffer[1];
+    first = xold;
+    first.axpy(method->mutilde(1)*dt,f0);
+    boundary(time+method->c(1)*dt,g,first);
+
+    // recursion
+    const V* yprev2 = &xold;
+    const V* yprev = &first;
+    for (int j=2; j<=s; j++)
+      {
+        V& ynew = *buffer[j%3];
+        F(time+method->c(j-1)*dt,*yprev,ynew);
+        ynew *= method->mutilde(j)*dt;
+        ynew.axpy(method->mu(j),*yprev);
+        ynew.axpy(method->nu(j),*yprev2);
+        ynew.axpy(1.0-method->mu(j)-method->nu(j),xold);
+        ynew.axpy(method->gammatilde(j)*dt,f0);
+        boundary(time+method->c(j)*dt,g,ynew);
+        yprev2 = yprev;
+        yprev = &ynew;
+      }
+  }
+
+  //! statistics
+  int stageCount () const { return stages; }
+  double residualTime () const { return residual_time; }
+
+private:
+  //! f = -M_L^{-1} r(x,t)
+  void F (R t, const V& x, V& f)
+  {
+    Dune::Timer watch;
+    lop.setTime(t);
+    res = 0.0;
+    go.residual(x,res);
+    scale(res,f);
+    f *= -1.0;
+    dg_copy_overlap(go.trialGridFunctionSpace(),f);
+    residual_time += watch.elapsed();
+    stages++;
+  }
+
+  void scale (const W& r, V& f) const
+  {
+    using Dune::PDELab::Backend::native;
+    const auto& nr = native(r);
+    const auto& nm = native(minv);
+    auto& nf = native(f);
+    for (std::size_t i=0; i<nf.N(); i++)
+      for (std::size_t k=0; k<nf[i].N(); k++)
+        nf[i][k] = nm[i][k]*nr[i][k];
+  }
+
+  /** \brief Dirichlet values at time t on the constrained dofs
+   *
+   * g is interpolated into a member buffer, at most once per distinct
+   * stage time and not at all if there are no constrained dofs.
+   */
+  template<typename G>
+  void boundary (R t, G& g, V& y)
+  {
+    const auto& cc = go.localAssembler().trialConstraints();
+    if (cc.size()>0)
+      {
+        if (!gvalid || t!=gtime)
+          {
+            g.setTime(t);
+            Dune::PDELab::interpolate(g,go.trialGridFunctionSpace(),gvalues);
+            gtime = t;
+            gvalid = true;
+          }
+        Dune::PDELab::copy_constrained_dofs(cc,gvalues,y);
+      }
+    dg_copy_overlap(go.trialGridFunctionSpace(),y);
+  }
+
+  SuperTimeSteppingParameter<R>* method;
+  const GO& go;
+  LOP& lop;
+  int verbosity;
+  R rho;
+  V minv;
+  W res;
+  V f0, y1, y2;
+  V gvalues;
+  R gtime;
+  bool gvalid;
+  int stages;
+  double residual_time;
+};
+
+#endif // DUNE_PDELAB_HOWTO_SUPERTIMESTEPPING_HH
@@ -0,0 +1,145 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_TIMESTEPCONTROL_HH
+#define DUNE_PDELAB_HOWTO_TIMESTEPCONTROL_HH
+
+#include<algorithm>
+#include<cmath>
+#include<iomanip>
+#include<iostream>
+
+#include<dune/common/exceptions.hh>
+
+/* Error controlled time stepping.
+ *
+ * A step is done with two one step methods of order p and q<p from the
+ * same initial value. The difference of the two solutions estimates the
+ * local error of the lower order method; the higher order solution is
+ * kept (local extrapolation). The error is scaled with an absolute and a
+ * relative tolerance so that the step is acceptable if the scaled error
+ * is at most one, and a PI controller proposes the next step size.
+ */
+
+/** \brief scaled difference of two solutions in the maximum norm
+ *
+ *  err = |x_high - x_low|_inf / (atol + rtol |x_high|_inf)
+ */
+template<typename V, typename Comm>
+double scaled_error (const V& xhigh, const V& xlow, double atol, double rtol, const Comm& comm)
+{
+  V d(xhigh);
+  d -= xlow;
+  const double e = comm.max(d.infinity_norm());
+  const double s = comm.max(xhigh.infinity_norm());
+  return e/(atol+rtol*s);
+}
+
+/** \brief PI step size controller
+ *
+ * After an accepted step with scaled error err the step size is multiplied by
+ *
+ *   safety * err^(-0.7/k) * err_old^(0.4/k),
+ *
+ * where k = q+1 and q is the order of the lower order method of the
+ * embedded pair; the memory term damps oscillations of the step size in
+ * smooth phases. After a rejected step the step size is reduced with the
+ * elementary controller safety * err^(-1/k) and the memory is kept. The
+ * factor is limited to [0.2,5] and the step size to [dtmin,dtmax].
+ */
+class PIStepController
+{
+public:
+  PIStepController (int q, double dtmin_, double dtmax_, double safety_=0.9)
+    : k(q+1), dtmin(dtmin_), dtmax(dtmax_), safety(safety_),
+      errold(1.0), accepted(0), rejected(0)
+  {}
+
+  //! decide about the step of size dt and propose the next step size
+  bool accept (double err, double dt, double& dtnew)
+  {
+    err = std::max(err,1e-10);
+    double factor;
+    bool ok = (err<=1.0 || dt<=dtmin);
+    if (ok)
+      {
+        factor = safety*std::pow(err,-0.7/k)*std::pow(errold,0.4/k);
+        errold = err;
+        accepted++;
+      }
+    else
+      {
+        factor = safety*std::pow(err,-1.0/k);
+        rejected++;
+      }
+    factor = std::min(5.0,std::max(0.2,factor));
+    dtnew = std::min(dtmax,std::max(dtmin,dt*factor));
+    return ok;
+  }
+
+  int acceptedSteps () const { return accepted; }
+  int rejectedSteps () const { return rejected; }
+
+  //! one line per step
+  void log (double time, double dt, double err, bool ok) const
+  {
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+    std::cout << (ok ? "accepted" : "rejected")
+              << " step " << std::setw(4) << accepted+rejected
+              << " t=" << std::scientific << std::setprecision(4) << time
+              << " dt=" << dt << " err=" << err << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+  }
+
+private:
+  int k;
+  double dtmin, dtmax, safety;
+  double errold;
+  int accepted, rejected;
+};
+
+/** \brief step size control from the convergence of Newton's method
+ *
+ * For implicit schemes without an error estimator the step size is
+ * limited by the robustness of Newton's method. The next step size is
+ * chosen such that about target iterations per stage are needed:
+ * dt is scaled with target/iterations, limited to [0.5,1.5], and not
+ * increased if the average contraction rate exceeds 0.5, i.e. if the
+ * initial guess was barely inside the quadratic convergence region.
+ * A step where Newton fails is retried with half the step size.
+ */
+class NewtonStepController
+{
+public:
+  NewtonStepController (double target_, double dtmin_, double dtmax_)
+    : target(target_), dtmin(dtmin_), dtmax(dtmax_), accepted(0), rejected(0)
+  {}
+
+  //! next step size after a converged step
+  double next (double dt, double iterations_per_stage, double contraction)
+  {
+    accepted++;
+    double factor = target/std::max(iterations_per_stage,1.0);
+    factor = std::min(1.5,std::max(0.5,factor));
+    if (contraction>0.5) factor = std::min(factor,1.0);
+    return std::min(dtmax,std::max(dtmin,dt*factor));
+  }
+
+  //! next step size after a failed step
+  double reject (double dt)
+  {
+    rejected++;
+    if (dt<=dtmin)
+      DUNE_THROW(Dune::Exception,"time step below " << dtmin << " and Newton still fails");
+    return std::max(dtmin,0.5*dt);
+  }
+
+  int acceptedSteps () const { return accepted; }
+  int rejectedSteps () const { return rejected; }
+
+private:
+  double target, dtmin, dtmax;
+  int accepted, rejected;
+};
+
+#endif // DUNE_PDELAB_HOWTO_TIMESTEPCONTROL_HH
@@ -0,0 +1,407 @@
+// -*- tab-width: 4; indent-tabs-mode: nil -*-
+#ifndef DUNE_PDELAB_HOWTO_XDMFWRITER_HH
+#define DUNE_PDELAB_HOWTO_XDMFWRITER_HH
+
+#include<algorithm>
+#include<fstream>
+#include<iomanip>
+#include<memory>
+#include<sstream>
+#include<string>
+#include<vector>
+
+#include<dune/common/exceptions.hh>
+#include<dune/common/fvector.hh>
+#include<dune/geometry/referenceelements.hh>
+#include<dune/geometry/type.hh>
+#include<dune/grid/common/gridenums.hh>
+#include<dune/grid/io/file/vtk/function.hh>
+
+/** \brief time series output in XDMF format with the mesh written only once
+ *
+ * VTK files repeat points and connectivity in every step, which dominates
+ * the output of large 3D runs with few unknowns per cell. This writer
+ * stores the mesh once at the beginning of a raw binary file and appends
+ * only the data of the functions in every step. The light data file
+ * basename.xmf is an XDMF 2 temporal collection whose items refer to
+ * byte offsets in the binary file; ParaView and VisIt read it directly.
+ * Every step is written over the closing tags at the end of basename.xmf,
+ * which are then appended again, so the file is complete after each step
+ * and a step costs the same no matter how many steps came before.
+ *
+ * In parallel every rank writes the interior elements to its own file
+ * basename-pRRRR.bin and rank 0 writes basename.xmf with one spatial
+ * collection of all pieces per step. The sizes of the pieces are
+ * exchanged in the constructor, which must be called by all ranks;
+ * write() does not communicate and may be called from a background
+ * thread, e.g. by AsyncOutput.
+ *
+ * The functions are the VTKFunction adapters used with VTKWriter. Vertex
+ * data is continuous, i.e. every vertex is evaluated in one of its
+ * elements, and cell data is evaluated in the cell center. Every rank has
+ * to add the same functions. Data is written as doubles in native byte
+ * order; vectors with two components are padded to three.
+ */
+template<typename GV>
+class XDMFWriter
+{
+  typedef typename GV::ctype DF;
+  enum { dim = GV::dimension };
+  typedef Dune::VTKFunction<GV> Function;
+  typedef std::shared_ptr<const Function> FunctionPtr;
+  typedef typename GV::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator
+    ElementIterator;
+
+  // size of the piece of one rank
+  struct Piece
+  {
+    long vertices, cells, connectivity;
+    int type;   // common XDMF cell type, 0 for mixed
+  };
+
+public:
+  //! write the mesh; collective
+  XDMFWriter (const GV& gv_, const std::string& basename_, const std::string& path_="")
+    : gv(gv_), basename(basename_), path(path_),
+      rank(gv_.comm().rank()), size(gv_.comm().size()), steps(0), data_bytes(0)
+  {
+    // number the vertices of interior elements, corners in XDMF order
+    std::vector<double> coordinates;
+    std::vector<int> topology;
+    vertexindex.assign(gv.size(dim),-1);
+    Piece local = {0,0,0,-1};
+    for (ElementIterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      {
+        const Dune::GeometryType gt = it->type();
+        const int type = cellType(gt);
+        const int n = it->geometry().corners();
+        local.type = (local.type<0 || local.type==type) ? type : 0;
+        topology.push_back(type);
+        if (type==2)
+          topology.push_back(n);
+        for (int k=0; k<n; k++)
+          {
+            const int i = renumber(gt,k);
+            const int v = gv.indexSet().subIndex(*it,i,dim);
+            if (vertexindex[v]<0)
+              {
+                vertexindex[v] = local.vertices++;
+                const typename GV::template Codim<0>::Geometry::GlobalCoordinate
+                  x = it->geometry().corner(i);
+                for (int d=0; d<3; d++)
+                  coordinates.push_back(d<int(x.size()) ? double(x[d]) : 0.0);
+              }
+            topology.push_back(vertexindex[v]);
+          }
+        local.cells++;
+      }
+    if (local.type<0)
+      local.type = 0;
+
+    // with a common cell type the type ids are not stored
+    if (local.type!=0)
+      {
+        std::vector<int> connectivity;
+        std::size_t j = 0;
+        while (j<topology.size())
+          {
+            const int n = (topology[j]==2) ? topology[j+1] : nodes(topology[j]);
+            j += (topology[j]==2) ? 2 : 1;
+            for (int k=0; k<n; k++)
+              connectivity.push_back(topology[j++]);
+          }
+        topology.swap(connectivity);
+      }
+    local.connectivity = topology.size();
+
+    std::ofstream file(heavyName(rank).c_str(),std::ios::binary|std::ios::trunc);
+    if (!file)
+      DUNE_THROW(Dune::IOError,"could not open " << heavyName(rank));
+    writeBlock(file,coordinates);
+    writeBlock(file,topology);
+    mesh_bytes = coordinates.size()*sizeof(double)+topology.size()*sizeof(int);
+    own = local;
+
+    // rank 0 needs the sizes of all pieces for the offsets
+    std::vector<long> in(4), out(4*size);
+    in[0] = local.vertices; in[1] = local.cells; in[2] = local.connectivity; in[3] = local.type;
+    gv.comm().gather(&in[0],&out[0],4,0);
+    if (rank==0)
+      for (int r=0; r<size; r++)
+        {
+          Piece piece = {out[4*r],out[4*r+1],out[4*r+2],int(out[4*r+3])};
+          pieces.push_back(piece);
+          end.push_back(piece.vertices*3*sizeof(double)+piece.connectivity*sizeof(int));
+        }
+
+    // light data file with an empty temporal collection
+    if (rank==0)
+      {
+        std::ofstream xmf((basename+".xmf").c_str(),std::ios::binary|std::ios::trunc);
+        if (!xmf)
+          DUNE_THROW(Dune::IOError,"could not open " << basename << ".xmf");
+        xmf << "<?xml version=\"1.0\" ?>\n"
+            << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n"
+            << "<Xdmf Version=\"2.0\">\n"
+            << " <Domain>\n"
+            << "  <Grid Name=\"" << basename << "\" GridType=\"Collection\" CollectionType=\"Temporal\">\n";
+        tailpos = xmf.tellp();
+        xmf << tail();
+      }
+  }
+
+  //! add continuous vertex data, the writer takes ownership
+  void addVertexData (const Function* f)
+  {
+    vertexdata.push_back(FunctionPtr(f));
+  }
+
+  void addVertexData (const FunctionPtr& f)
+  {
+    vertexdata.push_back(f);
+  }
+
+  //! add cell data, the writer takes ownership
+  void addCellData (const Function* f)
+  {
+    celldata.push_back(FunctionPtr(f));
+  }
+
+  void addCellData (const FunctionPtr& f)
+  {
+    celldata.push_back(f);
+  }
+
+  //! remove all functions
+  void clear ()
+  {
+    vertexdata.clear();
+    celldata.clear();
+  }
+
+  //! append the data of the current functions for the given time
+  void write (double time)
+  {
+    // heavy data of this rank
+    std::ofstream file(heavyName(rank).c_str(),std::ios::binary|std::ios::app);
+    if (!file)
+      DUNE_THROW(Dune::IOError,"could not open " << heavyName(rank));
+    std::vector<double> values;
+    for (std::size_t f=0; f<vertexdata.size(); f++)
+      {
+        evaluateVertexData(*vertexdata[f],values);
+        writeBlock(file,values);
+        data_bytes += values.size()*sizeof(double);
+      }
+    for (std::size_t f=0; f<celldata.size(); f++)
+      {
+        evaluateCellData(*celldata[f],values);
+        writeBlock(file,values);
+        data_bytes += values.size()*sizeof(double);
+      }
+    file.close();
+    steps++;
+
+    // light data on rank 0
+    if (rank!=0)
+      return;
+    std::stringstream s;
+    s << std::setprecision(16);
+    s << "   <Grid Name=\"step" << steps-1 << "\" GridType=\"Collection\" CollectionType=\"Spatial\">\n"
+      << "    <Time Value=\"" << time << "\"/>\n";
+    for (int r=0; r<size; r++)
+      {
+        const Piece& piece = pieces[r];
+        s << "    <Grid Name=\"piece" << r << "\" GridType=\"Uniform\">\n";
+        if (piece.type!=0)
+          s << "     <Topology TopologyType=\"" << typeName(piece.type) << "\""
+            << " NumberOfElements=\"" << piece.cells << "\""
+            << " NodesPerElement=\"" << piece.connectivity/std::max(piece.cells,1L) << "\">\n"
+            << dataItem(r,piece.vertices*3*sizeof(double),"Int",sizeof(int),piece.cells,
+                        piece.connectivity/std::max(piece.cells,1L));
+        else
+          s << "     <Topology TopologyType=\"Mixed\" NumberOfElements=\"" << piece.cells << "\">\n"
+            << dataItem(r,piece.vertices*3*sizeof(double),"Int",sizeof(int),piece.connectivity,1);
+        s << "     </Topology>\n"
+          << "     <Geometry GeometryType=\"XYZ\">\n"
+          << dataItem(r,0,"Float",sizeof(double),piece.vertices,3)
+          << "     </Geometry>\n";
+        for (std::size_t f=0; f<vertexdata.size(); f++)
+          {
+            const int n = components(*vertexdata[f]);
+            s << attribute(*vertexdata[f],"Node")
+              << dataItem(r,end[r],"Float",sizeof(double),piece.vertices,n)
+              << "     </Attribute>\n";
+            end[r] += piece.vertices*n*sizeof(double);
+          }
+        for (std::size_t f=0; f<celldata.size(); f++)
+          {
+            const int n = components(*celldata[f]);
+            s << attribute(*celldata[f],"Cell")
+              << dataItem(r,end[r],"Float",sizeof(double),piece.cells,n)
+              << "     </Attribute>\n";
+            end[r] += piece.cells*n*sizeof(double);
+          }
+        s << "    </Grid>\n";
+      }
+    s << "   </Grid>\n";
+
+    // overwrite the closing tags with the step and append them again
+    std::fstream xmf((basename+".xmf").c_str(),std::ios::in|std::ios::out|std::ios::binary);
+    if (!xmf)
+      DUNE_THROW(Dune::IOError,"could not open " << basename << ".xmf");
+    xmf.seekp(tailpos);
+    xmf << s.str();
+    tailpos = xmf.tellp();
+    xmf << tail();
+  }
+
+  //! bytes written by this rank for the mesh and for the data of all steps
+  long meshBytes () const { return mesh_bytes; }
+  long dataBytes () const { return data_bytes; }
+
+private:
+  //! number of components written, vectors in 2d are padded to 3
+  static int components (const Function& f)
+  {
+    return (f.ncomps()==2) ? 3 : f.ncomps();
+  }
+
+  void evaluateVertexData (const Function& f, std::vector<double>& values) const
+  {
+    const int n = components(f);
+    const long vertices = own.vertices;
+    values.assign(vertices*n,0.0);
+    std::vector<bool> done(vertices,false);
+    for (ElementIterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      {
+        const Dune::ReferenceElement<DF,dim>& ref =
+          Dune::ReferenceElements<DF,dim>::general(it->type());
+        for (int i=0; i<ref.size(dim); i++)
+          {
+            const int v = vertexindex[gv.indexSet().subIndex(*it,i,dim)];
+            if (done[v])
+              continue;
+            for (int c=0; c<f.ncomps(); c++)
+              values[v*n+c] = f.evaluate(c,*it,ref.position(i,dim));
+            done[v] = true;
+          }
+      }
+  }
+
+  void evaluateCellData (const Function& f, std::vector<double>& values) const
+  {
+    const int n = components(f);
+    values.clear();
+    for (ElementIterator it=gv.template begin<0,Dune::Interior_Partition>();
+         it!=gv.template end<0,Dune::Interior_Partition>(); ++it)
+      {
+        const Dune::ReferenceElement<DF,dim>& ref =
+          Dune::ReferenceElements<DF,dim>::general(it->type());
+        for (int c=0; c<n; c++)
+          values.push_back(c<f.ncomps() ? f.evaluate(c,*it,ref.position(0,0)) : 0.0);
+      }
+  }
+
+  //! closing tags of the light data file
+  static const char* tail ()
+  {
+    return "  </Grid>\n </Domain>\n</Xdmf>\n";
+  }
+
+  template<typename T>
+  static void writeBlock (std::ofstream& file, const std::vector<T>& block)
+  {
+    if (!block.empty())
+      file.write(reinterpret_cast<const char*>(&block[0]),block.size()*sizeof(T));
+  }
+
+  //! binary file of rank r, relative to the light data file
+  std::string heavyName (int r) const
+  {
+    std::stringstream s;
+    if (!path.empty())
+      s << path << "/";
+    s << basename;
+    if (size>1)
+      s << "-p" << std::setw(4) << std::setfill('0') << r;
+    s << ".bin";
+    return s.str();
+  }
+
+  std::string dataItem (int r, long seek, const char* type, int precision, long rows, long columns) const
+  {
+    std::stringstream s;
+    s << "      <DataItem Format=\"Binary\" Endian=\"Native\" Seek=\"" << seek << "\""
+      << " NumberType=\"" << type << "\" Precision=\"" << precision << "\""
+      << " Dimensions=\"" << rows << " " << columns << "\">"
+      << heavyName(r) << "</DataItem>\n";
+    return s.str();
+  }
+
+  static std::string attribute (const Function& f, const char* center)
+  {
+    const int n = components(f);
+    std::stringstream s;
+    s << "     <Attribute Name=\"" << f.name() << "\" AttributeType=\""
+      << (n==1 ? "Scalar" : (n==3 ? "Vector" : "Matrix"))
+      << "\" Center=\"" << center << "\">\n";
+    return s.str();
+  }
+
+  //! XDMF cell type id
+  static int cellType (const Dune::GeometryType& gt)
+  {
+    if (gt.isLine()) return 2;
+    if (gt.isTriangle()) return 4;
+    if (gt.isQuadrilateral()) return 5;
+    if (gt.isTetrahedron()) return 6;
+    if (gt.isPyramid()) return 7;
+    if (gt.isPrism()) return 8;
+    if (gt.isHexahedron()) return 9;
+    DUNE_THROW(Dune::NotImplemented,"no XDMF cell type for " << gt);
+  }
+
+  static int nodes (int type)
+  {
+    static const int n[10] = {0,1,2,0,3,4,4,5,6,8};
+    return n[type];
+  }
+
+  static const char* typeName (int type)
+  {
+    static const char* name[10] = {"","Polyvertex","Polyline","","Triangle","Quadrilateral",
+                                   "Tetrahedron","Pyramid","Wedge","Hexahedron"};
+    return name[type];
+  }
+
+  //! corner of the DUNE element for corner k in XDMF order, as in VTK
+  static int renumber (const Dune::GeometryType& gt, int k)
+  {
+    static const int quad[4] = {0,1,3,2};
+    static const int hexahedron[8] = {0,1,3,2,4,5,7,6};
+    static const int prism[6] = {0,2,1,3,5,4};
+    static const int pyramid[5] = {0,1,3,2,4};
+    if (gt.isQuadrilateral()) return quad[k];
+    if (gt.isHexahedron()) return hexahedron[k];
+    if (gt.isPrism()) return prism[k];
+    if (gt.isPyramid()) return pyramid[k];
+    return k;
+  }
+
+  const GV& gv;
+  std::string basename, path;
+  int rank, size;
+  std::vector<int> vertexindex;
+  Piece own;
+  std::vector<Piece> pieces;        // all pieces, rank 0 only
+  std::vector<long> end;            // end of the heavy data of every piece, rank 0
+  std::vector<FunctionPtr> vertexdata, celldata;
+  std::streampos tailpos;           // start of the closing tags, rank 0
+  int steps;
+  long mesh_bytes, data_bytes;
+};
+
+#endif // DUNE_PDELAB_HOWTO_XDMFWRITER_HH